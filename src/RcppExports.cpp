@@ -5,6 +5,54 @@
 
 using namespace Rcpp;
 
+// abc_smc
+List abc_smc(std::string model, DataFrame input_df, DataFrame data, NumericVector lower, NumericVector upper, List input_sim_params, List input_model_params, NumericVector weights, std::string distance, int nparticles, int ngenerations, double quantile, double min_acceptance, bool log_scale, int nthreads);
+RcppExport SEXP _CalciumModelsLibrary_abc_smc(SEXP modelSEXP, SEXP input_dfSEXP, SEXP dataSEXP, SEXP lowerSEXP, SEXP upperSEXP, SEXP input_sim_paramsSEXP, SEXP input_model_paramsSEXP, SEXP weightsSEXP, SEXP distanceSEXP, SEXP nparticlesSEXP, SEXP ngenerationsSEXP, SEXP quantileSEXP, SEXP min_acceptanceSEXP, SEXP log_scaleSEXP, SEXP nthreadsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< std::string >::type model(modelSEXP);
+    Rcpp::traits::input_parameter< DataFrame >::type input_df(input_dfSEXP);
+    Rcpp::traits::input_parameter< DataFrame >::type data(dataSEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type lower(lowerSEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type upper(upperSEXP);
+    Rcpp::traits::input_parameter< List >::type input_sim_params(input_sim_paramsSEXP);
+    Rcpp::traits::input_parameter< List >::type input_model_params(input_model_paramsSEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type weights(weightsSEXP);
+    Rcpp::traits::input_parameter< std::string >::type distance(distanceSEXP);
+    Rcpp::traits::input_parameter< int >::type nparticles(nparticlesSEXP);
+    Rcpp::traits::input_parameter< int >::type ngenerations(ngenerationsSEXP);
+    Rcpp::traits::input_parameter< double >::type quantile(quantileSEXP);
+    Rcpp::traits::input_parameter< double >::type min_acceptance(min_acceptanceSEXP);
+    Rcpp::traits::input_parameter< bool >::type log_scale(log_scaleSEXP);
+    Rcpp::traits::input_parameter< int >::type nthreads(nthreadsSEXP);
+    rcpp_result_gen = Rcpp::wrap(abc_smc(model, input_df, data, lower, upper, input_sim_params, input_model_params, weights, distance, nparticles, ngenerations, quantile, min_acceptance, log_scale, nthreads));
+    return rcpp_result_gen;
+END_RCPP
+}
+// sim_ensemble_adaptive
+List sim_ensemble_adaptive(std::string model, DataFrame input_df, List input_sim_params, List input_model_params, CharacterVector species, double target, bool relative, NumericVector window, double confidence, int batch_size, int min_replicates, int max_replicates, int nthreads);
+RcppExport SEXP _CalciumModelsLibrary_sim_ensemble_adaptive(SEXP modelSEXP, SEXP input_dfSEXP, SEXP input_sim_paramsSEXP, SEXP input_model_paramsSEXP, SEXP speciesSEXP, SEXP targetSEXP, SEXP relativeSEXP, SEXP windowSEXP, SEXP confidenceSEXP, SEXP batch_sizeSEXP, SEXP min_replicatesSEXP, SEXP max_replicatesSEXP, SEXP nthreadsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< std::string >::type model(modelSEXP);
+    Rcpp::traits::input_parameter< DataFrame >::type input_df(input_dfSEXP);
+    Rcpp::traits::input_parameter< List >::type input_sim_params(input_sim_paramsSEXP);
+    Rcpp::traits::input_parameter< List >::type input_model_params(input_model_paramsSEXP);
+    Rcpp::traits::input_parameter< CharacterVector >::type species(speciesSEXP);
+    Rcpp::traits::input_parameter< double >::type target(targetSEXP);
+    Rcpp::traits::input_parameter< bool >::type relative(relativeSEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type window(windowSEXP);
+    Rcpp::traits::input_parameter< double >::type confidence(confidenceSEXP);
+    Rcpp::traits::input_parameter< int >::type batch_size(batch_sizeSEXP);
+    Rcpp::traits::input_parameter< int >::type min_replicates(min_replicatesSEXP);
+    Rcpp::traits::input_parameter< int >::type max_replicates(max_replicatesSEXP);
+    Rcpp::traits::input_parameter< int >::type nthreads(nthreadsSEXP);
+    rcpp_result_gen = Rcpp::wrap(sim_ensemble_adaptive(model, input_df, input_sim_params, input_model_params, species, target, relative, window, confidence, batch_size, min_replicates, max_replicates, nthreads));
+    return rcpp_result_gen;
+END_RCPP
+}
 // sim_ano
 DataFrame sim_ano(DataFrame user_input_df, List user_sim_params, List user_model_params);
 RcppExport SEXP _CalciumModelsLibrary_sim_ano(SEXP user_input_dfSEXP, SEXP user_sim_paramsSEXP, SEXP user_model_paramsSEXP) {
@@ -18,6 +66,89 @@ BEGIN_RCPP
     return rcpp_result_gen;
 END_RCPP
 }
+// detSim_ano
+DataFrame detSim_ano(DataFrame input_df, List input_sim_params, List input_model_params);
+RcppExport SEXP _CalciumModelsLibrary_detSim_ano(SEXP input_dfSEXP, SEXP input_sim_paramsSEXP, SEXP input_model_paramsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< DataFrame >::type input_df(input_dfSEXP);
+    Rcpp::traits::input_parameter< List >::type input_sim_params(input_sim_paramsSEXP);
+    Rcpp::traits::input_parameter< List >::type input_model_params(input_model_paramsSEXP);
+    rcpp_result_gen = Rcpp::wrap(detSim_ano(input_df, input_sim_params, input_model_params));
+    return rcpp_result_gen;
+END_RCPP
+}
+// sim_async
+SEXP sim_async(SEXP model, DataFrame input_df, List input_sim_params, List input_model_params, int nreplicates);
+RcppExport SEXP _CalciumModelsLibrary_sim_async(SEXP modelSEXP, SEXP input_dfSEXP, SEXP input_sim_paramsSEXP, SEXP input_model_paramsSEXP, SEXP nreplicatesSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type model(modelSEXP);
+    Rcpp::traits::input_parameter< DataFrame >::type input_df(input_dfSEXP);
+    Rcpp::traits::input_parameter< List >::type input_sim_params(input_sim_paramsSEXP);
+    Rcpp::traits::input_parameter< List >::type input_model_params(input_model_paramsSEXP);
+    Rcpp::traits::input_parameter< int >::type nreplicates(nreplicatesSEXP);
+    rcpp_result_gen = Rcpp::wrap(sim_async(model, input_df, input_sim_params, input_model_params, nreplicates));
+    return rcpp_result_gen;
+END_RCPP
+}
+// status
+std::string status(SEXP job);
+RcppExport SEXP _CalciumModelsLibrary_status(SEXP jobSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type job(jobSEXP);
+    rcpp_result_gen = Rcpp::wrap(status(job));
+    return rcpp_result_gen;
+END_RCPP
+}
+// progress
+double progress(SEXP job);
+RcppExport SEXP _CalciumModelsLibrary_progress(SEXP jobSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type job(jobSEXP);
+    rcpp_result_gen = Rcpp::wrap(progress(job));
+    return rcpp_result_gen;
+END_RCPP
+}
+// partial_result
+DataFrame partial_result(SEXP job);
+RcppExport SEXP _CalciumModelsLibrary_partial_result(SEXP jobSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type job(jobSEXP);
+    rcpp_result_gen = Rcpp::wrap(partial_result(job));
+    return rcpp_result_gen;
+END_RCPP
+}
+// cancel
+void cancel(SEXP job);
+RcppExport SEXP _CalciumModelsLibrary_cancel(SEXP jobSEXP) {
+BEGIN_RCPP
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type job(jobSEXP);
+    cancel(job);
+    return R_NilValue;
+END_RCPP
+}
+// result
+DataFrame result(SEXP job, bool wait);
+RcppExport SEXP _CalciumModelsLibrary_result(SEXP jobSEXP, SEXP waitSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type job(jobSEXP);
+    Rcpp::traits::input_parameter< bool >::type wait(waitSEXP);
+    rcpp_result_gen = Rcpp::wrap(result(job, wait));
+    return rcpp_result_gen;
+END_RCPP
+}
 // sim_calcineurin
 DataFrame sim_calcineurin(DataFrame user_input_df, List user_sim_params, List user_model_params);
 RcppExport SEXP _CalciumModelsLibrary_sim_calcineurin(SEXP user_input_dfSEXP, SEXP user_sim_paramsSEXP, SEXP user_model_paramsSEXP) {
@@ -31,6 +162,19 @@ BEGIN_RCPP
     return rcpp_result_gen;
 END_RCPP
 }
+// detSim_calcineurin
+DataFrame detSim_calcineurin(DataFrame input_df, List input_sim_params, List input_model_params);
+RcppExport SEXP _CalciumModelsLibrary_detSim_calcineurin(SEXP input_dfSEXP, SEXP input_sim_paramsSEXP, SEXP input_model_paramsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< DataFrame >::type input_df(input_dfSEXP);
+    Rcpp::traits::input_parameter< List >::type input_sim_params(input_sim_paramsSEXP);
+    Rcpp::traits::input_parameter< List >::type input_model_params(input_model_paramsSEXP);
+    rcpp_result_gen = Rcpp::wrap(detSim_calcineurin(input_df, input_sim_params, input_model_params));
+    return rcpp_result_gen;
+END_RCPP
+}
 // sim_calmodulin
 DataFrame sim_calmodulin(DataFrame user_input_df, List user_sim_params, List user_model_params);
 RcppExport SEXP _CalciumModelsLibrary_sim_calmodulin(SEXP user_input_dfSEXP, SEXP user_sim_paramsSEXP, SEXP user_model_paramsSEXP) {
@@ -44,6 +188,19 @@ BEGIN_RCPP
     return rcpp_result_gen;
 END_RCPP
 }
+// detSim_calmodulin
+DataFrame detSim_calmodulin(DataFrame input_df, List input_sim_params, List input_model_params);
+RcppExport SEXP _CalciumModelsLibrary_detSim_calmodulin(SEXP input_dfSEXP, SEXP input_sim_paramsSEXP, SEXP input_model_paramsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< DataFrame >::type input_df(input_dfSEXP);
+    Rcpp::traits::input_parameter< List >::type input_sim_params(input_sim_paramsSEXP);
+    Rcpp::traits::input_parameter< List >::type input_model_params(input_model_paramsSEXP);
+    rcpp_result_gen = Rcpp::wrap(detSim_calmodulin(input_df, input_sim_params, input_model_params));
+    return rcpp_result_gen;
+END_RCPP
+}
 // sim_camkii
 DataFrame sim_camkii(DataFrame user_input_df, List user_sim_params, List user_model_params);
 RcppExport SEXP _CalciumModelsLibrary_sim_camkii(SEXP user_input_dfSEXP, SEXP user_sim_paramsSEXP, SEXP user_model_paramsSEXP) {
@@ -57,6 +214,247 @@ BEGIN_RCPP
     return rcpp_result_gen;
 END_RCPP
 }
+// detSim_camkii
+DataFrame detSim_camkii(DataFrame input_df, List input_sim_params, List input_model_params);
+RcppExport SEXP _CalciumModelsLibrary_detSim_camkii(SEXP input_dfSEXP, SEXP input_sim_paramsSEXP, SEXP input_model_paramsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< DataFrame >::type input_df(input_dfSEXP);
+    Rcpp::traits::input_parameter< List >::type input_sim_params(input_sim_paramsSEXP);
+    Rcpp::traits::input_parameter< List >::type input_model_params(input_model_paramsSEXP);
+    rcpp_result_gen = Rcpp::wrap(detSim_camkii(input_df, input_sim_params, input_model_params));
+    return rcpp_result_gen;
+END_RCPP
+}
+// sim_checkpointed
+DataFrame sim_checkpointed(std::string model, DataFrame input_df, List input_sim_params, List input_model_params, std::string checkpoint_file);
+RcppExport SEXP _CalciumModelsLibrary_sim_checkpointed(SEXP modelSEXP, SEXP input_dfSEXP, SEXP input_sim_paramsSEXP, SEXP input_model_paramsSEXP, SEXP checkpoint_fileSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< std::string >::type model(modelSEXP);
+    Rcpp::traits::input_parameter< DataFrame >::type input_df(input_dfSEXP);
+    Rcpp::traits::input_parameter< List >::type input_sim_params(input_sim_paramsSEXP);
+    Rcpp::traits::input_parameter< List >::type input_model_params(input_model_paramsSEXP);
+    Rcpp::traits::input_parameter< std::string >::type checkpoint_file(checkpoint_fileSEXP);
+    rcpp_result_gen = Rcpp::wrap(sim_checkpointed(model, input_df, input_sim_params, input_model_params, checkpoint_file));
+    return rcpp_result_gen;
+END_RCPP
+}
+// sim_fork
+DataFrame sim_fork(std::string model, std::string checkpoint_file, DataFrame input_df, List input_sim_params, List input_model_params, int nreplicates);
+RcppExport SEXP _CalciumModelsLibrary_sim_fork(SEXP modelSEXP, SEXP checkpoint_fileSEXP, SEXP input_dfSEXP, SEXP input_sim_paramsSEXP, SEXP input_model_paramsSEXP, SEXP nreplicatesSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< std::string >::type model(modelSEXP);
+    Rcpp::traits::input_parameter< std::string >::type checkpoint_file(checkpoint_fileSEXP);
+    Rcpp::traits::input_parameter< DataFrame >::type input_df(input_dfSEXP);
+    Rcpp::traits::input_parameter< List >::type input_sim_params(input_sim_paramsSEXP);
+    Rcpp::traits::input_parameter< List >::type input_model_params(input_model_paramsSEXP);
+    Rcpp::traits::input_parameter< int >::type nreplicates(nreplicatesSEXP);
+    rcpp_result_gen = Rcpp::wrap(sim_fork(model, checkpoint_file, input_df, input_sim_params, input_model_params, nreplicates));
+    return rcpp_result_gen;
+END_RCPP
+}
+// sim_file_open
+SEXP sim_file_open(std::string path);
+RcppExport SEXP _CalciumModelsLibrary_sim_file_open(SEXP pathSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< std::string >::type path(pathSEXP);
+    rcpp_result_gen = Rcpp::wrap(sim_file_open(path));
+    return rcpp_result_gen;
+END_RCPP
+}
+// sim_file_read
+DataFrame sim_file_read(SEXP file, CharacterVector columns, double from, double to);
+RcppExport SEXP _CalciumModelsLibrary_sim_file_read(SEXP fileSEXP, SEXP columnsSEXP, SEXP fromSEXP, SEXP toSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type file(fileSEXP);
+    Rcpp::traits::input_parameter< CharacterVector >::type columns(columnsSEXP);
+    Rcpp::traits::input_parameter< double >::type from(fromSEXP);
+    Rcpp::traits::input_parameter< double >::type to(toSEXP);
+    rcpp_result_gen = Rcpp::wrap(sim_file_read(file, columns, from, to));
+    return rcpp_result_gen;
+END_RCPP
+}
+// sim_ensemble_file
+SEXP sim_ensemble_file(std::string model, DataFrame input_df, List input_sim_params, List input_model_params, std::string path, int nreplicates, int chunk_replicates, std::string precision, bool compression);
+RcppExport SEXP _CalciumModelsLibrary_sim_ensemble_file(SEXP modelSEXP, SEXP input_dfSEXP, SEXP input_sim_paramsSEXP, SEXP input_model_paramsSEXP, SEXP pathSEXP, SEXP nreplicatesSEXP, SEXP chunk_replicatesSEXP, SEXP precisionSEXP, SEXP compressionSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< std::string >::type model(modelSEXP);
+    Rcpp::traits::input_parameter< DataFrame >::type input_df(input_dfSEXP);
+    Rcpp::traits::input_parameter< List >::type input_sim_params(input_sim_paramsSEXP);
+    Rcpp::traits::input_parameter< List >::type input_model_params(input_model_paramsSEXP);
+    Rcpp::traits::input_parameter< std::string >::type path(pathSEXP);
+    Rcpp::traits::input_parameter< int >::type nreplicates(nreplicatesSEXP);
+    Rcpp::traits::input_parameter< int >::type chunk_replicates(chunk_replicatesSEXP);
+    Rcpp::traits::input_parameter< std::string >::type precision(precisionSEXP);
+    Rcpp::traits::input_parameter< bool >::type compression(compressionSEXP);
+    rcpp_result_gen = Rcpp::wrap(sim_ensemble_file(model, input_df, input_sim_params, input_model_params, path, nreplicates, chunk_replicates, precision, compression));
+    return rcpp_result_gen;
+END_RCPP
+}
+// compile_model
+SEXP compile_model(std::string model, NumericVector params, NumericVector vols, NumericVector init_conc);
+RcppExport SEXP _CalciumModelsLibrary_compile_model(SEXP modelSEXP, SEXP paramsSEXP, SEXP volsSEXP, SEXP init_concSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< std::string >::type model(modelSEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type params(paramsSEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type vols(volsSEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type init_conc(init_concSEXP);
+    rcpp_result_gen = Rcpp::wrap(compile_model(model, params, vols, init_conc));
+    return rcpp_result_gen;
+END_RCPP
+}
+// run
+DataFrame run(SEXP model, DataFrame input_df, List sim_params, SEXP seed, int nreplicates);
+RcppExport SEXP _CalciumModelsLibrary_run(SEXP modelSEXP, SEXP input_dfSEXP, SEXP sim_paramsSEXP, SEXP seedSEXP, SEXP nreplicatesSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type model(modelSEXP);
+    Rcpp::traits::input_parameter< DataFrame >::type input_df(input_dfSEXP);
+    Rcpp::traits::input_parameter< List >::type sim_params(sim_paramsSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type seed(seedSEXP);
+    Rcpp::traits::input_parameter< int >::type nreplicates(nreplicatesSEXP);
+    rcpp_result_gen = Rcpp::wrap(run(model, input_df, sim_params, seed, nreplicates));
+    return rcpp_result_gen;
+END_RCPP
+}
+// sim_ensemble
+DataFrame sim_ensemble(std::string model, DataFrame input_df, List input_sim_params, List input_model_params, int nreplicates);
+RcppExport SEXP _CalciumModelsLibrary_sim_ensemble(SEXP modelSEXP, SEXP input_dfSEXP, SEXP input_sim_paramsSEXP, SEXP input_model_paramsSEXP, SEXP nreplicatesSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< std::string >::type model(modelSEXP);
+    Rcpp::traits::input_parameter< DataFrame >::type input_df(input_dfSEXP);
+    Rcpp::traits::input_parameter< List >::type input_sim_params(input_sim_paramsSEXP);
+    Rcpp::traits::input_parameter< List >::type input_model_params(input_model_paramsSEXP);
+    Rcpp::traits::input_parameter< int >::type nreplicates(nreplicatesSEXP);
+    rcpp_result_gen = Rcpp::wrap(sim_ensemble(model, input_df, input_sim_params, input_model_params, nreplicates));
+    return rcpp_result_gen;
+END_RCPP
+}
+// sim_events
+List sim_events(std::string model, DataFrame input_df, List input_sim_params, List input_model_params, int nreplicates, double resolution, int nthreads);
+RcppExport SEXP _CalciumModelsLibrary_sim_events(SEXP modelSEXP, SEXP input_dfSEXP, SEXP input_sim_paramsSEXP, SEXP input_model_paramsSEXP, SEXP nreplicatesSEXP, SEXP resolutionSEXP, SEXP nthreadsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< std::string >::type model(modelSEXP);
+    Rcpp::traits::input_parameter< DataFrame >::type input_df(input_dfSEXP);
+    Rcpp::traits::input_parameter< List >::type input_sim_params(input_sim_paramsSEXP);
+    Rcpp::traits::input_parameter< List >::type input_model_params(input_model_paramsSEXP);
+    Rcpp::traits::input_parameter< int >::type nreplicates(nreplicatesSEXP);
+    Rcpp::traits::input_parameter< double >::type resolution(resolutionSEXP);
+    Rcpp::traits::input_parameter< int >::type nthreads(nthreadsSEXP);
+    rcpp_result_gen = Rcpp::wrap(sim_events(model, input_df, input_sim_params, input_model_params, nreplicates, resolution, nthreads));
+    return rcpp_result_gen;
+END_RCPP
+}
+// sim_events_sample
+DataFrame sim_events_sample(List events, NumericVector times, CharacterVector species, int nthreads);
+RcppExport SEXP _CalciumModelsLibrary_sim_events_sample(SEXP eventsSEXP, SEXP timesSEXP, SEXP speciesSEXP, SEXP nthreadsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< List >::type events(eventsSEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type times(timesSEXP);
+    Rcpp::traits::input_parameter< CharacterVector >::type species(speciesSEXP);
+    Rcpp::traits::input_parameter< int >::type nthreads(nthreadsSEXP);
+    rcpp_result_gen = Rcpp::wrap(sim_events_sample(events, times, species, nthreads));
+    return rcpp_result_gen;
+END_RCPP
+}
+// sim_events_average
+DataFrame sim_events_average(List events, double from, double to, CharacterVector species, int nthreads);
+RcppExport SEXP _CalciumModelsLibrary_sim_events_average(SEXP eventsSEXP, SEXP fromSEXP, SEXP toSEXP, SEXP speciesSEXP, SEXP nthreadsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< List >::type events(eventsSEXP);
+    Rcpp::traits::input_parameter< double >::type from(fromSEXP);
+    Rcpp::traits::input_parameter< double >::type to(toSEXP);
+    Rcpp::traits::input_parameter< CharacterVector >::type species(speciesSEXP);
+    Rcpp::traits::input_parameter< int >::type nthreads(nthreadsSEXP);
+    rcpp_result_gen = Rcpp::wrap(sim_events_average(events, from, to, species, nthreads));
+    return rcpp_result_gen;
+END_RCPP
+}
+// first_passage
+DataFrame first_passage(std::string model, DataFrame input_df, List input_sim_params, List input_model_params, List conditions, int nreplicates, int nthreads);
+RcppExport SEXP _CalciumModelsLibrary_first_passage(SEXP modelSEXP, SEXP input_dfSEXP, SEXP input_sim_paramsSEXP, SEXP input_model_paramsSEXP, SEXP conditionsSEXP, SEXP nreplicatesSEXP, SEXP nthreadsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< std::string >::type model(modelSEXP);
+    Rcpp::traits::input_parameter< DataFrame >::type input_df(input_dfSEXP);
+    Rcpp::traits::input_parameter< List >::type input_sim_params(input_sim_paramsSEXP);
+    Rcpp::traits::input_parameter< List >::type input_model_params(input_model_paramsSEXP);
+    Rcpp::traits::input_parameter< List >::type conditions(conditionsSEXP);
+    Rcpp::traits::input_parameter< int >::type nreplicates(nreplicatesSEXP);
+    Rcpp::traits::input_parameter< int >::type nthreads(nthreadsSEXP);
+    rcpp_result_gen = Rcpp::wrap(first_passage(model, input_df, input_sim_params, input_model_params, conditions, nreplicates, nthreads));
+    return rcpp_result_gen;
+END_RCPP
+}
+// fit_model
+List fit_model(std::string model, DataFrame input_df, DataFrame data, CharacterVector params, List input_sim_params, List input_model_params, NumericVector weights, bool log_scale, int max_iterations, double tolerance);
+RcppExport SEXP _CalciumModelsLibrary_fit_model(SEXP modelSEXP, SEXP input_dfSEXP, SEXP dataSEXP, SEXP paramsSEXP, SEXP input_sim_paramsSEXP, SEXP input_model_paramsSEXP, SEXP weightsSEXP, SEXP log_scaleSEXP, SEXP max_iterationsSEXP, SEXP toleranceSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< std::string >::type model(modelSEXP);
+    Rcpp::traits::input_parameter< DataFrame >::type input_df(input_dfSEXP);
+    Rcpp::traits::input_parameter< DataFrame >::type data(dataSEXP);
+    Rcpp::traits::input_parameter< CharacterVector >::type params(paramsSEXP);
+    Rcpp::traits::input_parameter< List >::type input_sim_params(input_sim_paramsSEXP);
+    Rcpp::traits::input_parameter< List >::type input_model_params(input_model_paramsSEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type weights(weightsSEXP);
+    Rcpp::traits::input_parameter< bool >::type log_scale(log_scaleSEXP);
+    Rcpp::traits::input_parameter< int >::type max_iterations(max_iterationsSEXP);
+    Rcpp::traits::input_parameter< double >::type tolerance(toleranceSEXP);
+    rcpp_result_gen = Rcpp::wrap(fit_model(model, input_df, data, params, input_sim_params, input_model_params, weights, log_scale, max_iterations, tolerance));
+    return rcpp_result_gen;
+END_RCPP
+}
+// sim_frequency_response
+DataFrame sim_frequency_response(CharacterVector models, NumericVector frequencies, NumericVector amplitudes, NumericVector duty, CharacterVector species, List input_sim_params, List input_model_params, std::string waveform, double baseline, std::string method, int nreplicates, int samples_per_cycle, int max_cycles, double tolerance, double tau, int nthreads);
+RcppExport SEXP _CalciumModelsLibrary_sim_frequency_response(SEXP modelsSEXP, SEXP frequenciesSEXP, SEXP amplitudesSEXP, SEXP dutySEXP, SEXP speciesSEXP, SEXP input_sim_paramsSEXP, SEXP input_model_paramsSEXP, SEXP waveformSEXP, SEXP baselineSEXP, SEXP methodSEXP, SEXP nreplicatesSEXP, SEXP samples_per_cycleSEXP, SEXP max_cyclesSEXP, SEXP toleranceSEXP, SEXP tauSEXP, SEXP nthreadsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< CharacterVector >::type models(modelsSEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type frequencies(frequenciesSEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type amplitudes(amplitudesSEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type duty(dutySEXP);
+    Rcpp::traits::input_parameter< CharacterVector >::type species(speciesSEXP);
+    Rcpp::traits::input_parameter< List >::type input_sim_params(input_sim_paramsSEXP);
+    Rcpp::traits::input_parameter< List >::type input_model_params(input_model_paramsSEXP);
+    Rcpp::traits::input_parameter< std::string >::type waveform(waveformSEXP);
+    Rcpp::traits::input_parameter< double >::type baseline(baselineSEXP);
+    Rcpp::traits::input_parameter< std::string >::type method(methodSEXP);
+    Rcpp::traits::input_parameter< int >::type nreplicates(nreplicatesSEXP);
+    Rcpp::traits::input_parameter< int >::type samples_per_cycle(samples_per_cycleSEXP);
+    Rcpp::traits::input_parameter< int >::type max_cycles(max_cyclesSEXP);
+    Rcpp::traits::input_parameter< double >::type tolerance(toleranceSEXP);
+    Rcpp::traits::input_parameter< double >::type tau(tauSEXP);
+    Rcpp::traits::input_parameter< int >::type nthreads(nthreadsSEXP);
+    rcpp_result_gen = Rcpp::wrap(sim_frequency_response(models, frequencies, amplitudes, duty, species, input_sim_params, input_model_params, waveform, baseline, method, nreplicates, samples_per_cycle, max_cycles, tolerance, tau, nthreads));
+    return rcpp_result_gen;
+END_RCPP
+}
 // sim_glycphos
 DataFrame sim_glycphos(DataFrame user_input_df, List user_sim_params, List user_model_params);
 RcppExport SEXP _CalciumModelsLibrary_sim_glycphos(SEXP user_input_dfSEXP, SEXP user_sim_paramsSEXP, SEXP user_model_paramsSEXP) {
@@ -70,6 +468,42 @@ BEGIN_RCPP
     return rcpp_result_gen;
 END_RCPP
 }
+// detSim_glycphos
+DataFrame detSim_glycphos(DataFrame input_df, List input_sim_params, List input_model_params);
+RcppExport SEXP _CalciumModelsLibrary_detSim_glycphos(SEXP input_dfSEXP, SEXP input_sim_paramsSEXP, SEXP input_model_paramsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< DataFrame >::type input_df(input_dfSEXP);
+    Rcpp::traits::input_parameter< List >::type input_sim_params(input_sim_paramsSEXP);
+    Rcpp::traits::input_parameter< List >::type input_model_params(input_model_paramsSEXP);
+    rcpp_result_gen = Rcpp::wrap(detSim_glycphos(input_df, input_sim_params, input_model_params));
+    return rcpp_result_gen;
+END_RCPP
+}
+// mlmc_expectation
+List mlmc_expectation(std::string model, DataFrame input_df, List input_sim_params, List input_model_params, std::string species, double rmse, std::string statistic, double tau, int refinement, int nlevels, int pilot_samples, int max_samples, int nthreads);
+RcppExport SEXP _CalciumModelsLibrary_mlmc_expectation(SEXP modelSEXP, SEXP input_dfSEXP, SEXP input_sim_paramsSEXP, SEXP input_model_paramsSEXP, SEXP speciesSEXP, SEXP rmseSEXP, SEXP statisticSEXP, SEXP tauSEXP, SEXP refinementSEXP, SEXP nlevelsSEXP, SEXP pilot_samplesSEXP, SEXP max_samplesSEXP, SEXP nthreadsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< std::string >::type model(modelSEXP);
+    Rcpp::traits::input_parameter< DataFrame >::type input_df(input_dfSEXP);
+    Rcpp::traits::input_parameter< List >::type input_sim_params(input_sim_paramsSEXP);
+    Rcpp::traits::input_parameter< List >::type input_model_params(input_model_paramsSEXP);
+    Rcpp::traits::input_parameter< std::string >::type species(speciesSEXP);
+    Rcpp::traits::input_parameter< double >::type rmse(rmseSEXP);
+    Rcpp::traits::input_parameter< std::string >::type statistic(statisticSEXP);
+    Rcpp::traits::input_parameter< double >::type tau(tauSEXP);
+    Rcpp::traits::input_parameter< int >::type refinement(refinementSEXP);
+    Rcpp::traits::input_parameter< int >::type nlevels(nlevelsSEXP);
+    Rcpp::traits::input_parameter< int >::type pilot_samples(pilot_samplesSEXP);
+    Rcpp::traits::input_parameter< int >::type max_samples(max_samplesSEXP);
+    Rcpp::traits::input_parameter< int >::type nthreads(nthreadsSEXP);
+    rcpp_result_gen = Rcpp::wrap(mlmc_expectation(model, input_df, input_sim_params, input_model_params, species, rmse, statistic, tau, refinement, nlevels, pilot_samples, max_samples, nthreads));
+    return rcpp_result_gen;
+END_RCPP
+}
 // sim_pkc
 DataFrame sim_pkc(DataFrame user_input_df, List user_sim_params, List user_model_params);
 RcppExport SEXP _CalciumModelsLibrary_sim_pkc(SEXP user_input_dfSEXP, SEXP user_sim_paramsSEXP, SEXP user_model_paramsSEXP) {
@@ -83,18 +517,278 @@ BEGIN_RCPP
     return rcpp_result_gen;
 END_RCPP
 }
+// detSim_pkc
+DataFrame detSim_pkc(DataFrame input_df, List input_sim_params, List input_model_params);
+RcppExport SEXP _CalciumModelsLibrary_detSim_pkc(SEXP input_dfSEXP, SEXP input_sim_paramsSEXP, SEXP input_model_paramsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< DataFrame >::type input_df(input_dfSEXP);
+    Rcpp::traits::input_parameter< List >::type input_sim_params(input_sim_paramsSEXP);
+    Rcpp::traits::input_parameter< List >::type input_model_params(input_model_paramsSEXP);
+    rcpp_result_gen = Rcpp::wrap(detSim_pkc(input_df, input_sim_params, input_model_params));
+    return rcpp_result_gen;
+END_RCPP
+}
+// rare_event_probability
+List rare_event_probability(std::string model, DataFrame input_df, List input_sim_params, List input_model_params, SEXP coordinate, double target, NumericVector levels, int nparticles, int nrepeats, double pilot_quantile, int max_levels, int nthreads);
+RcppExport SEXP _CalciumModelsLibrary_rare_event_probability(SEXP modelSEXP, SEXP input_dfSEXP, SEXP input_sim_paramsSEXP, SEXP input_model_paramsSEXP, SEXP coordinateSEXP, SEXP targetSEXP, SEXP levelsSEXP, SEXP nparticlesSEXP, SEXP nrepeatsSEXP, SEXP pilot_quantileSEXP, SEXP max_levelsSEXP, SEXP nthreadsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< std::string >::type model(modelSEXP);
+    Rcpp::traits::input_parameter< DataFrame >::type input_df(input_dfSEXP);
+    Rcpp::traits::input_parameter< List >::type input_sim_params(input_sim_paramsSEXP);
+    Rcpp::traits::input_parameter< List >::type input_model_params(input_model_paramsSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type coordinate(coordinateSEXP);
+    Rcpp::traits::input_parameter< double >::type target(targetSEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type levels(levelsSEXP);
+    Rcpp::traits::input_parameter< int >::type nparticles(nparticlesSEXP);
+    Rcpp::traits::input_parameter< int >::type nrepeats(nrepeatsSEXP);
+    Rcpp::traits::input_parameter< double >::type pilot_quantile(pilot_quantileSEXP);
+    Rcpp::traits::input_parameter< int >::type max_levels(max_levelsSEXP);
+    Rcpp::traits::input_parameter< int >::type nthreads(nthreadsSEXP);
+    rcpp_result_gen = Rcpp::wrap(rare_event_probability(model, input_df, input_sim_params, input_model_params, coordinate, target, levels, nparticles, nrepeats, pilot_quantile, max_levels, nthreads));
+    return rcpp_result_gen;
+END_RCPP
+}
+// sim_cache
+List sim_cache(std::string directory, double max_size);
+RcppExport SEXP _CalciumModelsLibrary_sim_cache(SEXP directorySEXP, SEXP max_sizeSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< std::string >::type directory(directorySEXP);
+    Rcpp::traits::input_parameter< double >::type max_size(max_sizeSEXP);
+    rcpp_result_gen = Rcpp::wrap(sim_cache(directory, max_size));
+    return rcpp_result_gen;
+END_RCPP
+}
+// sim_cache_info
+List sim_cache_info();
+RcppExport SEXP _CalciumModelsLibrary_sim_cache_info() {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    rcpp_result_gen = Rcpp::wrap(sim_cache_info());
+    return rcpp_result_gen;
+END_RCPP
+}
+// sim_cache_clear
+int sim_cache_clear();
+RcppExport SEXP _CalciumModelsLibrary_sim_cache_clear() {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    rcpp_result_gen = Rcpp::wrap(sim_cache_clear());
+    return rcpp_result_gen;
+END_RCPP
+}
+// sim_resample
+DataFrame sim_resample(DataFrame result, NumericVector times, std::string method);
+RcppExport SEXP _CalciumModelsLibrary_sim_resample(SEXP resultSEXP, SEXP timesSEXP, SEXP methodSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< DataFrame >::type result(resultSEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type times(timesSEXP);
+    Rcpp::traits::input_parameter< std::string >::type method(methodSEXP);
+    rcpp_result_gen = Rcpp::wrap(sim_resample(result, times, method));
+    return rcpp_result_gen;
+END_RCPP
+}
+// sobol_sensitivity
+List sobol_sensitivity(std::string model, DataFrame input_df, List input_sim_params, List input_model_params, NumericVector lower, NumericVector upper, std::string species, std::string statistic, std::string method, int nsamples, int nboot, int nreplicates, int nthreads);
+RcppExport SEXP _CalciumModelsLibrary_sobol_sensitivity(SEXP modelSEXP, SEXP input_dfSEXP, SEXP input_sim_paramsSEXP, SEXP input_model_paramsSEXP, SEXP lowerSEXP, SEXP upperSEXP, SEXP speciesSEXP, SEXP statisticSEXP, SEXP methodSEXP, SEXP nsamplesSEXP, SEXP nbootSEXP, SEXP nreplicatesSEXP, SEXP nthreadsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< std::string >::type model(modelSEXP);
+    Rcpp::traits::input_parameter< DataFrame >::type input_df(input_dfSEXP);
+    Rcpp::traits::input_parameter< List >::type input_sim_params(input_sim_paramsSEXP);
+    Rcpp::traits::input_parameter< List >::type input_model_params(input_model_paramsSEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type lower(lowerSEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type upper(upperSEXP);
+    Rcpp::traits::input_parameter< std::string >::type species(speciesSEXP);
+    Rcpp::traits::input_parameter< std::string >::type statistic(statisticSEXP);
+    Rcpp::traits::input_parameter< std::string >::type method(methodSEXP);
+    Rcpp::traits::input_parameter< int >::type nsamples(nsamplesSEXP);
+    Rcpp::traits::input_parameter< int >::type nboot(nbootSEXP);
+    Rcpp::traits::input_parameter< int >::type nreplicates(nreplicatesSEXP);
+    Rcpp::traits::input_parameter< int >::type nthreads(nthreadsSEXP);
+    rcpp_result_gen = Rcpp::wrap(sobol_sensitivity(model, input_df, input_sim_params, input_model_params, lower, upper, species, statistic, method, nsamples, nboot, nreplicates, nthreads));
+    return rcpp_result_gen;
+END_RCPP
+}
+// sim_sensitivity
+List sim_sensitivity(std::string model, DataFrame input_df, List input_sim_params, List input_model_params, CharacterVector params, int nreplicates, double rel_step, int nthreads);
+RcppExport SEXP _CalciumModelsLibrary_sim_sensitivity(SEXP modelSEXP, SEXP input_dfSEXP, SEXP input_sim_paramsSEXP, SEXP input_model_paramsSEXP, SEXP paramsSEXP, SEXP nreplicatesSEXP, SEXP rel_stepSEXP, SEXP nthreadsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< std::string >::type model(modelSEXP);
+    Rcpp::traits::input_parameter< DataFrame >::type input_df(input_dfSEXP);
+    Rcpp::traits::input_parameter< List >::type input_sim_params(input_sim_paramsSEXP);
+    Rcpp::traits::input_parameter< List >::type input_model_params(input_model_paramsSEXP);
+    Rcpp::traits::input_parameter< CharacterVector >::type params(paramsSEXP);
+    Rcpp::traits::input_parameter< int >::type nreplicates(nreplicatesSEXP);
+    Rcpp::traits::input_parameter< double >::type rel_step(rel_stepSEXP);
+    Rcpp::traits::input_parameter< int >::type nthreads(nthreadsSEXP);
+    rcpp_result_gen = Rcpp::wrap(sim_sensitivity(model, input_df, input_sim_params, input_model_params, params, nreplicates, rel_step, nthreads));
+    return rcpp_result_gen;
+END_RCPP
+}
+// ode_sensitivity
+List ode_sensitivity(std::string model, DataFrame input_df, List input_sim_params, List input_model_params, CharacterVector params);
+RcppExport SEXP _CalciumModelsLibrary_ode_sensitivity(SEXP modelSEXP, SEXP input_dfSEXP, SEXP input_sim_paramsSEXP, SEXP input_model_paramsSEXP, SEXP paramsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< std::string >::type model(modelSEXP);
+    Rcpp::traits::input_parameter< DataFrame >::type input_df(input_dfSEXP);
+    Rcpp::traits::input_parameter< List >::type input_sim_params(input_sim_paramsSEXP);
+    Rcpp::traits::input_parameter< List >::type input_model_params(input_model_paramsSEXP);
+    Rcpp::traits::input_parameter< CharacterVector >::type params(paramsSEXP);
+    rcpp_result_gen = Rcpp::wrap(ode_sensitivity(model, input_df, input_sim_params, input_model_params, params));
+    return rcpp_result_gen;
+END_RCPP
+}
+// sim_stimulus
+List sim_stimulus(std::string type, double baseline, double amplitude, double frequency, double duty, double phase, double tau, double width, double noise, double resolution, double start, double seed);
+RcppExport SEXP _CalciumModelsLibrary_sim_stimulus(SEXP typeSEXP, SEXP baselineSEXP, SEXP amplitudeSEXP, SEXP frequencySEXP, SEXP dutySEXP, SEXP phaseSEXP, SEXP tauSEXP, SEXP widthSEXP, SEXP noiseSEXP, SEXP resolutionSEXP, SEXP startSEXP, SEXP seedSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< std::string >::type type(typeSEXP);
+    Rcpp::traits::input_parameter< double >::type baseline(baselineSEXP);
+    Rcpp::traits::input_parameter< double >::type amplitude(amplitudeSEXP);
+    Rcpp::traits::input_parameter< double >::type frequency(frequencySEXP);
+    Rcpp::traits::input_parameter< double >::type duty(dutySEXP);
+    Rcpp::traits::input_parameter< double >::type phase(phaseSEXP);
+    Rcpp::traits::input_parameter< double >::type tau(tauSEXP);
+    Rcpp::traits::input_parameter< double >::type width(widthSEXP);
+    Rcpp::traits::input_parameter< double >::type noise(noiseSEXP);
+    Rcpp::traits::input_parameter< double >::type resolution(resolutionSEXP);
+    Rcpp::traits::input_parameter< double >::type start(startSEXP);
+    Rcpp::traits::input_parameter< double >::type seed(seedSEXP);
+    rcpp_result_gen = Rcpp::wrap(sim_stimulus(type, baseline, amplitude, frequency, duty, phase, tau, width, noise, resolution, start, seed));
+    return rcpp_result_gen;
+END_RCPP
+}
+// sim_stimulus_frame
+DataFrame sim_stimulus_frame(List stimulus, double end);
+RcppExport SEXP _CalciumModelsLibrary_sim_stimulus_frame(SEXP stimulusSEXP, SEXP endSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< List >::type stimulus(stimulusSEXP);
+    Rcpp::traits::input_parameter< double >::type end(endSEXP);
+    rcpp_result_gen = Rcpp::wrap(sim_stimulus_frame(stimulus, end));
+    return rcpp_result_gen;
+END_RCPP
+}
+// read_trace
+DataFrame read_trace(std::string path, CharacterVector columns, int nthreads);
+RcppExport SEXP _CalciumModelsLibrary_read_trace(SEXP pathSEXP, SEXP columnsSEXP, SEXP nthreadsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< std::string >::type path(pathSEXP);
+    Rcpp::traits::input_parameter< CharacterVector >::type columns(columnsSEXP);
+    Rcpp::traits::input_parameter< int >::type nthreads(nthreadsSEXP);
+    rcpp_result_gen = Rcpp::wrap(read_trace(path, columns, nthreads));
+    return rcpp_result_gen;
+END_RCPP
+}
+// sim_trace
+DataFrame sim_trace(std::string model, std::string path, List input_sim_params, List input_model_params, CharacterVector columns, double block_mb, int nthreads);
+RcppExport SEXP _CalciumModelsLibrary_sim_trace(SEXP modelSEXP, SEXP pathSEXP, SEXP input_sim_paramsSEXP, SEXP input_model_paramsSEXP, SEXP columnsSEXP, SEXP block_mbSEXP, SEXP nthreadsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< std::string >::type model(modelSEXP);
+    Rcpp::traits::input_parameter< std::string >::type path(pathSEXP);
+    Rcpp::traits::input_parameter< List >::type input_sim_params(input_sim_paramsSEXP);
+    Rcpp::traits::input_parameter< List >::type input_model_params(input_model_paramsSEXP);
+    Rcpp::traits::input_parameter< CharacterVector >::type columns(columnsSEXP);
+    Rcpp::traits::input_parameter< double >::type block_mb(block_mbSEXP);
+    Rcpp::traits::input_parameter< int >::type nthreads(nthreadsSEXP);
+    rcpp_result_gen = Rcpp::wrap(sim_trace(model, path, input_sim_params, input_model_params, columns, block_mb, nthreads));
+    return rcpp_result_gen;
+END_RCPP
+}
+// sim_equilibrate
+DataFrame sim_equilibrate(std::string model, double baseline_ca, List input_model_params, std::string equilibration, double burn_in, int nsamples);
+RcppExport SEXP _CalciumModelsLibrary_sim_equilibrate(SEXP modelSEXP, SEXP baseline_caSEXP, SEXP input_model_paramsSEXP, SEXP equilibrationSEXP, SEXP burn_inSEXP, SEXP nsamplesSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< std::string >::type model(modelSEXP);
+    Rcpp::traits::input_parameter< double >::type baseline_ca(baseline_caSEXP);
+    Rcpp::traits::input_parameter< List >::type input_model_params(input_model_paramsSEXP);
+    Rcpp::traits::input_parameter< std::string >::type equilibration(equilibrationSEXP);
+    Rcpp::traits::input_parameter< double >::type burn_in(burn_inSEXP);
+    Rcpp::traits::input_parameter< int >::type nsamples(nsamplesSEXP);
+    rcpp_result_gen = Rcpp::wrap(sim_equilibrate(model, baseline_ca, input_model_params, equilibration, burn_in, nsamples));
+    return rcpp_result_gen;
+END_RCPP
+}
 
 static const R_CallMethodDef CallEntries[] = {
+    {"_CalciumModelsLibrary_abc_smc", (DL_FUNC) &_CalciumModelsLibrary_abc_smc, 15},
+    {"_CalciumModelsLibrary_sim_ensemble_adaptive", (DL_FUNC) &_CalciumModelsLibrary_sim_ensemble_adaptive, 13},
     {"_CalciumModelsLibrary_sim_ano", (DL_FUNC) &_CalciumModelsLibrary_sim_ano, 3},
+    {"_CalciumModelsLibrary_detSim_ano", (DL_FUNC) &_CalciumModelsLibrary_detSim_ano, 3},
+    {"_CalciumModelsLibrary_sim_async", (DL_FUNC) &_CalciumModelsLibrary_sim_async, 5},
+    {"_CalciumModelsLibrary_status", (DL_FUNC) &_CalciumModelsLibrary_status, 1},
+    {"_CalciumModelsLibrary_progress", (DL_FUNC) &_CalciumModelsLibrary_progress, 1},
+    {"_CalciumModelsLibrary_partial_result", (DL_FUNC) &_CalciumModelsLibrary_partial_result, 1},
+    {"_CalciumModelsLibrary_cancel", (DL_FUNC) &_CalciumModelsLibrary_cancel, 1},
+    {"_CalciumModelsLibrary_result", (DL_FUNC) &_CalciumModelsLibrary_result, 2},
     {"_CalciumModelsLibrary_sim_calcineurin", (DL_FUNC) &_CalciumModelsLibrary_sim_calcineurin, 3},
+    {"_CalciumModelsLibrary_detSim_calcineurin", (DL_FUNC) &_CalciumModelsLibrary_detSim_calcineurin, 3},
     {"_CalciumModelsLibrary_sim_calmodulin", (DL_FUNC) &_CalciumModelsLibrary_sim_calmodulin, 3},
+    {"_CalciumModelsLibrary_detSim_calmodulin", (DL_FUNC) &_CalciumModelsLibrary_detSim_calmodulin, 3},
     {"_CalciumModelsLibrary_sim_camkii", (DL_FUNC) &_CalciumModelsLibrary_sim_camkii, 3},
+    {"_CalciumModelsLibrary_detSim_camkii", (DL_FUNC) &_CalciumModelsLibrary_detSim_camkii, 3},
+    {"_CalciumModelsLibrary_sim_checkpointed", (DL_FUNC) &_CalciumModelsLibrary_sim_checkpointed, 5},
+    {"_CalciumModelsLibrary_sim_fork", (DL_FUNC) &_CalciumModelsLibrary_sim_fork, 6},
+    {"_CalciumModelsLibrary_sim_file_open", (DL_FUNC) &_CalciumModelsLibrary_sim_file_open, 1},
+    {"_CalciumModelsLibrary_sim_file_read", (DL_FUNC) &_CalciumModelsLibrary_sim_file_read, 4},
+    {"_CalciumModelsLibrary_sim_ensemble_file", (DL_FUNC) &_CalciumModelsLibrary_sim_ensemble_file, 9},
+    {"_CalciumModelsLibrary_compile_model", (DL_FUNC) &_CalciumModelsLibrary_compile_model, 4},
+    {"_CalciumModelsLibrary_run", (DL_FUNC) &_CalciumModelsLibrary_run, 5},
+    {"_CalciumModelsLibrary_sim_ensemble", (DL_FUNC) &_CalciumModelsLibrary_sim_ensemble, 5},
+    {"_CalciumModelsLibrary_sim_events", (DL_FUNC) &_CalciumModelsLibrary_sim_events, 7},
+    {"_CalciumModelsLibrary_sim_events_sample", (DL_FUNC) &_CalciumModelsLibrary_sim_events_sample, 4},
+    {"_CalciumModelsLibrary_sim_events_average", (DL_FUNC) &_CalciumModelsLibrary_sim_events_average, 5},
+    {"_CalciumModelsLibrary_first_passage", (DL_FUNC) &_CalciumModelsLibrary_first_passage, 7},
+    {"_CalciumModelsLibrary_fit_model", (DL_FUNC) &_CalciumModelsLibrary_fit_model, 10},
+    {"_CalciumModelsLibrary_sim_frequency_response", (DL_FUNC) &_CalciumModelsLibrary_sim_frequency_response, 16},
     {"_CalciumModelsLibrary_sim_glycphos", (DL_FUNC) &_CalciumModelsLibrary_sim_glycphos, 3},
+    {"_CalciumModelsLibrary_detSim_glycphos", (DL_FUNC) &_CalciumModelsLibrary_detSim_glycphos, 3},
+    {"_CalciumModelsLibrary_mlmc_expectation", (DL_FUNC) &_CalciumModelsLibrary_mlmc_expectation, 13},
     {"_CalciumModelsLibrary_sim_pkc", (DL_FUNC) &_CalciumModelsLibrary_sim_pkc, 3},
+    {"_CalciumModelsLibrary_detSim_pkc", (DL_FUNC) &_CalciumModelsLibrary_detSim_pkc, 3},
+    {"_CalciumModelsLibrary_rare_event_probability", (DL_FUNC) &_CalciumModelsLibrary_rare_event_probability, 12},
+    {"_CalciumModelsLibrary_sim_cache", (DL_FUNC) &_CalciumModelsLibrary_sim_cache, 2},
+    {"_CalciumModelsLibrary_sim_cache_info", (DL_FUNC) &_CalciumModelsLibrary_sim_cache_info, 0},
+    {"_CalciumModelsLibrary_sim_cache_clear", (DL_FUNC) &_CalciumModelsLibrary_sim_cache_clear, 0},
+    {"_CalciumModelsLibrary_sim_resample", (DL_FUNC) &_CalciumModelsLibrary_sim_resample, 3},
+    {"_CalciumModelsLibrary_sobol_sensitivity", (DL_FUNC) &_CalciumModelsLibrary_sobol_sensitivity, 13},
+    {"_CalciumModelsLibrary_sim_sensitivity", (DL_FUNC) &_CalciumModelsLibrary_sim_sensitivity, 8},
+    {"_CalciumModelsLibrary_ode_sensitivity", (DL_FUNC) &_CalciumModelsLibrary_ode_sensitivity, 5},
+    {"_CalciumModelsLibrary_sim_stimulus", (DL_FUNC) &_CalciumModelsLibrary_sim_stimulus, 12},
+    {"_CalciumModelsLibrary_sim_stimulus_frame", (DL_FUNC) &_CalciumModelsLibrary_sim_stimulus_frame, 2},
+    {"_CalciumModelsLibrary_read_trace", (DL_FUNC) &_CalciumModelsLibrary_read_trace, 3},
+    {"_CalciumModelsLibrary_sim_trace", (DL_FUNC) &_CalciumModelsLibrary_sim_trace, 7},
+    {"_CalciumModelsLibrary_sim_equilibrate", (DL_FUNC) &_CalciumModelsLibrary_sim_equilibrate, 6},
     {NULL, NULL, 0}
 };
 
+void result_columns_init(DllInfo* dll);
 RcppExport void R_init_CalciumModelsLibrary(DllInfo *dll) {
     R_registerRoutines(dll, NULL, CallEntries, NULL, NULL);
     R_useDynamicSymbols(dll, FALSE);
+    result_columns_init(dll);
 }
@@ -0,0 +1,274 @@
+#include <string>
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <numeric>
+#include <Rcpp.h>
+#include "model_registry.hpp"
+#include "buffer_pool.hpp"
+#include "parallel.hpp"
+#include "sim_params.hpp"
+using namespace Rcpp;
+
+
+// Observed data of the ABC distance: weighted concentrations of species at output times (ordered by output time)
+struct abc_data {
+  std::vector<int> output, species;
+  std::vector<double> value, weight;
+  bool max_norm;   // distance: maximum instead of Euclidean norm of the weighted differences
+};
+
+// Simulates one particle and returns the distance of its trajectory to the data, or HUGE_VAL as soon as the partial distance
+// of the data points already passed exceeds the tolerance (both norms only grow with more data points, so the rejection is exact).
+// The run advances from data time to data time (until just after the time, so its output is written) and the partial distance is
+// tested at each of them; splitting the run does not change the trajectory (see ssa_simulator()).
+static double abc_distance(const model_info &info, const sim_problem &pb, const abc_data &data, double tolerance,
+                           uint64_t seed, uint64_t stream, double *out) {
+  ssa_state s = ssa_initial_state(pb, seed, stream);
+  const double limit = data.max_norm ? tolerance : tolerance * tolerance;
+  const size_t npoints = data.value.size();
+  double partial = 0.0;
+  for (size_t j = 0; j < npoints; j++) {
+    const int o = data.output[j];
+    while ((s.noutput <= o) && !s.finished(pb)) {
+      info.ssa_simulator(pb, s, std::nextafter(pb.output_times[o], HUGE_VAL), out, UINT64_MAX, 0, 0);
+    }
+    double e = data.weight[j] * (out[(size_t)o*info.nspecies + data.species[j]] - data.value[j]);
+    partial = data.max_norm ? std::max(partial, std::fabs(e)) : partial + e*e;
+    if (partial > limit) return HUGE_VAL;
+  }
+  return data.max_norm ? partial : std::sqrt(partial);
+}
+
+// Weighted variance of parameter p over the population (values z[particle*k + parameter], normalised weights w)
+static double weighted_variance(const std::vector<double> &z, const std::vector<double> &w, int k, int p) {
+  double mean = 0.0, var = 0.0;
+  for (size_t i = 0; i < w.size(); i++) mean += w[i] * z[i*k + p];
+  for (size_t i = 0; i < w.size(); i++) var += w[i] * (z[i*k + p] - mean) * (z[i*k + p] - mean);
+  return var;
+}
+
+
+//' Approximate Bayesian Computation (ABC-SMC) for the Stochastic Models (exported to R)
+//'
+//' Samples the approximate posterior of reaction parameters given a measured time course with sequential Monte Carlo ABC
+//' (population Monte Carlo: Toni et al. 2009, Beaumont et al. 2009). The first population is drawn from uniform priors between
+//' the lower and upper bounds; every later population perturbs particles of the previous one (Gaussian kernel with twice the
+//' weighted population variance) and accepts those whose simulated trajectory is within the tolerance of the data. The
+//' tolerance of each generation is a quantile of the distances of the previous population (adaptive schedule).
+//' Particles are simulated in parallel on native threads, and a simulation is stopped at the first data time where its partial
+//' distance exceeds the tolerance (early rejection). The summary statistics are the concentrations at the data times, the distance is the
+//' Euclidean ("euclidean") or maximum ("max") norm of their weighted differences. Results do not depend on the number of threads.
+//' @param model A string: the name of the model ("ano", "calcineurin", "calmodulin", "camkii", "glycphos" or "pkc").
+//' @param input_df A Dataframe: the input Calcium time series (with at least two columns: "time" in s and "Ca" in nmol/l).
+//' @param data A Dataframe: the measurements, a column "time" (increasing, within the input) and one column per measured species [nmol/l] (NA for missing values).
+//' @param lower A named numeric vector: the lower bounds of the uniform priors of the estimated reaction parameters.
+//' @param upper A named numeric vector: the upper bounds of the priors (same names).
+//' @param input_sim_params A List: optionally a "seed" and the warm start parameters (see sim_ensemble()).
+//' @param input_model_params A List: the model specific parameters (the fixed values). Can contain up to three different vectors named "vols" (model volumes), "init_conc" (initial conditions) and "params" (reaction parameters).
+//' @param weights A named numeric vector: weights of the measured species (default 1 for all).
+//' @param distance A string: "euclidean" or "max".
+//' @param nparticles An integer: the population size.
+//' @param ngenerations An integer: the maximum number of generations (including the first population from the prior).
+//' @param quantile A number: the quantile of the distances of a population that becomes the tolerance of the next generation.
+//' @param min_acceptance A number: stop when the acceptance rate of a generation would fall below this value.
+//' @param log_scale A boolean: log-uniform priors (and perturbations on log scale).
+//' @param nthreads An integer: the number of threads (default: all hardware threads).
+//' @return A list with the final population ("particles": parameter values, normalised "weight" and "distance"), and per generation
+//'         the "tolerance", the "acceptance_rate" and the number of simulations ("nsimulations").
+//' @examples
+//' ca <- data.frame(time = seq(0, 20, by = 0.1), Ca = 500)
+//' data <- data.frame(time = 1:20, Prot_act = detSim_calmodulin(ca, list(outputTimes = 1:20), list())$Prot_act)
+//' post <- abc_smc("calmodulin", ca, data, lower = c(k_on = 0.001, k_off = 0.001), upper = c(k_on = 0.1, k_off = 0.1),
+//'                 nparticles = 500, log_scale = TRUE)
+//' hist(post$particles$k_on)
+//' @export
+// [[Rcpp::export]]
+List abc_smc(std::string model,
+             DataFrame input_df,
+             DataFrame data,
+             NumericVector lower,
+             NumericVector upper,
+             List input_sim_params = List::create(),
+             List input_model_params = List::create(),
+             NumericVector weights = NumericVector::create(),
+             std::string distance = "euclidean",
+             int nparticles = 1000,
+             int ngenerations = 5,
+             double quantile = 0.5,
+             double min_acceptance = 0.01,
+             bool log_scale = false,
+             int nthreads = 0) {
+
+  // READ INPUT AND UPDATE DEFAULTS
+  const model_info &info = find_model(model);
+  sim_problem pb = read_sim_problem(info, input_df, input_sim_params, input_model_params);
+  if ((lower.length() == 0) || (lower.length() != upper.length()) || Rf_isNull(lower.names())) {
+    stop("lower and upper have to be named vectors of the same length.");
+  }
+  if ((distance != "euclidean") && (distance != "max")) {
+    stop("distance has to be \"euclidean\" or \"max\".");
+  }
+  if ((nparticles < 2) || !(quantile > 0 && quantile < 1) || !(min_acceptance > 0)) {
+    stop("nparticles has to be at least 2, quantile in (0, 1) and min_acceptance positive.");
+  }
+  CharacterVector names = lower.names();
+  const int k = lower.length();
+  std::vector<int> param_index(k);
+  std::vector<double> zlo(k), zhi(k);
+  for (int p = 0; p < k; p++) {
+    std::string name = as<std::string>(names[p]);
+    param_index[p] = find_param(info, name);
+    if (!upper.containsElementNamed(name.c_str())) {
+      stop("No upper bound for the parameter '" + name + "'.");
+    }
+    double lo = lower[p], hi = upper[name];
+    if (!(lo < hi) || (log_scale && !(lo > 0))) {
+      stop("Invalid prior bounds of '" + name + "' (lower < upper, positive on log scale).");
+    }
+    zlo[p] = log_scale ? std::log(lo) : lo;
+    zhi[p] = log_scale ? std::log(hi) : hi;
+  }
+  // Data points (output times are the data times)
+  abc_data obs;
+  obs.max_norm = (distance == "max");
+  if (!data.containsElementNamed("time")) {
+    stop("data needs a column \"time\".");
+  }
+  NumericVector data_time = data["time"];
+  pb.output_times.assign(data_time.begin(), data_time.end());
+  for (size_t o = 0; o < pb.output_times.size(); o++) {
+    if ((pb.output_times[o] < pb.input_time_at(0)) || ((o > 0) && (pb.output_times[o] <= pb.output_times[o-1]))) {
+      stop("The data times have to be increasing and not before the start of the input.");
+    }
+  }
+  pb.generator.prepare(pb.end_time());
+  std::vector<int> measured;
+  std::vector<NumericVector> columns;
+  for (int i = 0; i < info.nspecies; i++) {
+    const std::string &name = info.species_names[i];
+    if (!data.containsElementNamed(name.c_str())) continue;
+    measured.push_back(i);
+    columns.push_back(data[name]);
+  }
+  for (int o = 0; o < (int)pb.output_times.size(); o++) {
+    for (size_t m = 0; m < measured.size(); m++) {
+      const std::string &name = info.species_names[measured[m]];
+      if (ISNAN(columns[m][o])) continue;
+      obs.output.push_back(o);
+      obs.species.push_back(measured[m]);
+      obs.value.push_back(columns[m][o]);
+      obs.weight.push_back(weights.containsElementNamed(name.c_str()) ? (double)weights[name] : 1.0);
+    }
+  }
+  if (obs.value.empty()) {
+    stop("data has no values of species of the model.");
+  }
+  const uint64_t seed = sim_seed(input_sim_params);
+  const size_t nvalues = pb.output_times.size() * info.nspecies;
+  nthreads = worker_threads(nthreads);
+  std::vector<sim_problem> problems(nthreads, pb);
+
+  // POPULATIONS (z: parameters on prior scale; proposal id of generation g uses the random number streams 2*id and 2*id + 1 of g)
+  const int n = nparticles;
+  std::vector<double> z(n*k), w(n, 1.0/n), dist(n);
+  std::vector<double> tolerances, acceptance, nsimulations;
+  double tolerance = HUGE_VAL;
+  std::vector<double> sd(k);
+  for (int g = 0; g < ngenerations; g++) {
+    // kernel of the perturbations
+    for (int p = 0; p < k; p++) {
+      sd[p] = std::sqrt(2.0 * weighted_variance(z, w, k, p));
+      if (!(sd[p] > 0)) sd[p] = 1e-6 * (zhi[p] - zlo[p]);
+    }
+    std::vector<double> cum(n);
+    std::partial_sum(w.begin(), w.end(), cum.begin());
+    std::vector<double> z_new(n*k), dist_new(n);
+    std::vector<double> batch_z, batch_dist;
+    int accepted = 0;
+    long proposals = 0;
+    const long max_proposals = (g == 0) ? n : (long)std::ceil(n / min_acceptance);
+    while ((accepted < n) && (proposals < max_proposals)) {
+      sim_check_interrupt();
+      const int batch = (int)std::min((long)std::max(n - accepted, nthreads), max_proposals - proposals);
+      batch_z.assign((size_t)batch*k, 0.0);
+      batch_dist.assign(batch, HUGE_VAL);
+      parallel_for(batch, nthreads, [&](int b, int thread) {
+        const uint64_t id = proposals + b;
+        const uint64_t stream = ((uint64_t)g << 40) + 2*id;
+        Rng rng(seed, stream);
+        double *zb = &batch_z[(size_t)b*k];
+        if (g == 0) {
+          for (int p = 0; p < k; p++) zb[p] = zlo[p] + (zhi[p] - zlo[p]) * rng.uniform();
+        } else {
+          int j = std::lower_bound(cum.begin(), cum.end(), rng.uniform() * cum[n-1]) - cum.begin();
+          j = std::min(j, n-1);
+          for (int p = 0; p < k; p++) {
+            zb[p] = z[(size_t)j*k + p] + sd[p] * rng.normal();
+            if ((zb[p] < zlo[p]) || (zb[p] > zhi[p])) return;  // outside the prior support: rejected
+          }
+        }
+        sim_problem &tpb = problems[thread];
+        for (int p = 0; p < k; p++) tpb.params[param_index[p]] = log_scale ? std::exp(zb[p]) : zb[p];
+        double *out = thread_buffers().get(buffer_output, nvalues);
+        batch_dist[b] = abc_distance(info, tpb, obs, tolerance, seed, stream + 1, out);
+      }, &sim_check_interrupt);
+      // accept in proposal order (independent of the thread scheduling)
+      for (int b = 0; (b < batch) && (accepted < n); b++) {
+        proposals++;
+        if (batch_dist[b] <= tolerance) {
+          std::copy(&batch_z[(size_t)b*k], &batch_z[(size_t)b*k] + k, &z_new[(size_t)accepted*k]);
+          dist_new[accepted] = batch_dist[b];
+          accepted++;
+        }
+      }
+    }
+    if (accepted < n) break;  // acceptance rate below min_acceptance: keep the previous population
+
+    // importance weights (uniform prior: inverse of the kernel density mixture of the previous population)
+    std::vector<double> w_new(n, 1.0);
+    if (g > 0) {
+      parallel_for(n, nthreads, [&](int i, int thread) {
+        double sum = 0.0;
+        for (int j = 0; j < n; j++) {
+          double logk = 0.0;
+          for (int p = 0; p < k; p++) {
+            double u = (z_new[(size_t)i*k + p] - z[(size_t)j*k + p]) / sd[p];
+            logk -= 0.5 * u * u;
+          }
+          sum += w[j] * std::exp(logk);
+        }
+        w_new[i] = (sum > 0) ? 1.0 / sum : 0.0;
+      }, &sim_check_interrupt);
+    }
+    double wsum = 0.0;
+    for (int i = 0; i < n; i++) wsum += w_new[i];
+    for (int i = 0; i < n; i++) w_new[i] /= wsum;
+    z.swap(z_new);
+    w.swap(w_new);
+    dist.swap(dist_new);
+    tolerances.push_back(tolerance);
+    acceptance.push_back((double)n / proposals);
+    nsimulations.push_back(proposals);
+    // adaptive tolerance: quantile of the distances of the population
+    std::vector<double> sorted(dist);
+    std::sort(sorted.begin(), sorted.end());
+    tolerance = sorted[std::min(n - 1, (int)(quantile * n))];
+  }
+
+  // Final population
+  NumericMatrix retval(n, k+2);
+  CharacterVector col_names(k+2);
+  for (int p = 0; p < k; p++) col_names[p] = names[p];
+  col_names[k] = "weight";
+  col_names[k+1] = "distance";
+  colnames(retval) = col_names;
+  for (int i = 0; i < n; i++) {
+    for (int p = 0; p < k; p++) retval(i, p) = log_scale ? std::exp(z[(size_t)i*k + p]) : z[(size_t)i*k + p];
+    retval(i, k) = w[i];
+    retval(i, k+1) = dist[i];
+  }
+  DataFrame particles(retval);
+  return List::create(_["particles"] = particles, _["tolerance"] = wrap(tolerances),
+                      _["acceptance_rate"] = wrap(acceptance), _["nsimulations"] = wrap(nsimulations));
+}
@@ -0,0 +1,179 @@
+#include <string>
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <Rcpp.h>
+#include "model_registry.hpp"
+#include "buffer_pool.hpp"
+#include "parallel.hpp"
+#include "running_stats.hpp"
+#include "sim_params.hpp"
+using namespace Rcpp;
+
+
+// Replicates per group of the running statistics (the groups are merged in order, so the statistics do not depend on the threads)
+static const int adaptive_group_size = 8;
+
+
+//' Adaptive Ensemble Simulation (exported to R)
+//'
+//' Simulates replicates of the stochastic model (Gillespie's Direct Method) in parallel batches until the mean trajectories of the
+//' selected species are known to a target precision, instead of a guessed number of replicates. After every batch the confidence
+//' interval half-width of the mean of every selected species at every output time in the window is computed from running statistics
+//' (Student t interval); once min_replicates replicates have been simulated, the simulation stops when the largest half-width
+//' (absolute, or relative to the mean) meets the target, or when max_replicates is reached. With few replicates the sample variance
+//' is unreliable (e.g. zero before the first reaction), hence the minimum. Only the running statistics are kept, not the replicates. The results are reproducible with
+//' set.seed() (or the simulation parameter "seed") and do not depend on the number of threads.
+//' @param model A string: the name of the model ("ano", "calcineurin", "calmodulin", "camkii", "glycphos" or "pkc").
+//' @param input_df A Dataframe: the input Calcium time series (with at least two columns: "time" in s and "Ca" in nmol/l).
+//' @param input_sim_params A List: contains values for the simulation end ("endTime") and its timesteps ("timestep") or a vector of output times ("outputTimes"), and optionally a "seed".
+//'                         With "baselineCa" the replicates start from equilibrated states at this calcium concentration (see sim_equilibrate()).
+//' @param input_model_params A List: the model specific parameters. Can contain up to three different vectors named "vols" (model volumes), "init_conc" (initial conditions) and "params" (reaction parameters).
+//' @param species A character vector: the species whose mean trajectories are estimated (default: all species).
+//' @param target A number: the target confidence interval half-width (relative to the mean, or in nmol/l with relative = FALSE).
+//' @param relative A boolean: relative instead of absolute half-widths.
+//' @param window A numeric vector: start and end of the time window in which the target has to be met (default: all output times).
+//' @param confidence A number: the confidence level of the intervals.
+//' @param batch_size An integer: the number of replicates simulated between two checks of the precision.
+//' @param min_replicates An integer: the minimum number of replicates before the precision is tested.
+//' @param max_replicates An integer: the maximum number of replicates.
+//' @param nthreads An integer: the number of threads (default: all hardware threads).
+//' @return A list with a dataframe of the output times, the calcium input and for each selected species the mean, the standard deviation ("_sd")
+//'         and the confidence interval half-width ("_halfwidth") ("summary"), the number of replicates, the achieved precision (largest half-width in the
+//'         window, relative or absolute as the target) and whether the target was met ("converged").
+//' @examples
+//' ca <- data.frame(time = seq(0, 10, by = 0.01), Ca = 200)
+//' res <- sim_ensemble_adaptive("calmodulin", ca, list(endTime = 10, timestep = 0.1), list(), species = "Prot_act",
+//'                              target = 0.02, window = c(5, 10))
+//' res$nreplicates
+//' @export
+// [[Rcpp::export]]
+List sim_ensemble_adaptive(std::string model,
+                           DataFrame input_df,
+                           List input_sim_params,
+                           List input_model_params,
+                           CharacterVector species = CharacterVector::create(),
+                           double target = 0.05,
+                           bool relative = true,
+                           NumericVector window = NumericVector::create(),
+                           double confidence = 0.95,
+                           int batch_size = 100,
+                           int min_replicates = 30,
+                           int max_replicates = 100000,
+                           int nthreads = 0) {
+
+  // READ INPUT AND UPDATE DEFAULTS
+  const model_info &info = find_model(model);
+  const int ns = info.nspecies;
+  const sim_problem pb = read_sim_problem(info, input_df, input_sim_params, input_model_params);
+  const uint64_t seed = sim_seed(input_sim_params);
+  const int noutput = pb.output_times.size();
+  std::vector<int> selected;
+  if (species.length() == 0) {
+    for (int i = 0; i < ns; i++) selected.push_back(i);
+  }
+  for (int k = 0; k < species.length(); k++) {
+    const std::string name = as<std::string>(species[k]);
+    int i = std::find(info.species_names.begin(), info.species_names.end(), name) - info.species_names.begin();
+    if (i == ns) {
+      stop("Unknown species '" + name + "'.");
+    }
+    selected.push_back(i);
+  }
+  const int nsel = selected.size();
+  if (!(target > 0) || !(confidence > 0 && confidence < 1) || (batch_size < 2) || (min_replicates < 2) ||
+      (max_replicates < min_replicates)) {
+    stop("target has to be positive, confidence in (0, 1), batch_size and min_replicates at least 2, and max_replicates at least min_replicates.");
+  }
+  if ((window.length() != 0) && (window.length() != 2)) {
+    stop("window has to contain a start and an end time.");
+  }
+  const double window_start = (window.length() == 2) ? window[0] : -HUGE_VAL;
+  const double window_end = (window.length() == 2) ? window[1] : HUGE_VAL;
+  if (std::find_if(pb.output_times.begin(), pb.output_times.end(), [&](double time) {
+        return (time >= window_start) && (time <= window_end);
+      }) == pb.output_times.end()) {
+    stop("The window does not contain any output time.");
+  }
+
+  // RUN BATCHES (replicate r on random number stream r, running statistics of group g of a batch in partial[g])
+  nthreads = worker_threads(nthreads);
+  const size_t nvalues = (size_t)noutput*nsel;
+  running_stats stats(nvalues);
+  std::vector<running_stats> partial((batch_size + adaptive_group_size - 1) / adaptive_group_size, running_stats(nvalues));
+  std::vector<std::vector<double> > values(nthreads, std::vector<double>(nvalues));
+  int nreplicates = 0;
+  double precision = HUGE_VAL;
+  bool converged = false;
+  while (nreplicates < max_replicates) {
+    const int first = nreplicates;
+    const int last = std::min(max_replicates, first + batch_size);
+    const int ngroups = (last - first + adaptive_group_size - 1) / adaptive_group_size;
+    parallel_for(ngroups, nthreads, [&](int g, int thread) {
+      double *out = thread_buffers().get(buffer_output, (size_t)noutput*ns);
+      double *v = &values[thread][0];
+      partial[g].reset();
+      for (int r = first + g*adaptive_group_size; r < std::min(last, first + (g+1)*adaptive_group_size); r++) {
+        ssa_state s = ssa_initial_state(pb, seed, r);
+        info.ssa_simulator(pb, s, HUGE_VAL, out, UINT64_MAX, 0, 0);
+        for (int o = 0; o < noutput; o++) {
+          for (int k = 0; k < nsel; k++) v[(size_t)o*nsel + k] = out[(size_t)o*ns + selected[k]];
+        }
+        partial[g].add(v);
+      }
+    }, &sim_check_interrupt);
+    for (int g = 0; g < ngroups; g++) stats.merge(partial[g]);
+    nreplicates = last;
+    sim_check_interrupt();
+    if (nreplicates < min_replicates) continue;
+
+    // Largest confidence interval half-width in the window
+    const double t = R::qt(0.5 + confidence/2, nreplicates - 1, 1, 0);
+    precision = 0.0;
+    for (int o = 0; o < noutput; o++) {
+      if ((pb.output_times[o] < window_start) || (pb.output_times[o] > window_end)) continue;
+      for (int k = 0; k < nsel; k++) {
+        size_t j = (size_t)o*nsel + k;
+        double halfwidth = t * std::sqrt(stats.variance(j) / nreplicates);
+        if (relative && (halfwidth > 0)) {
+          halfwidth = (stats.mean[j] != 0) ? halfwidth / std::fabs(stats.mean[j]) : HUGE_VAL;
+        }
+        precision = std::max(precision, halfwidth);
+      }
+    }
+    if (precision <= target) {
+      converged = true;
+      break;
+    }
+  }
+
+  // Summary: one row per output time; cols. = time + ca + (mean, sd, halfwidth) per selected species
+  const double t = R::qt(0.5 + confidence/2, nreplicates - 1, 1, 0);
+  NumericMatrix retval(noutput, 3*nsel+2);
+  CharacterVector col_names(3*nsel+2);
+  col_names[0] = "time";
+  col_names[1] = "Ca";
+  for (int k = 0; k < nsel; k++) {
+    const std::string &name = info.species_names[selected[k]];
+    col_names[3*k+2] = name;
+    col_names[3*k+3] = name + "_sd";
+    col_names[3*k+4] = name + "_halfwidth";
+  }
+  colnames(retval) = col_names;
+  for (int o = 0, n = 0; o < noutput; o++) {
+    // calcium input interval of the output time
+    while ((n+1 < pb.ninput()) && (pb.input_time_at(n+1) <= pb.output_times[o])) n++;
+    retval(o, 0) = pb.output_times[o];
+    retval(o, 1) = pb.input_ca_at(n);
+    for (int k = 0; k < nsel; k++) {
+      size_t j = (size_t)o*nsel + k;
+      double sd = std::sqrt(stats.variance(j));
+      retval(o, 3*k+2) = stats.mean[j];
+      retval(o, 3*k+3) = sd;
+      retval(o, 3*k+4) = t * sd / std::sqrt((double)nreplicates);
+    }
+  }
+
+  return List::create(_["summary"] = DataFrame(retval), _["nreplicates"] = nreplicates, _["precision"] = precision,
+                      _["converged"] = converged);
+}
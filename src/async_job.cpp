@@ -0,0 +1,231 @@
+#include <string>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <Rcpp.h>
+#include "compiled_model.hpp"
+#include "sim_params.hpp"
+using namespace Rcpp;
+
+
+// Background simulation job
+// The simulation problem is read on the R thread. The worker thread only runs the native engines on plain C++ data (no R API calls),
+// publishes its progress with atomics and checks for cancellation every ssa_check_events reactions (single run) or every block of
+// replicates (ensemble). Output rows below 'nfinished' (output times of a single run, replicates of an ensemble) are final and
+// can be read by the R thread while the worker writes the following ones.
+enum job_status { job_running, job_done, job_cancelled, job_failed };
+static const char *job_status_names[] = { "running", "done", "cancelled", "failed" };
+
+struct sim_job {
+  const model_info *info;
+  ensemble_config cfg;
+  bool ensemble;
+  std::vector<double> out;
+  std::atomic<int> status;
+  std::atomic<bool> cancel_requested;
+  std::atomic<int> nfinished;
+  std::atomic<double> progress;
+  int nblocks;                   // blocks of replicates started (worker thread only)
+  std::string error;             // set by the worker before the status becomes job_failed
+  std::thread worker;
+
+  sim_job() : info(0), ensemble(false), status(job_running), cancel_requested(false), nfinished(0), progress(0.0), nblocks(0) {}
+  ~sim_job() {
+    cancel_requested = true;
+    if (worker.joinable()) worker.join();
+  }
+};
+
+// Job of the worker thread (for the ensemble callback, which has no context argument)
+static thread_local sim_job *worker_job = 0;
+struct job_cancel_signal {};
+
+// Called by the ensemble simulator before each block of replicates: all earlier replicates are finished
+static void ensemble_job_check() {
+  sim_job *job = worker_job;
+  int finished = std::min(job->cfg.nreplicates, job->nblocks * SIMD_LANES);
+  job->nblocks++;
+  job->nfinished.store(finished, std::memory_order_release);
+  job->progress = (double)finished / job->cfg.nreplicates;
+  if (job->cancel_requested) throw job_cancel_signal();
+}
+
+static void run_job(sim_job *job) {
+  worker_job = job;
+  try {
+    if (job->ensemble) {
+      job->info->ensemble_simulator(job->cfg, job->out);
+      job->nfinished.store(job->cfg.nreplicates, std::memory_order_release);
+    } else {
+      const sim_problem &pb = job->cfg;
+      double start = pb.input_time_at(0);
+      double span = pb.end_time() - start;
+      ssa_state s = ssa_initial_state(pb, job->cfg.seed, 0);
+      while (!s.finished(pb)) {
+        if (job->cancel_requested) throw job_cancel_signal();
+        job->info->ssa_simulator(pb, s, HUGE_VAL, job->out.data(), ssa_check_events, 0, 0);
+        job->nfinished.store(s.noutput, std::memory_order_release);
+        job->progress = (span > 0) ? std::min(1.0, (s.time - start) / span) : 1.0;
+      }
+    }
+    job->progress = 1.0;
+    job->status = job_done;
+  } catch (job_cancel_signal &) {
+    job->status = job_cancelled;
+  } catch (std::exception &e) {
+    job->error = e.what();
+    job->status = job_failed;
+  } catch (...) {
+    job->error = "unknown error";
+    job->status = job_failed;
+  }
+}
+
+static sim_job &as_sim_job(SEXP job) {
+  if ((TYPEOF(job) != EXTPTRSXP) || !Rf_inherits(job, "sim_job")) {
+    stop("job has to be a background simulation (see sim_async()).");
+  }
+  XPtr<sim_job> ptr(job);
+  if (ptr.get() == 0) {
+    stop("The background simulation is no longer valid (e.g. after saving and loading the R session).");
+  }
+  return *ptr;
+}
+
+// Data frame of the first n finished output times (single run) or replicates (ensemble)
+static DataFrame job_frame(const sim_job &job, int n) {
+  if (job.ensemble) {
+    ensemble_config cfg = job.cfg;
+    cfg.nreplicates = n;
+    return ensemble_frame(*job.info, cfg, job.out.data());
+  }
+  sim_problem pb = job.cfg;
+  pb.output_times.resize(n);
+  return trajectory_frame(*job.info, pb, job.out.data());
+}
+
+
+//' Background Simulation (exported to R)
+//'
+//' Starts a stochastic simulation (one replicate as sim_<MODEL_NAME>(), or an ensemble as sim_ensemble()) on a native worker thread and returns immediately.
+//' The returned job can be polled with status() and progress(), the outputs simulated so far are available with partial_result(),
+//' and the job can be stopped with cancel(). result() waits for the end of the simulation and returns its result.
+//' The worker checks for cancellation every 65536 reactions (single run) or every block of 4 or 8 replicates (ensemble).
+//' @param model A string: the name of the model ("ano", "calcineurin", "calmodulin", "camkii", "glycphos" or "pkc"), or a compiled model (see compile_model()).
+//' @param input_df A Dataframe: the input Calcium time series (with at least two columns: "time" in s and "Ca" in nmol/l).
+//' @param input_sim_params A List: contains values for the simulation end ("endTime") and its timesteps ("timestep") or a vector of output times ("outputTimes"),
+//'                         and optionally a "seed" and "baselineCa" (see sim_equilibrate()).
+//' @param input_model_params A List: the model specific parameters (not used for compiled models). Can contain up to three different vectors named "vols" (model volumes), "init_conc" (initial conditions) and "params" (reaction parameters).
+//' @param nreplicates An integer: the number of replicates.
+//' @return A background simulation job (external pointer).
+//' @examples
+//' ca <- data.frame(time = seq(0, 100, by = 0.1), Ca = 200)
+//' job <- sim_async("ano", ca, list(endTime = 100, timestep = 0.1))
+//' progress(job)
+//' res <- result(job)
+//' @export
+// [[Rcpp::export]]
+SEXP sim_async(SEXP model,
+               DataFrame input_df,
+               List input_sim_params,
+               List input_model_params = List::create(),
+               int nreplicates = 1) {
+
+  // READ INPUT AND UPDATE DEFAULTS (on the R thread)
+  XPtr<sim_job> job(new sim_job(), true);
+  if (TYPEOF(model) == STRSXP) {
+    job->info = &find_model(as<std::string>(model));
+    static_cast<sim_problem &>(job->cfg) = read_sim_problem(*job->info, input_df, input_sim_params, input_model_params);
+  } else {
+    compiled_model &cm = as_compiled_model(model);
+    job->info = cm.info;
+    static_cast<sim_problem &>(job->cfg) = cm.problem;
+    read_sim_input(*job->info, input_df, input_sim_params, job->cfg);
+  }
+  job->cfg.nreplicates = std::max(1, nreplicates);
+  job->cfg.seed = sim_seed(input_sim_params);
+  job->cfg.check_interrupt = &ensemble_job_check;
+  job->ensemble = (nreplicates > 1);
+  // allocated here, so the worker never reallocates the buffer the R thread reads from
+  job->out.assign((size_t)job->cfg.nreplicates*job->cfg.output_times.size()*job->info->nspecies, 0.0);
+
+  // RUN SIMULATION (worker thread)
+  try {
+    job->worker = std::thread(run_job, job.get());
+  } catch (std::exception &e) {
+    stop(std::string("Cannot start the worker thread: ") + e.what());
+  }
+  job.attr("class") = "sim_job";
+  return job;
+}
+
+//' Status of a Background Simulation (exported to R)
+//'
+//' @param job A background simulation (see sim_async()).
+//' @return A string: "running", "done", "cancelled" or "failed".
+//' @export
+// [[Rcpp::export]]
+std::string status(SEXP job) {
+  return job_status_names[as_sim_job(job).status.load()];
+}
+
+//' Progress of a Background Simulation (exported to R)
+//'
+//' @param job A background simulation (see sim_async()).
+//' @return A number between 0 and 1: the simulated fraction of the time span (single run) or of the replicates (ensemble).
+//' @export
+// [[Rcpp::export]]
+double progress(SEXP job) {
+  return as_sim_job(job).progress.load();
+}
+
+//' Partial Result of a Background Simulation (exported to R)
+//'
+//' Returns the outputs the running simulation has finished so far (without waiting).
+//' @param job A background simulation (see sim_async()).
+//' @return A dataframe as result(), with the output times reached so far (single run) or the finished replicates (ensemble).
+//' @export
+// [[Rcpp::export]]
+DataFrame partial_result(SEXP job) {
+  sim_job &j = as_sim_job(job);
+  return job_frame(j, j.nfinished.load(std::memory_order_acquire));
+}
+
+//' Cancel a Background Simulation (exported to R)
+//'
+//' Stops the worker thread at its next check; the outputs finished so far stay available with partial_result().
+//' @param job A background simulation (see sim_async()).
+//' @export
+// [[Rcpp::export]]
+void cancel(SEXP job) {
+  sim_job &j = as_sim_job(job);
+  j.cancel_requested = true;
+  if (j.worker.joinable()) j.worker.join();
+}
+
+//' Result of a Background Simulation (exported to R)
+//'
+//' @param job A background simulation (see sim_async()).
+//' @param wait A logical: wait for the end of the simulation (the wait can be interrupted, the simulation continues in the background).
+//' @return A dataframe with the output times, the calcium input and the concentrations of all species (and the replicate index for ensembles).
+//' @export
+// [[Rcpp::export]]
+DataFrame result(SEXP job, bool wait = true) {
+  sim_job &j = as_sim_job(job);
+  while (j.status == job_running) {
+    if (!wait) {
+      stop("The simulation is still running.");
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    checkUserInterrupt();
+  }
+  if (j.worker.joinable()) j.worker.join();
+  if (j.status == job_failed) {
+    stop("The simulation failed: " + j.error);
+  }
+  if (j.status == job_cancelled) {
+    stop("The simulation was cancelled; see partial_result().");
+  }
+  return job_frame(j, j.ensemble ? j.cfg.nreplicates : (int)j.cfg.output_times.size());
+}
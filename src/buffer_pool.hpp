@@ -0,0 +1,39 @@
+#ifndef BUFFER_POOL_HPP
+#define BUFFER_POOL_HPP
+
+#include <vector>
+#include <cstddef>
+
+
+// Per-thread pool of run buffers
+// Every simulation run needs the same working buffers (parameters, output grid, ...). The pool keeps one
+// buffer per slot that only grows, so consecutive runs, replicates and sweep points on the same thread reuse the memory
+// instead of allocating and freeing it every time; converting the result to R objects is the only allocation left per run.
+enum buffer_slot {
+  buffer_params,      // reaction parameters of the current input interval (stochastic engine)
+  buffer_output,      // concentrations at the output times (native engines)
+  buffer_nslots
+};
+
+class buffer_pool {
+public:
+  buffer_pool() : slots(buffer_nslots) {}
+
+  // Buffer of the slot with at least n elements (contents left over from the previous run, or zero when it had to grow)
+  double *get(buffer_slot slot, size_t n) {
+    std::vector<double> &buffer = slots[slot];
+    if (buffer.size() < n) buffer.resize(n);
+    return buffer.empty() ? 0 : &buffer[0];
+  }
+
+private:
+  std::vector<std::vector<double> > slots;
+};
+
+// Pool of the calling thread
+inline buffer_pool &thread_buffers() {
+  static thread_local buffer_pool pool;
+  return pool;
+}
+
+#endif
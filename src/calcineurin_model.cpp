@@ -9,14 +9,13 @@ using namespace Rcpp;
 #define MODEL_NAME calcineurin
 // include the simulation function with macros (#define statements) that make it model specific (based on MODEL_NAME)
 #include "simulator.cpp"
-// Global variables
-static std::map <std::string, double> prop_params_map;
-// 2. USER INPUT for new models: Change the name of the wrapper function to sim_<MODEL_NAME> and the names of the internally called functions to init_<MODEL_NAME> and simulator_<MODEL_NAME>.
+// 2. USER INPUT for new models: Change the names of the wrapper functions to sim_<MODEL_NAME> and detSim_<MODEL_NAME> and the names of the internally called functions to resolve_model_params_<MODEL_NAME>, simulator_<MODEL_NAME> and det_simulator_<MODEL_NAME>.
 //' Calcineurin Model R Wrapper Function (exported to R)
 //'
 //' This function compares user-supplied parameters to defaults parameter values, overwrites the defaults if neccessary, and calls the internal C++ simulation function for the calcineurin model.
 //' @param user_input_df A Dataframe: the input Calcium time series (with at least two columns: "time" in s and "Ca" in nmol/l).
 //' @param user_sim_params A List: contains values for the simulation end ("endTime") and its timesteps ("timestep").
+//'                        With "baselineCa" the simulation starts from an equilibrated state at this calcium concentration (see sim_equilibrate()).
 //' @param user_model_params A List: the model specific parameters. Can contain up to three different vectors named "vols" (model volumes), "init_conc" (initial conditions) and "params" (propensity equation parameters). 
 //' @section Default Parameters of the Calcineurin Model:
 //' Default Volumes: 
@@ -27,7 +26,7 @@ static std::map <std::string, double> prop_params_map;
 //' * Prot_act = 0
 //' 
 //' Default Reaction Parameters:
-//' * k_on = 1
+//' * k_on = 1e-9
 //' * k_off = 1
 //' * p = 3.0
 //' @md
@@ -41,75 +40,11 @@ DataFrame sim_calcineurin(DataFrame user_input_df,
                           List user_sim_params,
                           List user_model_params) {
 
-  // READ INPUT
-  // Provide default model parameters list
-  List default_model_params = init_calcineurin();
-  // Extract default vectors from list
-  NumericVector default_vols = default_model_params["vols"];
-  NumericVector default_init_conc = default_model_params["init_conc"];
-  NumericVector default_params = default_model_params["params"];
-  // Extract vectors from user supplied list 
-  // If they exist: definition with the default vector gets overwritten
-  NumericVector user_vols = default_vols;
-  if (user_model_params.containsElementNamed("vols")) {
-      user_vols = user_model_params["vols"];
-  } else {
-    Rcout << "Default volume(s) have been used." << std::endl;
-  } 
-  NumericVector user_init_conc = default_init_conc;
-  if (user_model_params.containsElementNamed("init_conc")) {
-    user_init_conc = user_model_params["init_conc"];
-  } else {
-    Rcout << "Default initial condition(s) have been used." << std::endl;
-  }
-  NumericVector user_params = default_params;
-  if (user_model_params.containsElementNamed("params")) {
-    user_params = user_model_params["params"];
-  } else {
-    Rcout << "Default reaction parameter(s) have been used." << std::endl;
-  }
-  // UPDATE DEFAULTS 
-  // Replace entries in default_model_params with user-supplied values if necessary
-  // 1.) Volumes update:
-  CharacterVector user_vols_names = user_vols.names();
-  for (int i = 0; i < user_vols_names.length(); i++) {
-    std::string current_vol_name = as<std::string>(user_vols_names[i]);
-    if (default_vols.containsElementNamed((current_vol_name).c_str())) {
-      // update default values
-      default_vols[current_vol_name] = user_vols[current_vol_name];    
-    } else {
-      Rcout << "No such index! Default values have been used. Check input parameter vectors." << std::endl;
-    }
-  }
-  // 2.) Initial conditions update:
-  CharacterVector user_init_conc_names = user_init_conc.names();
-  for (int i = 0; i < user_init_conc_names.length(); i++) {
-    std::string current_init_conc_name = as<std::string>(user_init_conc_names[i]);
-    if (default_init_conc.containsElementNamed((current_init_conc_name).c_str())) {
-      // update default values
-      default_init_conc[current_init_conc_name] = user_init_conc[current_init_conc_name];    
-    } else {
-      Rcout << "No such index! Default values have been used. Check input parameter vectors." << std::endl;
-    }
-  }
-  // 3.) Propensity equation parameters update:
-  CharacterVector user_params_names = user_params.names();
-  for (int i = 0; i < user_params_names.length(); i++) {
-    std::string current_param_name = as<std::string>(user_params_names[i]);
-    if (default_params.containsElementNamed((current_param_name).c_str())) {
-      // update default values
-      default_params[current_param_name] = user_params[current_param_name];    
-    } else {
-      Rcout << "No such index! Default values have been used. Check input parameter vectors." << std::endl;
-    }
-  }
-  // Put propensity reaction parameters in a map (for function calculate_amu)
-  // (take parameters from vector "default_params" which contains the updated values)
-  CharacterVector default_params_names = default_params.names();
-  for (int n = 0; n < default_params.length(); n++) {
-    std::string current_param_name = as<std::string>(default_params_names[n]);
-    prop_params_map[current_param_name] = default_params[current_param_name];  
-  }
+  // READ INPUT AND UPDATE DEFAULTS
+  // Replace entries in the default model parameters with user-supplied values if necessary
+  List model_params_list = resolve_model_params_calcineurin(user_model_params, false);
+  NumericVector default_vols = model_params_list["vols"];
+  NumericVector default_init_conc = model_params_list["init_conc"];
   // RUN SIMULATION
   // Return result of the included, model-specific copy of the function "simulator" 
   return simulator_calcineurin(user_input_df,
@@ -119,66 +54,75 @@ DataFrame sim_calcineurin(DataFrame user_input_df,
    
 }
 
+//' Calcineurin Model Deterministic Simulation (exported to R)
+//'
+//' This function compares user-supplied parameters to defaults parameter values, overwrites the defaults if neccessary, and integrates the reaction rate equations of the calcineurin model with the internal C++ ODE solver.
+//' The equations are generated from the same model definition as the propensities of the stochastic simulation (see sim_calcineurin() for the default parameters).
+//' @param input_df A Dataframe: the input Calcium time series (with at least two columns: "time" in s and "Ca" in nmol/l).
+//' @param input_sim_params A List: contains values for the simulation end ("endTime") and its timesteps ("timestep") or a vector of output times ("outputTimes"), and optionally the solver tolerances ("rtol", "atol").
+//' @param input_model_params A List: the model specific parameters. Can contain up to three different vectors named "vols" (model volumes), "init_conc" (initial conditions) and "params" (reaction parameters). 
+//' @return A dataframe with the output times, the calcium input and the concentrations of all species.
+//' @examples
+//' detSim_calcineurin()
+//' @export
+// [[Rcpp::export]]
+DataFrame detSim_calcineurin(DataFrame input_df,
+                             List input_sim_params,
+                             List input_model_params) {
+
+  // READ INPUT AND UPDATE DEFAULTS
+  List model_params_list = resolve_model_params_calcineurin(input_model_params, true);
+  NumericVector default_vols = model_params_list["vols"];
+  NumericVector default_init_conc = model_params_list["init_conc"];
+  // RUN SIMULATION
+  return det_simulator_calcineurin(input_df,
+                                   input_sim_params,
+                                   default_vols,
+                                   default_init_conc);
+
+}
+
 
 
 //********************************/* MODEL DEFINITION */********************************
-// 3. USER INPUT for new models: define model parameters, number of species, 
-// number of reactions, propensity equations and update_system function 
+// 3. USER INPUT for new models: define species, volumes and reaction parameters (with default values),
+// the stoichiometric matrix and the propensity equations. 
+// The stochastic and the deterministic simulation kernels are both generated from this single definition (see model_definition.hpp).
 
-// Default model parameters
-List init() {
-  // Model dimensions
-  nspecies = 2;
-  nreactions = 2;
-  
-  // Default volume(s)
-  NumericVector vols = NumericVector::create(
-    _["vol"] = 5e-14
-  );
-  // Default initial conditions
-  NumericVector init_conc = NumericVector::create(
-    _["Prot_inact"] = 5.0,
-    _["Prot_act"] = 0
-  );
-  // Default propensity equation parameters
-  NumericVector params = NumericVector::create(
-    _["k_on"] = 1e-9,
-    _["k_off"] = 1,
-    _["p"] = 3.0
-  );
-    
-  // Combine and return all vectors in a default_params list
-  return List::create(
-    _["vols"] = vols,
-    _["init_conc"] = init_conc,
-    _["params"] = params
-  );
-}
+// Species and default initial conditions [nmol/l]
+#define MODEL_SPECIES(X) \
+  X(Prot_inact, 5.0) \
+  X(Prot_act, 0)
+// Default volume(s) [l]
+#define MODEL_VOLS(X) \
+  X(vol, 5e-14)
+// Default propensity equation parameters
+#define MODEL_PARAMS(X) \
+  X(k_on, 1e-9) \
+  X(k_off, 1) \
+  X(p, 3.0)
+// Calcium dependent factors (depend only on parameters and inputs, precomputed once per input interval)
+#define MODEL_FACTORS(X) \
+  X(k_act, k_on * pow(Ca, p))
+// Stoichiometric matrix
+//              R1   R2
+// Prot_inact   -1    1
+// Prot_act      1   -1
+#define MODEL_STOICHIOMETRY \
+  -1,  1, \
+   1, -1
+
+#include "model_definition.hpp"
 
 // Propensity calculation:
-// Calculates the propensities of all Calcineurin model reactions and stores them in the vector amu.
-void calculate_amu() {
+// Calculates the propensities of all Calcineurin model reactions (particle numbers x, calcium concentration Ca).
+template <typename Real, typename Param>
+void propensities(const model_param_set<Param> &params, const model_factor_set<Param> &factors, double Ca, const Real *x, double f, Real *rate) {
   
-  // Look up model parameters in array 'model_params' initially
-  double k_on = prop_params_map["k_on"];
-  double k_off = prop_params_map["k_off"];
-  double p = prop_params_map["p"];  
+  // Model parameters as local variables (k_on, k_off, p)
+  MODEL_PARAMS(UNPACK_PARAM)
+  MODEL_FACTORS(UNPACK_FACTOR)
   
-  amu[0] = k_on * pow((double)calcium[ntimepoint],(double)p) * x[0];
-  amu[1] = amu[0] + k_off * x[1];
+  rate[0] = k_act * x[0];
+  rate[1] = k_off * x[1];
 }
-
-// Stoichiometric matrix
-NumericMatrix get_stM() {
-  
-  // initialize stoich matrix (with zeroes)
-  NumericMatrix stM(nspecies, nreactions);
-  // create stoich matrix row vectors
-  NumericVector stM_row1 = {-1,  1};
-  NumericVector stM_row2 = { 1, -1};
-  // fill rows of stoich matrix
-  stM(0, _) = stM_row1;
-  stM(1, _) = stM_row2;
-  
-  return stM;  
-}
\ No newline at end of file
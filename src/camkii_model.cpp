@@ -9,14 +9,13 @@ using namespace Rcpp;
 #define MODEL_NAME camkii
 // include the simulation function with macros (#define statements) that make it model specific (based on MODEL_NAME)
 #include "simulator.cpp"
-// Global variables
-static std::map <std::string, double> prop_params_map;
-// 2. USER INPUT for new models: Change the name of the wrapper function to sim_<MODEL_NAME> and the names of the internally called functions to init_<MODEL_NAME> and simulator_<MODEL_NAME>.
+// 2. USER INPUT for new models: Change the names of the wrapper functions to sim_<MODEL_NAME> and detSim_<MODEL_NAME> and the names of the internally called functions to resolve_model_params_<MODEL_NAME>, simulator_<MODEL_NAME> and det_simulator_<MODEL_NAME>.
 //' CamKII Model R Wrapper Function (exported to R)
 //'
 //' This function compares user-supplied parameters to defaults parameter values, overwrites the defaults if neccessary, and calls the internal C++ simulation function for the camkii model.
 //' @param user_input_df A Dataframe: the input Calcium time series (with at least two columns: "time" in s and "Ca" in nmol/l).
 //' @param user_sim_params A List: contains values for the simulation end ("endTime") and its timesteps ("timestep").
+//'                        With "baselineCa" the simulation starts from an equilibrated state at this calcium concentration (see sim_equilibrate()).
 //' @param user_model_params A List: the model specific parameters. Can contain up to three different vectors named "vols" (model volumes), "init_conc" (initial conditions) and "params" (propensity equation parameters). 
 //' @section Default Parameters of the CamKII Model:
 //' Default Volumes: 
@@ -32,7 +31,7 @@ static std::map <std::string, double> prop_params_map;
 //' Default Reaction Parameters:
 //' * a = -0.22
 //' * b = 1.826
-//' * c = -0.8
+//' * c = -0.8 (former name c_ also accepted)
 //' * k_IB = 0.01
 //' * k_BI = 0.8
 //' * k_PT = 1
@@ -61,75 +60,11 @@ DataFrame sim_camkii(DataFrame user_input_df,
                      List user_sim_params,
                      List user_model_params) {
 
-  // READ INPUT
-  // Provide default model parameters list
-  List default_model_params = init_camkii();
-  // Extract default vectors from list
-  NumericVector default_vols = default_model_params["vols"];
-  NumericVector default_init_conc = default_model_params["init_conc"];
-  NumericVector default_params = default_model_params["params"];
-  // Extract vectors from user supplied list 
-  // If they exist: definition with the default vector gets overwritten
-  NumericVector user_vols = default_vols;
-  if (user_model_params.containsElementNamed("vols")) {
-      user_vols = user_model_params["vols"];
-  } else {
-    Rcout << "Default volume(s) have been used." << std::endl;
-  } 
-  NumericVector user_init_conc = default_init_conc;
-  if (user_model_params.containsElementNamed("init_conc")) {
-    user_init_conc = user_model_params["init_conc"];
-  } else {
-    Rcout << "Default initial condition(s) have been used." << std::endl;
-  }
-  NumericVector user_params = default_params;
-  if (user_model_params.containsElementNamed("params")) {
-    user_params = user_model_params["params"];
-  } else {
-    Rcout << "Default reaction parameter(s) have been used." << std::endl;
-  }
-  // UPDATE DEFAULTS 
-  // Replace entries in default_model_params with user-supplied values if necessary
-  // 1.) Volumes update:
-  CharacterVector user_vols_names = user_vols.names();
-  for (int i = 0; i < user_vols_names.length(); i++) {
-    std::string current_vol_name = as<std::string>(user_vols_names[i]);
-    if (default_vols.containsElementNamed((current_vol_name).c_str())) {
-      // update default values
-      default_vols[current_vol_name] = user_vols[current_vol_name];    
-    } else {
-      Rcout << "No such index! Default values have been used. Check input parameter vectors." << std::endl;
-    }
-  }
-  // 2.) Initial conditions update:
-  CharacterVector user_init_conc_names = user_init_conc.names();
-  for (int i = 0; i < user_init_conc_names.length(); i++) {
-    std::string current_init_conc_name = as<std::string>(user_init_conc_names[i]);
-    if (default_init_conc.containsElementNamed((current_init_conc_name).c_str())) {
-      // update default values
-      default_init_conc[current_init_conc_name] = user_init_conc[current_init_conc_name];    
-    } else {
-      Rcout << "No such index! Default values have been used. Check input parameter vectors." << std::endl;
-    }
-  }
-  // 3.) Propensity equation parameters update:
-  CharacterVector user_params_names = user_params.names();
-  for (int i = 0; i < user_params_names.length(); i++) {
-    std::string current_param_name = as<std::string>(user_params_names[i]);
-    if (default_params.containsElementNamed((current_param_name).c_str())) {
-      // update default values
-      default_params[current_param_name] = user_params[current_param_name];    
-    } else {
-      Rcout << "No such index! Default values have been used. Check input parameter vectors." << std::endl;
-    }
-  }
-  // Put propensity reaction parameters in a map (for function calculate_amu)
-  // (take parameters from vector "default_params" which contains the updated values)
-  CharacterVector default_params_names = default_params.names();
-  for (int n = 0; n < default_params.length(); n++) {
-    std::string current_param_name = as<std::string>(default_params_names[n]);
-    prop_params_map[current_param_name] = default_params[current_param_name];  
-  }
+  // READ INPUT AND UPDATE DEFAULTS
+  // Replace entries in the default model parameters with user-supplied values if necessary
+  List model_params_list = resolve_model_params_camkii(user_model_params, false);
+  NumericVector default_vols = model_params_list["vols"];
+  NumericVector default_init_conc = model_params_list["init_conc"];
   // RUN SIMULATION
   // Return result of the included, model-specific copy of the function "simulator" 
   return simulator_camkii(user_input_df,
@@ -139,144 +74,113 @@ DataFrame sim_camkii(DataFrame user_input_df,
    
 }
 
+//' CamKII Model Deterministic Simulation (exported to R)
+//'
+//' This function compares user-supplied parameters to defaults parameter values, overwrites the defaults if neccessary, and integrates the reaction rate equations of the camkii model with the internal C++ ODE solver.
+//' The equations are generated from the same model definition as the propensities of the stochastic simulation (see sim_camkii() for the default parameters).
+//' @param input_df A Dataframe: the input Calcium time series (with at least two columns: "time" in s and "Ca" in nmol/l).
+//' @param input_sim_params A List: contains values for the simulation end ("endTime") and its timesteps ("timestep") or a vector of output times ("outputTimes"), and optionally the solver tolerances ("rtol", "atol").
+//' @param input_model_params A List: the model specific parameters. Can contain up to three different vectors named "vols" (model volumes), "init_conc" (initial conditions) and "params" (reaction parameters). 
+//' @return A dataframe with the output times, the calcium input and the concentrations of all species.
+//' @examples
+//' detSim_camkii()
+//' @export
+// [[Rcpp::export]]
+DataFrame detSim_camkii(DataFrame input_df,
+                        List input_sim_params,
+                        List input_model_params) {
+
+  // READ INPUT AND UPDATE DEFAULTS
+  List model_params_list = resolve_model_params_camkii(input_model_params, true);
+  NumericVector default_vols = model_params_list["vols"];
+  NumericVector default_init_conc = model_params_list["init_conc"];
+  // RUN SIMULATION
+  return det_simulator_camkii(input_df,
+                              input_sim_params,
+                              default_vols,
+                              default_init_conc);
+
+}
+
 
 
 //********************************/* MODEL DEFINITION */********************************
-// 3. USER INPUT for new models: define model parameters, number of species, 
-// number of reactions, propensity equations and update_system function 
+// 3. USER INPUT for new models: define species, volumes and reaction parameters (with default values),
+// the stoichiometric matrix and the propensity equations. 
+// The stochastic and the deterministic simulation kernels are both generated from this single definition (see model_definition.hpp).
 
-// Default model parameters
-List init() {
-  // Model dimensions
-  nspecies = 5;
-  nreactions = 10;
-  
-  // Default volume(s)
-  NumericVector vols = NumericVector::create(
-    _["vol"] = 5e-15
-  );
-  // Default initial conditions
-  NumericVector init_conc = NumericVector::create(
-    _["W_I"] = 800,
-    _["W_B"] = 0,
-    _["W_P"] = 0,
-    _["W_T"] = 0,
-    _["W_A"]= 0
-  );
-  // Default propensity equation parameters
-  NumericVector params = NumericVector::create(
-    _["a"] = -0.22,
-    _["b"] = 1.826,
-    _["c"] = -0.8,
-    _["k_IB"] = 0.01,
-    _["k_BI"] = 0.8,
-    _["k_PT"] = 1,
-    _["k_TP"] = 1e-12,
-    _["k_TA"] = 0.0008,
-    _["k_AT"] = 0.01,
-    _["k_AA"] = 0.29,
-    _["c_B"] = 0.75,
-    _["c_P"] = 1,
-    _["c_T"] = 0.8,
-    _["c_A"] = 0.8,
-    _["camT"] = 1000,
-    _["Kd"] = 1000,
-    _["Vm_phos"] = 0.005,
-    _["Kd_phos"] = 0.3,
-    _["totalC"] = 800,
-    _["h"] = 4.0
-  );
-    
-  // Combine and return all vectors in a default_params list
-  return List::create(
-    _["vols"] = vols,
-    _["init_conc"] = init_conc,
-    _["params"] = params
-  );
-  
-}
+// Species and default initial conditions [nmol/l]
+#define MODEL_SPECIES(X) \
+  X(W_I, 800) \
+  X(W_B, 0) \
+  X(W_P, 0) \
+  X(W_T, 0) \
+  X(W_A, 0)
+// Default volume(s) [l]
+#define MODEL_VOLS(X) \
+  X(vol, 5e-15)
+// Default propensity equation parameters
+#define MODEL_PARAMS(X) \
+  X(a, -0.22) \
+  X(b, 1.826) \
+  X(c, -0.8) \
+  X(k_IB, 0.01) \
+  X(k_BI, 0.8) \
+  X(k_PT, 1) \
+  X(k_TP, 1e-12) \
+  X(k_TA, 0.0008) \
+  X(k_AT, 0.01) \
+  X(k_AA, 0.29) \
+  X(c_B, 0.75) \
+  X(c_P, 1) \
+  X(c_T, 0.8) \
+  X(c_A, 0.8) \
+  X(camT, 1000) \
+  X(Kd, 1000) \
+  X(Vm_phos, 0.005) \
+  X(Kd_phos, 0.3) \
+  X(totalC, 800) \
+  X(h, 4.0)
+// Former parameter names (of the deSolve based detSim_camkii), still accepted
+#define MODEL_PARAM_ALIASES(X) \
+  X(c_, c)
+// Calcium dependent factors (depend only on parameters and inputs, precomputed once per input interval)
+#define MODEL_FACTORS(X) \
+  X(Ca_h, pow(Ca, h)) \
+  X(cam_bound, (camT * Ca_h) / (Ca_h + pow(Kd, h)))
+// Stoichiometric matrix (rows: species, columns: reactions)
+#define MODEL_STOICHIOMETRY \
+  /* W_I */ -1,  1,  0,  0,  0,  0,  0,  0,  0,  1, \
+  /* W_B */  1, -1, -1,  0,  0,  0,  0,  1,  1,  0, \
+  /* W_P */  0,  0,  1, -1,  1,  0,  0, -1,  0,  0, \
+  /* W_T */  0,  0,  0,  1, -1, -1,  1,  0, -1,  0, \
+  /* W_A */  0,  0,  0,  0,  0,  1, -1,  0,  0, -1
+
+#include "model_definition.hpp"
 
 // Propensity calculation:
-// Calculates the propensities of all CamKII model reactions and stores them in the vector amu.
-void calculate_amu() {
-  
-  // Look up model parameters in array 'model_params' initially
-  double a = prop_params_map["a"];
-  double b = prop_params_map["b"];
-  double c = prop_params_map["c"];
-  double k_IB = prop_params_map["k_IB"];
-  double k_BI = prop_params_map["k_BI"];
-  double k_PT = prop_params_map["k_PT"];
-  double k_TP = prop_params_map["k_TP"];
-  double k_TA = prop_params_map["k_TA"];
-  double k_AT = prop_params_map["k_AT"];
-  double k_AA = prop_params_map["k_AA"];
-  double c_B = prop_params_map["c_B"];
-  double c_P = prop_params_map["c_P"];
-  double c_T = prop_params_map["c_T"];
-  double c_A = prop_params_map["c_A"];
-  double camT = prop_params_map["camT"];
-  double Kd = prop_params_map["Kd"];
-  double Vm_phos = prop_params_map["Vm_phos"];
-  double Kd_phos = prop_params_map["Kd_phos"];
-  double totalC = prop_params_map["totalC"];
-  double h = prop_params_map["h"];
-  
-  amu[0] = x[0] * ((k_IB * camT * pow((double)calcium[ntimepoint],(double)h)) / (pow((double)calcium[ntimepoint],(double)h) + pow((double)Kd,(double)h)));
-  amu[1] = amu[0] + k_BI * x[1];
-  
-  double activeSubunits = (x[1] + x[2] + x[3] + x[4]) / (totalC*f);
-  double prob =  a * activeSubunits + b*(pow((double)activeSubunits,(double)2)) + c*(pow((double)activeSubunits,(double)3));
-  amu[2] = amu[1] +  (totalC*f) * k_AA * prob * ((c_B * x[1]) / pow((double)(totalC*f),(double)2)) * (2*c_B*x[1] + c_P*x[2] + c_T*x[3]+ c_A*x[4]);
+// Calculates the propensities of all CamKII model reactions (particle numbers x, calcium concentration Ca).
+template <typename Real, typename Param>
+void propensities(const model_param_set<Param> &params, const model_factor_set<Param> &factors, double Ca, const Real *x, double f, Real *rate) {
   
-  amu[3] = amu[2] + k_PT * x[2];
-  amu[4] = amu[3] + k_TP * x[3] * pow((double)calcium[ntimepoint],(double)h);
-  amu[5] = amu[4] + k_TA * x[3];
-  amu[6] = amu[5] + k_AT * x[4] * (camT - ((camT * pow((double)calcium[ntimepoint],(double)h)) / (pow((double)calcium[ntimepoint],(double)h) + pow((double)Kd,(double)h))));
-  amu[7] = amu[6] + ((Vm_phos * x[2]) / (Kd_phos + (x[2] / (totalC*f))));
-  amu[8] = amu[7] + ((Vm_phos * x[3]) / (Kd_phos + (x[3] / (totalC*f))));
-  amu[9] = amu[8] + ((Vm_phos * x[4]) / (Kd_phos + (x[4] / (totalC*f))));
+  // Model parameters as local variables (a, b, c, k_IB, ...)
+  MODEL_PARAMS(UNPACK_PARAM)
+  MODEL_FACTORS(UNPACK_FACTOR)
   
+  rate[0] = x[0] * (k_IB * cam_bound); // binding
+  rate[1] = k_BI * x[1]; // binding reverse
   
+  // phosphorylation
+  Real activeSubunits = (x[1] + x[2] + x[3] + x[4]) / (totalC*f);
+  Real prob =  a * activeSubunits + b*(pow(activeSubunits, 2)) + c*(pow(activeSubunits, 3));
+  rate[2] = (totalC*f) * k_AA * prob * ((c_B * x[1]) / pow(totalC*f, 2)) * (2*c_B*x[1] + c_P*x[2] + c_T*x[3]+ c_A*x[4]);
   
-  /*
-  amu[0] = k_IB * x[0] * camT * pow((double)calcium[ntimepoint],(double)h) / (pow((double)calcium[ntimepoint],(double)h) + pow((double)Kd,(double)h) ); // binding
-  amu[1] = amu[0] + k_BI * x[1]; // binding reverse
-    
-  // phoshporylation
-  double activeSubunits = (x[1] + x[2] + x[3] + x[4])/(totalC*f);
-  double prob =  a * activeSubunits + b* pow((double)activeSubunits,(double)2) + c*pow((double)activeSubunits,(double)3);
-  
-  amu[2] = amu[1] +  totalC*f * k_AA *prob  *c_B * x[1]/ pow((double)totalC,(double)2) *(2*c_B*x[1] +  c_P*x[2] + c_T*x[3]+ c_A*x[4]);
-  
-  amu[3] = amu[2] + k_PT * x[2];  //  trapping
-  amu[4] = amu[3] + k_TP * x[3] * pow((double)calcium[ntimepoint],(double)h);  //  trapping reverse
-  amu[5] = amu[4] + k_TA * x[3];  // autonomous
-  amu[6] = amu[5] + k_AT * x[4] * (camT - camT * pow((double)calcium[ntimepoint],(double)h) / (pow((double)calcium[ntimepoint],(double)h) + pow((double)Kd,(double)h))); // autonomous reverse
-  amu[7] = amu[6] +  Vm_phos * (x[2]) / (Kd_phos + x[2]/(f*totalC)); // phosphatase on W_P
-  amu[8] = amu[7] +  Vm_phos * (x[3]) / (Kd_phos + x[3]/(f*totalC)); // phosphatase on W_T
-  amu[9] = amu[8] + Vm_phos * (x[4]) / (Kd_phos + x[4]/(f*totalC)); // phosphatase on W_A
-  */
+  rate[3] = k_PT * x[2]; // trapping
+  rate[4] = k_TP * x[3] * Ca_h; // trapping reverse
+  rate[5] = k_TA * x[3]; // autonomous
+  rate[6] = k_AT * x[4] * (camT - cam_bound); // autonomous reverse
+  rate[7] = ((Vm_phos * x[2]) / (Kd_phos + (x[2] / (totalC*f)))); // phosphatase on W_P
+  rate[8] = ((Vm_phos * x[3]) / (Kd_phos + (x[3] / (totalC*f)))); // phosphatase on W_T
+  rate[9] = ((Vm_phos * x[4]) / (Kd_phos + (x[4] / (totalC*f)))); // phosphatase on W_A
   
 }
-
-// Stoichiometric matrix
-NumericMatrix get_stM() {
-  
-  // initialize stoich matrix (with zeroes)
-  NumericMatrix stM(nspecies, nreactions);
-  // create stoich matrix row vectors
-  NumericVector stM_row1 = {-1, 1, 0, 0, 0, 0, 0, 0, 0, 1};
-  NumericVector stM_row2 = {1, -1, -1, 0, 0, 0, 0, 1, 1, 0};
-  NumericVector stM_row3 = {0, 0, 1, -1, 1, 0, 0, -1, 0, 0};
-  NumericVector stM_row4 = {0, 0, 0, 1, -1, -1, 1, 0, -1, 0};
-  NumericVector stM_row5 = {0, 0, 0, 0, 0, 1, -1, 0, 0, -1};
-  // fill rows of stoich matrix
-  stM(0, _) = stM_row1;
-  stM(1, _) = stM_row2;
-  stM(2, _) = stM_row3;
-  stM(3, _) = stM_row4;
-  stM(4, _) = stM_row5;
-  
-  return stM;  
-}
\ No newline at end of file
@@ -0,0 +1,129 @@
+#include <string>
+#include <Rcpp.h>
+#include "model_registry.hpp"
+#include "sim_params.hpp"
+#include "checkpoint.hpp"
+using namespace Rcpp;
+
+
+//' Checkpointed Stochastic Simulation (exported to R)
+//'
+//' Runs a single stochastic simulation of a model (Gillespie's Direct Method, as sim_<MODEL_NAME>()) and writes its complete state
+//' (particle numbers, time, input and output position, random number generator state and the outputs so far) to a checkpoint file
+//' at regular intervals of simulated time. If the checkpoint file already exists and belongs to the same model and simulation problem
+//' (input, output times and parameters), the simulation continues from the checkpoint with exactly the same result as an uninterrupted run.
+//' The last checkpoint can be used to start replicates of a new input from the final state with sim_fork().
+//' @param model A string: the name of the model ("ano", "calcineurin", "calmodulin", "camkii", "glycphos" or "pkc").
+//' @param input_df A Dataframe: the input Calcium time series (with at least two columns: "time" in s and "Ca" in nmol/l).
+//' @param input_sim_params A List: contains values for the simulation end ("endTime") and its timesteps ("timestep") or a vector of output times ("outputTimes"),
+//'                         the simulated time between two checkpoints ("checkpointInterval" in s, default: a tenth of the simulated time) and optionally a "seed".
+//'                         With "baselineCa" the run starts from an equilibrated state at this calcium concentration (see sim_equilibrate()).
+//' @param input_model_params A List: the model specific parameters. Can contain up to three different vectors named "vols" (model volumes), "init_conc" (initial conditions) and "params" (reaction parameters).
+//' @param checkpoint_file A string: the path of the checkpoint file.
+//' @return A dataframe with the output times, the calcium input and the concentrations of all species.
+//' @examples
+//' ca <- data.frame(time = seq(0, 100, by = 0.1), Ca = 200)
+//' ckpt <- tempfile(fileext = ".ckpt")
+//' sim_checkpointed("camkii", ca, list(endTime = 100, timestep = 1, checkpointInterval = 10), list(), ckpt)
+//' @export
+// [[Rcpp::export]]
+DataFrame sim_checkpointed(std::string model,
+                           DataFrame input_df,
+                           List input_sim_params,
+                           List input_model_params,
+                           std::string checkpoint_file) {
+
+  // READ INPUT AND UPDATE DEFAULTS
+  const model_info &info = find_model(model);
+  sim_problem pb = read_sim_problem(info, input_df, input_sim_params, input_model_params);
+  double interval = sim_param(input_sim_params, "checkpointInterval", (pb.end_time() - pb.input_time_at(0)) / 10);
+  if (!(interval > 0)) {
+    stop("checkpointInterval has to be positive.");
+  }
+  std::string path = as<std::string>(Function("path.expand")(checkpoint_file));
+
+  // Continue from an existing checkpoint of the same problem or start at the beginning of the input
+  checkpoint c;
+  c.model = model;
+  c.fingerprint = problem_fingerprint(pb);
+  std::vector<double> out(pb.output_times.size()*info.nspecies, 0.0);
+  checkpoint saved;
+  if (read_checkpoint(path, saved) && (saved.model == c.model) && (saved.fingerprint == c.fingerprint) &&
+      ((int)saved.state.x.size() == info.nspecies)) {
+    c.state = saved.state;
+    std::copy(saved.out.begin(), saved.out.end(), out.begin());
+    Rcout << "Continuing from checkpoint at time " << c.state.time << " s." << std::endl;
+  } else {
+    c.state = ssa_initial_state(pb, sim_seed(input_sim_params), 0);
+  }
+
+  // RUN SIMULATION
+  double next_checkpoint = c.state.time + interval;
+  while (!c.state.finished(pb)) {
+    checkUserInterrupt();
+    info.ssa_simulator(pb, c.state, next_checkpoint, &out[0], ssa_check_events, 0, 0);
+    if ((c.state.time < next_checkpoint) && !c.state.finished(pb)) continue;
+    c.out.assign(out.begin(), out.begin() + (size_t)c.state.noutput*info.nspecies);
+    if (!write_checkpoint(path, c)) {
+      stop("Cannot write checkpoint file " + path);
+    }
+    next_checkpoint = c.state.time + interval;
+  }
+
+  return trajectory_frame(info, pb, out);
+}
+
+//' Ensemble Simulation from a Checkpoint (exported to R)
+//'
+//' Simulates independent replicates of a model (as sim_ensemble()) that all start from the particle numbers saved in a checkpoint of sim_checkpointed(),
+//' e.g. to equilibrate a model once and then simulate many replicates of a stimulation protocol from the equilibrated state.
+//' The replicates simulate the given input from its start with their own random number streams; the initial conditions in input_model_params are replaced by the checkpoint.
+//' @param model A string: the name of the model the checkpoint was written for.
+//' @param checkpoint_file A string: the path of the checkpoint file.
+//' @param input_df A Dataframe: the input Calcium time series (with at least two columns: "time" in s and "Ca" in nmol/l).
+//' @param input_sim_params A List: contains values for the simulation end ("endTime") and its timesteps ("timestep") or a vector of output times ("outputTimes"), and optionally a "seed".
+//' @param input_model_params A List: the model specific parameters. Can contain the vectors "vols" (model volumes) and "params" (reaction parameters).
+//' @param nreplicates An integer: the number of replicates.
+//' @return A dataframe with the replicate index, the output times, the calcium input and the concentrations of all species (one block of rows per replicate).
+//' @examples
+//' ca <- data.frame(time = seq(0, 100, by = 0.1), Ca = 200)
+//' ckpt <- tempfile(fileext = ".ckpt")
+//' sim_checkpointed("calmodulin", ca, list(endTime = 100, timestep = 1), list(), ckpt)
+//' pulse <- data.frame(time = seq(0, 10, by = 0.01), Ca = ifelse(seq(0, 10, by = 0.01) < 1, 2000, 200))
+//' sim_fork("calmodulin", ckpt, pulse, list(endTime = 10, timestep = 0.1), list(), nreplicates = 100)
+//' @export
+// [[Rcpp::export]]
+DataFrame sim_fork(std::string model,
+                   std::string checkpoint_file,
+                   DataFrame input_df,
+                   List input_sim_params,
+                   List input_model_params,
+                   int nreplicates = 100) {
+
+  // READ INPUT AND UPDATE DEFAULTS
+  const model_info &info = find_model(model);
+  if (nreplicates < 1) {
+    stop("nreplicates has to be at least 1.");
+  }
+  std::string path = as<std::string>(Function("path.expand")(checkpoint_file));
+  checkpoint c;
+  if (!read_checkpoint(path, c)) {
+    stop("Cannot read checkpoint file " + path);
+  }
+  if ((c.model != model) || ((int)c.state.x.size() != info.nspecies)) {
+    stop("The checkpoint file " + path + " belongs to the model '" + c.model + "'.");
+  }
+  ensemble_config cfg;
+  static_cast<sim_problem &>(cfg) = read_sim_problem(info, input_df, input_sim_params, input_model_params);
+  cfg.x0 = c.state.x;
+  cfg.x0_pool.clear();
+  cfg.nreplicates = nreplicates;
+  cfg.seed = sim_seed(input_sim_params);
+  cfg.check_interrupt = &sim_check_interrupt;
+
+  // RUN SIMULATION
+  std::vector<double> out;
+  info.ensemble_simulator(cfg, out);
+
+  return ensemble_frame(info, cfg, out);
+}
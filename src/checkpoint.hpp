@@ -0,0 +1,129 @@
+#ifndef CHECKPOINT_HPP
+#define CHECKPOINT_HPP
+
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstring>
+#include <stdint.h>
+#include "ssa_engine.hpp"
+
+
+// Checkpoint of a single stochastic simulation run (binary file)
+// Contains the model name, a fingerprint of the simulation problem (inputs, output times, parameters),
+// the complete run state including the random number generator, and the outputs recorded so far.
+struct checkpoint {
+  std::string model;
+  uint64_t fingerprint;
+  ssa_state state;
+  std::vector<double> out;  // concentrations at the output times before state.noutput
+};
+
+// Fingerprint of a simulation problem (FNV-1a over all numbers): a checkpoint is only continued with the same problem
+inline uint64_t problem_fingerprint(const sim_problem &pb) {
+  uint64_t h = 0xcbf29ce484222325ULL;
+  auto add = [&h](const std::vector<double> &v) {
+    uint64_t n = v.size();
+    const unsigned char *b = reinterpret_cast<const unsigned char *>(&n);
+    for (size_t i = 0; i < sizeof(n); i++) h = (h ^ b[i]) * 0x100000001b3ULL;
+    if (n == 0) return;
+    b = reinterpret_cast<const unsigned char *>(&v[0]);
+    for (size_t i = 0; i < n*sizeof(double); i++) h = (h ^ b[i]) * 0x100000001b3ULL;
+  };
+  add(pb.input_time);
+  add(pb.input_ca);
+  add(pb.output_times);
+  add(pb.params);
+  add(pb.x0);
+  add(pb.x0_pool);
+  add(std::vector<double>(1, pb.f));
+  if (pb.generator.active()) {
+    const stimulus &g = pb.generator;
+    const double description[] = { (double)g.type, g.start, g.resolution, g.origin, g.baseline, g.amplitude, g.frequency, g.phase, g.duty,
+                                   g.tau, g.width, g.noise, (double)(g.seed >> 32), (double)(g.seed & 0xffffffffULL) };
+    add(std::vector<double>(description, description + sizeof(description) / sizeof(double)));
+  }
+  for (size_t i = 0; i < pb.inputs.values.size(); i++) {
+    add(std::vector<double>(1, pb.inputs.param_index[i]));
+    add(pb.inputs.values[i]);
+  }
+  return h;
+}
+
+// File layout (native byte order): magic, version, model name, fingerprint, state, recorded outputs
+static const char checkpoint_magic[8] = { 'C', 'M', 'L', 'C', 'K', 'P', 'T', '\0' };
+static const uint32_t checkpoint_version = 1;
+
+// Write the checkpoint (to a temporary file first, which replaces the old checkpoint when complete)
+inline bool write_checkpoint(const std::string &path, const checkpoint &c) {
+  std::string tmp = path + ".tmp";
+  FILE *fp = fopen(tmp.c_str(), "wb");
+  if (!fp) return false;
+  const ssa_state &s = c.state;
+  uint32_t name_length = c.model.size();
+  uint32_t nspecies = s.x.size();
+  int32_t cursors[2] = { s.ntimepoint, s.noutput };
+  double times[2] = { s.time, s.budget };
+  uint64_t nout = c.out.size();
+  bool ok = (fwrite(checkpoint_magic, 1, 8, fp) == 8) &&
+            (fwrite(&checkpoint_version, sizeof(uint32_t), 1, fp) == 1) &&
+            (fwrite(&name_length, sizeof(uint32_t), 1, fp) == 1) &&
+            (fwrite(c.model.data(), 1, name_length, fp) == name_length) &&
+            (fwrite(&c.fingerprint, sizeof(uint64_t), 1, fp) == 1) &&
+            (fwrite(&nspecies, sizeof(uint32_t), 1, fp) == 1) &&
+            (fwrite(cursors, sizeof(int32_t), 2, fp) == 2) &&
+            (fwrite(times, sizeof(double), 2, fp) == 2) &&
+            (fwrite(&s.nevents, sizeof(uint64_t), 1, fp) == 1) &&
+            (fwrite(s.rng.s, sizeof(uint64_t), 4, fp) == 4) &&
+            (fwrite(&s.x[0], sizeof(double), nspecies, fp) == nspecies) &&
+            (fwrite(&nout, sizeof(uint64_t), 1, fp) == 1) &&
+            (nout == 0 || fwrite(&c.out[0], sizeof(double), nout, fp) == nout);
+  ok = (fclose(fp) == 0) && ok;
+  if (!ok) {
+    remove(tmp.c_str());
+    return false;
+  }
+  remove(path.c_str());
+  return rename(tmp.c_str(), path.c_str()) == 0;
+}
+
+// Read a checkpoint (false if the file does not exist or is not a valid checkpoint)
+inline bool read_checkpoint(const std::string &path, checkpoint &c) {
+  FILE *fp = fopen(path.c_str(), "rb");
+  if (!fp) return false;
+  char magic[8];
+  uint32_t version = 0, name_length = 0, nspecies = 0;
+  int32_t cursors[2] = { 0, 0 };
+  double times[2] = { 0.0, 0.0 };
+  uint64_t nout = 0;
+  bool ok = (fread(magic, 1, 8, fp) == 8) && (memcmp(magic, checkpoint_magic, 8) == 0) &&
+            (fread(&version, sizeof(uint32_t), 1, fp) == 1) && (version == checkpoint_version) &&
+            (fread(&name_length, sizeof(uint32_t), 1, fp) == 1) && (name_length < 256);
+  if (ok) {
+    c.model.resize(name_length);
+    ok = (name_length == 0 || fread(&c.model[0], 1, name_length, fp) == name_length) &&
+         (fread(&c.fingerprint, sizeof(uint64_t), 1, fp) == 1) &&
+         (fread(&nspecies, sizeof(uint32_t), 1, fp) == 1) && (nspecies > 0) && (nspecies < 100000) &&
+         (fread(cursors, sizeof(int32_t), 2, fp) == 2) &&
+         (fread(times, sizeof(double), 2, fp) == 2) &&
+         (fread(&c.state.nevents, sizeof(uint64_t), 1, fp) == 1) &&
+         (fread(c.state.rng.s, sizeof(uint64_t), 4, fp) == 4);
+  }
+  if (ok) {
+    c.state.x.resize(nspecies);
+    ok = (fread(&c.state.x[0], sizeof(double), nspecies, fp) == nspecies) &&
+         (fread(&nout, sizeof(uint64_t), 1, fp) == 1) && (nout == (uint64_t)cursors[1] * nspecies);
+  }
+  if (ok) {
+    c.out.resize(nout);
+    ok = (nout == 0 || fread(&c.out[0], sizeof(double), nout, fp) == nout);
+  }
+  fclose(fp);
+  c.state.ntimepoint = cursors[0];
+  c.state.noutput = cursors[1];
+  c.state.time = times[0];
+  c.state.budget = times[1];
+  return ok;
+}
+
+#endif
@@ -0,0 +1,481 @@
+#include <string>
+#include <vector>
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <memory>
+#include <cstdio>
+#include <Rcpp.h>
+#include "columnar_file.hpp"
+#include "model_registry.hpp"
+#include "sim_params.hpp"
+#include "result_columns.hpp"
+using namespace Rcpp;
+
+
+// Columnar result file (native byte order, all sections 8 byte aligned)
+// header:  magic "CMLCOLS1", number of columns, size of the names, the column names (NUL-terminated), padding
+// chunks:  number of rows, per column {encoding (uint32), reserved (uint32), payload size, divisor (double)}, the payloads (padded)
+// footer:  the file offsets of the chunks, number of chunks, total number of rows, magic "CMLCOLSE"
+// The footer is written last, so a file of an interrupted simulation is recognised as incomplete.
+static const char columnar_magic[8] = {'C', 'M', 'L', 'C', 'O', 'L', 'S', '1'};
+static const char columnar_end_magic[8] = {'C', 'M', 'L', 'C', 'O', 'L', 'S', 'E'};
+
+struct columnar_trailer {
+  uint64_t nchunks, nrow;
+  char magic[8];
+};
+
+struct columnar_block_header {
+  uint32_t encoding, reserved;
+  uint64_t nbytes;
+  double divisor;
+};
+
+
+columnar_writer::columnar_writer(const std::string &path, const std::vector<std::string> &names, const std::vector<double> &divisors,
+                                 bool single, bool compress)
+  : nrow(0), bytes(0), path(path), out(path.c_str(), std::ios::binary | std::ios::trunc), divisors(divisors),
+    single(single), compress(compress) {
+  if (!out) {
+    stop("The file '" + path + "' cannot be written.");
+  }
+  std::string names_bytes;
+  for (size_t c = 0; c < names.size(); c++) {
+    names_bytes += names[c];
+    names_bytes += '\0';
+  }
+  uint64_t sizes[2] = {names.size(), names_bytes.size()};
+  write(columnar_magic, 8);
+  write(sizes, sizeof(sizes));
+  write(names_bytes.data(), names_bytes.size());
+  pad();
+}
+
+void columnar_writer::write(const void *p, size_t n) {
+  out.write(static_cast<const char *>(p), n);
+  bytes += n;
+}
+
+void columnar_writer::pad() {
+  static const char zeros[8] = {0};
+  if (bytes % 8) write(zeros, 8 - bytes % 8);
+}
+
+// Delta encoding of n values as integers value * divisor (false if a value is not reproduced bit for bit)
+static bool delta_encode(const double *v, size_t n, double divisor, std::string &payload) {
+  int64_t previous = 0;
+  for (size_t i = 0; i < n; i++) {
+    double scaled = v[i] * divisor;
+    if (!(std::fabs(scaled) < 4e18)) return false;
+    int64_t k = (int64_t)std::llround(scaled);
+    double back = (double)k / divisor;
+    if (std::memcmp(&back, &v[i], sizeof(double)) != 0) return false;
+    put_varint(payload, k - previous);
+    previous = k;
+  }
+  return true;
+}
+
+void columnar_writer::write_chunk(const std::vector<const double *> &columns, size_t n) {
+  if (!out.is_open()) {
+    stop("The file '" + path + "' is already closed.");
+  }
+  // Encode all columns first (the block headers precede the payloads)
+  std::vector<columnar_block_header> blocks(columns.size());
+  std::vector<std::string> payloads(columns.size());
+  for (size_t c = 0; c < columns.size(); c++) {
+    columnar_block_header &b = blocks[c];
+    b.reserved = 0;
+    b.divisor = divisors[c];
+    std::string &payload = payloads[c];
+    const size_t raw_size = n * (single ? sizeof(float) : sizeof(double));
+    if (compress && (divisors[c] > 0) && delta_encode(columns[c], n, divisors[c], payload) && (payload.size() < raw_size)) {
+      b.encoding = column_delta;
+    } else if (single) {
+      b.encoding = column_float32;
+      std::vector<float> values(columns[c], columns[c] + n);
+      payload.assign(reinterpret_cast<const char *>(values.data()), n * sizeof(float));
+    } else {
+      b.encoding = column_float64;
+      payload.assign(reinterpret_cast<const char *>(columns[c]), n * sizeof(double));
+    }
+    b.nbytes = payload.size();
+  }
+  chunk_offsets.push_back(bytes);
+  uint64_t chunk_rows = n;
+  write(&chunk_rows, sizeof(chunk_rows));
+  if (!blocks.empty()) write(&blocks[0], blocks.size() * sizeof(columnar_block_header));
+  for (size_t c = 0; c < payloads.size(); c++) {
+    write(payloads[c].data(), payloads[c].size());
+    pad();
+  }
+  nrow += n;
+  if (!out) {
+    stop("The file '" + path + "' cannot be written (disk full?).");
+  }
+}
+
+void columnar_writer::close() {
+  if (!out.is_open()) return;
+  columnar_trailer t;
+  t.nchunks = chunk_offsets.size();
+  t.nrow = nrow;
+  std::memcpy(t.magic, columnar_end_magic, 8);
+  if (!chunk_offsets.empty()) write(&chunk_offsets[0], chunk_offsets.size() * sizeof(uint64_t));
+  write(&t, sizeof(t));
+  out.close();
+  if (!out) {
+    stop("The file '" + path + "' cannot be written (disk full?).");
+  }
+}
+
+
+columnar_reader::columnar_reader(const std::string &path) : path(path), nrow(0), file(path) {
+  if (!file.data) {
+    stop("The file '" + path + "' cannot be read.");
+  }
+  const unsigned char *data = file.data;
+  const size_t size = file.size;
+  columnar_trailer t;
+  uint64_t sizes[2];
+  if ((size < 8 + sizeof(sizes) + sizeof(t)) || (std::memcmp(data, columnar_magic, 8) != 0)) {
+    stop("'" + path + "' is not a simulation result file.");
+  }
+  std::memcpy(&t, data + size - sizeof(t), sizeof(t));
+  std::memcpy(sizes, data + 8, sizeof(sizes));
+  const uint64_t ncol = sizes[0];
+  const uint64_t names_end = 8 + sizeof(sizes) + sizes[1];
+  if ((std::memcmp(t.magic, columnar_end_magic, 8) != 0) || (sizes[1] > size) || (names_end > size) ||
+      (t.nchunks > size / sizeof(uint64_t)) || (t.nchunks * sizeof(uint64_t) + sizeof(t) > size)) {
+    stop("'" + path + "' is incomplete (e.g. the simulation was interrupted) or damaged.");
+  }
+  // Column names
+  const char *name = reinterpret_cast<const char *>(data + 8 + sizeof(sizes));
+  const char *names_stop = reinterpret_cast<const char *>(data + names_end);
+  for (uint64_t c = 0; c < ncol; c++) {
+    const char *name_end = std::find(name, names_stop, '\0');
+    if (name_end == names_stop) stop("'" + path + "' is damaged (column names).");
+    names.push_back(std::string(name, name_end));
+    name = name_end + 1;
+  }
+  // Chunk index (block headers only, the payloads are not touched)
+  const size_t index_offset = size - sizeof(t) - t.nchunks * sizeof(uint64_t);
+  for (uint64_t k = 0; k < t.nchunks; k++) {
+    uint64_t offset;
+    std::memcpy(&offset, data + index_offset + k * sizeof(uint64_t), sizeof(offset));
+    chunk ch;
+    ch.first_row = nrow;
+    if ((offset > index_offset) || (index_offset - offset < sizeof(uint64_t) + ncol * sizeof(columnar_block_header))) {
+      stop("'" + path + "' is damaged (chunk index).");
+    }
+    std::memcpy(&ch.nrow, data + offset, sizeof(uint64_t));
+    uint64_t payload = offset + sizeof(uint64_t) + ncol * sizeof(columnar_block_header);
+    for (uint64_t c = 0; c < ncol; c++) {
+      columnar_block_header b;
+      std::memcpy(&b, data + offset + sizeof(uint64_t) + c * sizeof(columnar_block_header), sizeof(b));
+      column_block block = {b.encoding, payload, b.nbytes, b.divisor};
+      size_t value_size = (b.encoding == column_float64) ? sizeof(double) : ((b.encoding == column_float32) ? sizeof(float) : 0);
+      if ((b.encoding > column_delta) || (b.nbytes > index_offset - payload) || (value_size && (b.nbytes != ch.nrow * value_size))) {
+        stop("'" + path + "' is damaged (column data).");
+      }
+      ch.columns.push_back(block);
+      payload += (b.nbytes + 7) / 8 * 8;
+    }
+    nrow += ch.nrow;
+    chunks.push_back(ch);
+  }
+  if (nrow != t.nrow) {
+    stop("'" + path + "' is damaged (number of rows).");
+  }
+}
+
+int columnar_reader::column(const std::string &name) const {
+  for (size_t c = 0; c < names.size(); c++) {
+    if (names[c] == name) return c;
+  }
+  return -1;
+}
+
+void columnar_reader::chunk_rows(uint64_t row, uint64_t &from, uint64_t &to) const {
+  size_t lo = 0, hi = chunks.size();
+  while (hi - lo > 1) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (chunks[mid].first_row <= row) lo = mid; else hi = mid;
+  }
+  from = chunks.empty() ? 0 : chunks[lo].first_row;
+  to = chunks.empty() ? 0 : chunks[lo].first_row + chunks[lo].nrow;
+}
+
+column_encoding columnar_reader::encoding(int c) const {
+  size_t count[3] = {0, 0, 0};
+  for (size_t k = 0; k < chunks.size(); k++) count[chunks[k].columns[c].encoding]++;
+  return (column_encoding)(std::max_element(count, count + 3) - count);
+}
+
+void columnar_reader::read(int c, uint64_t from, uint64_t to, double *out) const {
+  for (size_t k = 0; k < chunks.size(); k++) {
+    const chunk &ch = chunks[k];
+    if ((ch.first_row + ch.nrow <= from) || (ch.first_row >= to)) continue;
+    const column_block &b = ch.columns[c];
+    const unsigned char *p = file.data + b.offset;
+    const uint64_t first = std::max(from, ch.first_row) - ch.first_row;
+    const uint64_t last = std::min(to, ch.first_row + ch.nrow) - ch.first_row;
+    double *dest = out + (ch.first_row + first - from);
+    if (b.encoding == column_float64) {
+      std::memcpy(dest, p + first * sizeof(double), (last - first) * sizeof(double));
+    } else if (b.encoding == column_float32) {
+      for (uint64_t i = first; i < last; i++) {
+        float value;
+        std::memcpy(&value, p + i * sizeof(float), sizeof(float));
+        dest[i - first] = value;
+      }
+    } else {
+      // Differences from the start of the chunk
+      const unsigned char *end = p + b.nbytes;
+      int64_t value = 0, delta;
+      for (uint64_t i = 0; i < last; i++) {
+        if (!get_varint(p, end, delta)) stop("'" + path + "' is damaged (column data).");
+        value += delta;
+        if (i >= first) dest[i - first] = (double)value / b.divisor;
+      }
+    }
+  }
+}
+
+
+// Column of a result file decoded on access (the columns of sim_file_read() are views of it, see result_columns.hpp)
+// Element access decodes the chunk of the row and keeps it for the following rows; regions are decoded directly.
+// The reader (and with it the mapping) lives as long as the file handle or any column read from it.
+class file_column : public column_source {
+public:
+  file_column(std::shared_ptr<const columnar_reader> reader, int c, uint64_t first)
+    : reader(reader), c(c), first(first), block_from(0), block_to(0) {}
+
+  double element(R_xlen_t row) const {
+    const uint64_t r = first + row;
+    if ((r < block_from) || (r >= block_to)) {
+      uint64_t from, to;
+      reader->chunk_rows(r, from, to);
+      block.resize(to - from);
+      decode(from, to, &block[0]);
+      block_from = from;
+      block_to = to;
+    }
+    return block[r - block_from];
+  }
+  void region(R_xlen_t from, R_xlen_t n, double *out) const {
+    decode(first + from, first + from + n, out);
+  }
+
+private:
+  // Called from R's ALTREP methods: errors (damaged file) are raised as R errors after the C++ objects are released
+  void decode(uint64_t from, uint64_t to, double *out) const {
+    char message[512] = "";
+    try {
+      reader->read(c, from, to, out);
+    } catch (std::exception &e) {
+      std::snprintf(message, sizeof(message), "%s", e.what());
+    }
+    if (message[0]) Rf_error("%s", message);
+  }
+
+  std::shared_ptr<const columnar_reader> reader;
+  int c;
+  uint64_t first;
+  mutable std::vector<double> block;
+  mutable uint64_t block_from, block_to;
+};
+
+static std::shared_ptr<columnar_reader> as_sim_file(SEXP file) {
+  if ((TYPEOF(file) != EXTPTRSXP) || !Rf_inherits(file, "sim_file")) {
+    stop("file has to be an opened simulation result file (see sim_file_open()).");
+  }
+  XPtr<std::shared_ptr<columnar_reader> > ptr(file);
+  if (ptr.get() == 0) {
+    stop("The result file is no longer open (e.g. after saving and loading the R session); open it again with sim_file_open().");
+  }
+  return *ptr;
+}
+
+
+//' Open a Simulation Result File (exported to R)
+//'
+//' Opens a columnar result file written by sim_ensemble_file(). The file is memory-mapped: opening only reads the index of its chunks,
+//' whatever the size of the file, and the columns returned by sim_file_read() are decoded from the mapping when they are used. The data
+//' stays off the R heap until it is used, and the pages of the file are shared between R sessions reading it.
+//' @param path A string: the path of the file.
+//' @return A handle of the file (class "sim_file") with the attributes "path", "columns" (column names), "encodings" (per column: "float64",
+//'         "float32" or "delta"), "nrow" and "size" (bytes).
+//' @examples
+//' ca <- data.frame(time = seq(0, 10, by = 0.01), Ca = 200)
+//' path <- file.path(tempdir(), "calmodulin.cmlc")
+//' sim_ensemble_file("calmodulin", ca, list(endTime = 10, timestep = 0.1), list(), path, nreplicates = 1000)
+//' res <- sim_file_open(path)
+//' attr(res, "columns")
+//' @export
+// [[Rcpp::export]]
+SEXP sim_file_open(std::string path) {
+  XPtr<std::shared_ptr<columnar_reader> > file(new std::shared_ptr<columnar_reader>(new columnar_reader(path)), true);
+  const columnar_reader &reader = **file;
+  const char *encoding_names[] = {"float64", "float32", "delta"};
+  CharacterVector columns(reader.names.size()), encodings(reader.names.size());
+  for (size_t c = 0; c < reader.names.size(); c++) {
+    columns[c] = reader.names[c];
+    encodings[c] = encoding_names[reader.encoding(c)];
+  }
+  file.attr("class") = "sim_file";
+  file.attr("path") = path;
+  file.attr("columns") = columns;
+  file.attr("encodings") = encodings;
+  file.attr("nrow") = (double)reader.nrow;
+  file.attr("size") = (double)reader.size();
+  return file;
+}
+
+//' Read a Simulation Result File (exported to R)
+//'
+//' Reads columns and rows of a result file opened with sim_file_open(). Nothing is decoded on reading: the columns of the result are views
+//' of the memory-mapped file (with R >= 3.5), and elements, subsets and summaries decode only the chunks of the file holding the rows
+//' they use. A column is decoded completely when R needs it as an ordinary vector (e.g. when it is modified). Without ALTREP (R < 3.5)
+//' the columns are decoded on reading.
+//' @param file A result file (see sim_file_open()).
+//' @param columns A character vector: the names of the columns to read (default: all).
+//' @param from A number: the first row to read.
+//' @param to A number: the last row to read (default: the last row of the file).
+//' @return A dataframe with the requested columns and rows.
+//' @examples
+//' ca <- data.frame(time = seq(0, 10, by = 0.01), Ca = 200)
+//' path <- file.path(tempdir(), "calmodulin.cmlc")
+//' res <- sim_ensemble_file("calmodulin", ca, list(endTime = 10, timestep = 0.1), list(), path, nreplicates = 1000)
+//' sim_file_read(res, c("time", "Prot_act"), from = 1, to = 101)
+//' @export
+// [[Rcpp::export]]
+DataFrame sim_file_read(SEXP file, CharacterVector columns = CharacterVector::create(), double from = 1, double to = -1) {
+  std::shared_ptr<const columnar_reader> shared = as_sim_file(file);
+  const columnar_reader &reader = *shared;
+  if (to < 0) to = reader.nrow;
+  if (!(from >= 1) || !(to >= from - 1) || !(to <= reader.nrow) || (from != std::floor(from)) || (to != std::floor(to))) {
+    stop("from and to have to be row numbers of the file (1 to " + std::to_string((unsigned long long)reader.nrow) + ").");
+  }
+  std::vector<int> selected;
+  if (columns.length() == 0) {
+    for (size_t c = 0; c < reader.names.size(); c++) selected.push_back(c);
+  }
+  for (int i = 0; i < columns.length(); i++) {
+    int c = reader.column(as<std::string>(columns[i]));
+    if (c < 0) stop("The file has no column '" + as<std::string>(columns[i]) + "'.");
+    selected.push_back(c);
+  }
+  const uint64_t first = (uint64_t)from - 1, last = (uint64_t)to;
+  List result(selected.size());
+  CharacterVector names(selected.size());
+  for (size_t i = 0; i < selected.size(); i++) {
+    std::shared_ptr<const column_source> source(new file_column(shared, selected[i], first));
+    result[i] = result_column(result_view(source, last - first));
+    names[i] = reader.names[selected[i]];
+  }
+  return result_frame(result, names, last - first);
+}
+
+//' Ensemble Simulation to a Result File (exported to R)
+//'
+//' Simulates replicates of the stochastic simulation of a model like sim_ensemble() and writes them directly to a chunked columnar
+//' result file instead of returning a dataframe, so ensembles far larger than the memory of the R session can be simulated and
+//' stored. The replicates are simulated in parts of chunk_replicates, and every part is written as one chunk of the file (the columns
+//' "replicate", "time", "Ca" and one per species). Within a chunk, columns are stored as doubles, as floats (precision = "single",
+//' about 7 significant digits) or, with compression, losslessly as differences of consecutive rows in variable length integers:
+//' the concentrations of the stochastic simulation are particle numbers divided by a constant factor, which change little between
+//' output times. The replicates are the same as those of sim_ensemble() with the same seed, whatever the chunk size.
+//' @param model A string: the name of the model ("ano", "calcineurin", "calmodulin", "camkii", "glycphos" or "pkc").
+//' @param input_df A Dataframe: the input Calcium time series (with at least two columns: "time" in s and "Ca" in nmol/l).
+//' @param input_sim_params A List: contains values for the simulation end ("endTime") and its timesteps ("timestep") or a vector of output times ("outputTimes"), and optionally a "seed".
+//'                         With "baselineCa" the replicates start from equilibrated states at this calcium concentration (see sim_equilibrate()).
+//' @param input_model_params A List: the model specific parameters. Can contain up to three different vectors named "vols" (model volumes), "init_conc" (initial conditions) and "params" (reaction parameters).
+//' @param path A string: the path of the result file (overwritten if it exists).
+//' @param nreplicates An integer: the number of replicates.
+//' @param chunk_replicates An integer: the number of replicates per chunk (simulated and held in memory at once).
+//' @param precision A string: "double" or "single" (floats for the columns that are not compressed).
+//' @param compression A logical: whether columns are delta encoded where this is lossless.
+//' @return The opened result file (see sim_file_open()).
+//' @examples
+//' ca <- data.frame(time = seq(0, 10, by = 0.01), Ca = 200)
+//' path <- file.path(tempdir(), "calmodulin.cmlc")
+//' res <- sim_ensemble_file("calmodulin", ca, list(endTime = 10, timestep = 0.1), list(), path, nreplicates = 10000)
+//' attr(res, "size")
+//' @export
+// [[Rcpp::export]]
+SEXP sim_ensemble_file(std::string model,
+                       DataFrame input_df,
+                       List input_sim_params,
+                       List input_model_params,
+                       std::string path,
+                       int nreplicates = 100,
+                       int chunk_replicates = 1000,
+                       std::string precision = "double",
+                       bool compression = true) {
+
+  // READ INPUT AND UPDATE DEFAULTS
+  const model_info &info = find_model(model);
+  const int ns = info.nspecies;
+  ensemble_config cfg;
+  static_cast<sim_problem &>(cfg) = read_sim_problem(info, input_df, input_sim_params, input_model_params);
+  if ((nreplicates < 0) || (chunk_replicates < 1)) {
+    stop("nreplicates has to be non-negative and chunk_replicates positive.");
+  }
+  if ((precision != "double") && (precision != "single")) {
+    stop("precision has to be \"double\" or \"single\".");
+  }
+  cfg.seed = sim_seed(input_sim_params);
+  cfg.check_interrupt = &sim_check_interrupt;
+  const int noutput = cfg.output_times.size();
+  // Columns: replicate, time, Ca (delta encoded if they are multiples of 1e-6) and the species (multiples of 1/f)
+  std::vector<std::string> names;
+  std::vector<double> divisors;
+  names.push_back("replicate");
+  names.push_back("time");
+  names.push_back("Ca");
+  divisors.push_back(1.0);
+  divisors.push_back(1e6);
+  divisors.push_back(1e6);
+  for (int i = 0; i < ns; i++) {
+    names.push_back(info.species_names[i]);
+    divisors.push_back(cfg.f);
+  }
+  // Calcium at the output times
+  std::vector<double> output_ca(noutput);
+  for (int o = 0, k = 0; o < noutput; o++) {
+    while ((k+1 < cfg.ninput()) && (cfg.input_time_at(k+1) <= cfg.output_times[o])) k++;
+    output_ca[o] = cfg.input_ca_at(k);
+  }
+
+  // SIMULATE AND WRITE CHUNK BY CHUNK
+  columnar_writer writer(path, names, divisors, precision == "single", compression);
+  std::vector<double> out;
+  std::vector<double> chunk;
+  for (int first = 0; first < nreplicates; first += chunk_replicates) {
+    cfg.first_replicate = first;
+    cfg.nreplicates = std::min(chunk_replicates, nreplicates - first);
+    info.ensemble_simulator(cfg, out);
+    // Column-major chunk (rows: replicate-major like sim_ensemble())
+    const size_t nrow = (size_t)cfg.nreplicates * noutput;
+    chunk.resize(nrow * names.size());
+    for (int r = 0; r < cfg.nreplicates; r++) {
+      for (int o = 0; o < noutput; o++) {
+        size_t row = (size_t)r * noutput + o;
+        chunk[row] = first + r + 1;
+        chunk[nrow + row] = cfg.output_times[o];
+        chunk[2*nrow + row] = output_ca[o];
+        for (int i = 0; i < ns; i++) {
+          chunk[(3 + i)*nrow + row] = out[row*ns + i];
+        }
+      }
+    }
+    std::vector<const double *> columns(names.size());
+    for (size_t c = 0; c < names.size(); c++) columns[c] = chunk.empty() ? 0 : &chunk[c*nrow];
+    writer.write_chunk(columns, nrow);
+  }
+  writer.close();
+
+  return sim_file_open(path);
+}
@@ -0,0 +1,76 @@
+#ifndef COLUMNAR_FILE_HPP
+#define COLUMNAR_FILE_HPP
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <stdint.h>
+#include "mapped_file.hpp"
+#include "varint.hpp"
+
+
+// Chunked columnar result files (see columnar_file.cpp for the layout)
+// Every chunk stores each column in one of three encodings, chosen per chunk and column by the writer:
+enum column_encoding {
+  column_float64,   // raw doubles
+  column_float32,   // floats (lossy, precision "single")
+  column_delta      // integers n = value * divisor (exact), as zigzag varints of the differences of consecutive rows
+};
+
+// Writes a columnar file chunk by chunk (the rows of a chunk are passed column by column). The file is complete after close().
+// divisors: per column, the divisor of the delta encoding (e.g. the particle number conversion factor of concentrations, 1 for
+// integer columns; 0: never delta encoded). Columns (of a chunk) that are not exact multiples of 1/divisor are stored as doubles,
+// or as floats with single = true.
+class columnar_writer {
+public:
+  columnar_writer(const std::string &path, const std::vector<std::string> &names, const std::vector<double> &divisors,
+                  bool single, bool compress);
+  void write_chunk(const std::vector<const double *> &columns, size_t nrow);
+  void close();
+
+  uint64_t nrow;
+  uint64_t bytes;
+
+private:
+  void write(const void *p, size_t n);
+  void pad();
+  std::string path;
+  std::ofstream out;
+  std::vector<double> divisors;
+  bool single, compress;
+  std::vector<uint64_t> chunk_offsets;
+};
+
+// Memory-mapped columnar file: the chunk index is read on opening, columns are decoded on request (only the chunks of the requested rows)
+class columnar_reader {
+public:
+  explicit columnar_reader(const std::string &path);
+
+  // Decodes rows from..to-1 of column c into out
+  void read(int c, uint64_t from, uint64_t to, double *out) const;
+  // Rows from..to-1 of the chunk holding row
+  void chunk_rows(uint64_t row, uint64_t &from, uint64_t &to) const;
+  int column(const std::string &name) const;   // -1 if there is no such column
+  column_encoding encoding(int c) const;        // encoding of the column in (most of) the chunks
+
+  std::string path;
+  std::vector<std::string> names;
+  uint64_t nrow;
+  size_t nchunks() const { return chunks.size(); }
+  size_t size() const { return file.size; }
+
+private:
+  struct column_block {
+    uint32_t encoding;
+    uint64_t offset, nbytes;
+    double divisor;
+  };
+  struct chunk {
+    uint64_t first_row, nrow;
+    std::vector<column_block> columns;
+  };
+  mapped_file file;
+  std::vector<chunk> chunks;
+};
+
+#endif
@@ -0,0 +1,122 @@
+#include <string>
+#include <Rcpp.h>
+#include "compiled_model.hpp"
+#include "sim_params.hpp"
+#include "buffer_pool.hpp"
+using namespace Rcpp;
+
+
+// Replace default values by the user supplied values (matched by name; unknown names are an error)
+static void merge_values(NumericVector defaults, NumericVector user_values, const std::string &label) {
+  if (user_values.length() == 0) return;
+  if (Rf_isNull(user_values.names())) {
+    stop("The " + label + " have to be given as a named vector.");
+  }
+  CharacterVector user_names = user_values.names();
+  for (int i = 0; i < user_names.length(); i++) {
+    std::string current_name = as<std::string>(user_names[i]);
+    if (!defaults.containsElementNamed(current_name.c_str())) {
+      stop("Unknown " + label + " '" + current_name + "'.");
+    }
+    defaults[current_name] = user_values[i];
+  }
+}
+
+compiled_model &as_compiled_model(SEXP model) {
+  if ((TYPEOF(model) != EXTPTRSXP) || !Rf_inherits(model, "compiled_model")) {
+    stop("model has to be a compiled model (see compile_model()).");
+  }
+  XPtr<compiled_model> ptr(model);
+  if (ptr.get() == 0) {
+    stop("The compiled model is no longer valid (e.g. after saving and loading the R session); call compile_model() again.");
+  }
+  return *ptr;
+}
+
+
+//' Compile a Model (exported to R)
+//'
+//' Resolves and validates the parameters of a model once and returns a handle for run(). Unlike the model specific functions,
+//' unknown parameter names are an error, and no messages are printed. Repeated runs with the handle go straight to the simulation engine,
+//' which makes a large difference for many short simulations.
+//' The handle is an external pointer: it is not saved with the R session.
+//' @param model A string: the name of the model ("ano", "calcineurin", "calmodulin", "camkii", "glycphos" or "pkc").
+//' @param params A named numeric vector: reaction parameters that replace the defaults.
+//' @param vols A named numeric vector: volumes [l] that replace the defaults.
+//' @param init_conc A named numeric vector: initial concentrations [nmol/l] that replace the defaults.
+//' @return A compiled model (external pointer).
+//' @examples
+//' model <- compile_model("pkc", params = c(k1 = 2))
+//' ca <- data.frame(time = seq(0, 10, by = 0.01), Ca = 200)
+//' run(model, ca, list(endTime = 10, timestep = 0.1), seed = 1)
+//' @export
+// [[Rcpp::export]]
+SEXP compile_model(std::string model,
+                   NumericVector params = NumericVector::create(),
+                   NumericVector vols = NumericVector::create(),
+                   NumericVector init_conc = NumericVector::create()) {
+
+  const model_info &info = find_model(model);
+  List model_params_list = info.default_params();
+  merge_values(model_params_list["params"], params, "reaction parameter(s)");
+  merge_values(model_params_list["vols"], vols, "volume(s)");
+  merge_values(model_params_list["init_conc"], init_conc, "initial condition(s)");
+  compiled_model *cm = new compiled_model();
+  cm->info = &info;
+  read_model_problem(info, model_params_list, cm->problem);
+  XPtr<compiled_model> ptr(cm, true);
+  ptr.attr("class") = "compiled_model";
+  ptr.attr("model") = model;
+  return ptr;
+}
+
+//' Run a Compiled Model (exported to R)
+//'
+//' Runs the stochastic simulation (Gillespie's Direct Method) of a model compiled with compile_model().
+//' With one replicate the result has the columns of sim_<MODEL_NAME>(), with more replicates those of sim_ensemble().
+//' @param model A compiled model (see compile_model()).
+//' @param input_df A Dataframe: the input Calcium time series (with at least two columns: "time" in s and "Ca" in nmol/l).
+//' @param sim_params A List: contains values for the simulation end ("endTime") and its timesteps ("timestep") or a vector of output times ("outputTimes"),
+//'                   and optionally "baselineCa" to start from equilibrated states (see sim_equilibrate()).
+//' @param seed A whole number >= 0: the seed of the random numbers (default: drawn from R's random number generator).
+//' @param nreplicates An integer: the number of replicates.
+//' @return A dataframe with the output times, the calcium input and the concentrations of all species (and the replicate index for more than one replicate).
+//' @examples
+//' model <- compile_model("calmodulin")
+//' ca <- data.frame(time = seq(0, 10, by = 0.01), Ca = 200)
+//' run(model, ca, list(endTime = 10, timestep = 0.1))
+//' @export
+// [[Rcpp::export]]
+DataFrame run(SEXP model,
+              DataFrame input_df,
+              List sim_params = List::create(),
+              SEXP seed = R_NilValue,
+              int nreplicates = 1) {
+
+  compiled_model &cm = as_compiled_model(model);
+  const model_info &info = *cm.info;
+  uint64_t run_seed = Rf_isNull(seed) ? sim_seed(sim_params) : seed_value(seed);
+
+  if (nreplicates > 1) {
+    ensemble_config cfg;
+    static_cast<sim_problem &>(cfg) = cm.problem;
+    read_sim_input(info, input_df, sim_params, cfg);
+    cfg.nreplicates = nreplicates;
+    cfg.seed = run_seed;
+    cfg.check_interrupt = &sim_check_interrupt;
+    std::vector<double> out;
+    info.ensemble_simulator(cfg, out);
+    return ensemble_frame(info, cfg, out);
+  }
+
+  sim_problem pb = cm.problem;
+  read_sim_input(info, input_df, sim_params, pb);
+  // output buffer reused by consecutive runs (every output time is written before the run ends)
+  double *out = thread_buffers().get(buffer_output, pb.output_times.size()*info.nspecies);
+  ssa_state s = ssa_initial_state(pb, run_seed, 0);
+  while (!s.finished(pb)) {
+    checkUserInterrupt();
+    info.ssa_simulator(pb, s, HUGE_VAL, out, ssa_check_events, 0, 0);
+  }
+  return trajectory_frame(info, pb, out);
+}
@@ -0,0 +1,19 @@
+#ifndef COMPILED_MODEL_HPP
+#define COMPILED_MODEL_HPP
+
+#include <Rcpp.h>
+#include "model_registry.hpp"
+
+
+// Compiled model (R external pointer created by compile_model())
+// Holds the resolved and validated configuration of a model (parameters, initial particle numbers, volume factor),
+// so repeated runs go straight to the simulation engine without looking up and merging the parameters again.
+struct compiled_model {
+  const model_info *info;
+  sim_problem problem;   // model part of the simulation problem (input, output times and warm start are set per run)
+};
+
+// The compiled model behind an external pointer (stops with an error if it is not a valid compiled model)
+compiled_model &as_compiled_model(SEXP model);
+
+#endif
@@ -0,0 +1,111 @@
+#ifndef COUPLED_ENGINE_HPP
+#define COUPLED_ENGINE_HPP
+
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include "ssa_engine.hpp"
+
+
+// Coupled Stochastic Simulator (split coupling / random time change coupling of two parameter sets, Anderson 2012)
+// Simulates the process with the parameters of pb (state s) and the process with perturbed_params (particle numbers xp, starting
+// from the same state) in one pass with one random number stream. Every reaction j is split into a common channel with the rate
+// min(a_j, b_j), which fires in both processes, and two channels with the rates a_j - min and b_j - min, which fire in only one of
+// them. Each process on its own is an exact SSA path, but the two stay close, so the variance of their difference (finite
+// difference sensitivities) is of the order of the perturbation instead of the order of the process noise.
+// Writes the concentrations at all output times to out and out_perturbed (out[output*nspecies + species]).
+// Waiting times and input intervals are handled as in ssa_simulator (see ssa_engine.hpp).
+template <class Kernel>
+void ssa_coupled_simulator(const sim_problem &pb, const double *perturbed_params, ssa_state &s, std::vector<double> &xp,
+                           double *out, double *out_perturbed) {
+  const int ns = Kernel::nspecies;
+  const int nr = Kernel::nreactions;
+  const double *stM = Kernel::stoichiometry();
+  const int noutput = pb.output_times.size();
+  const double endTime = pb.end_time();
+  std::vector<double> params(pb.params);
+  std::vector<double> pparams(perturbed_params, perturbed_params + pb.params.size());
+  typename Kernel::factors_type factors, pfactors;
+  double rate[nr];
+  double prate[nr];
+  double cum[3*nr];
+
+  // Write the current states to all output times before 'before'
+  auto record = [&](double before) {
+    while ((s.noutput < noutput) && (pb.output_times[s.noutput] < before)) {
+      for (int i = 0; i < ns; i++) {
+        out[(size_t)s.noutput*ns + i] = s.x[i] / pb.f;
+        out_perturbed[(size_t)s.noutput*ns + i] = xp[i] / pb.f;
+      }
+      s.noutput++;
+    }
+  };
+  double Ca = pb.input_ca_at(s.ntimepoint);
+  auto prepare = [&]() {
+    pb.inputs.apply(&params[0], s.ntimepoint);
+    pb.inputs.apply(&pparams[0], s.ntimepoint);
+    Kernel::prepare(&params[0], Ca, factors);
+    Kernel::prepare(&pparams[0], Ca, pfactors);
+  };
+
+  prepare();
+  bool rates_current = false;
+
+  /* SIMULATION LOOP */
+  while (s.time < endTime) {
+    // Calculate the propensities of the common and the separate channels (only after a reaction or an input change)
+    if (!rates_current) {
+      Kernel::rates(&params[0], factors, Ca, &s.x[0], pb.f, rate);
+      Kernel::rates(&pparams[0], pfactors, Ca, &xp[0], pb.f, prate);
+      double sum = 0.0;
+      for (int j = 0; j < nr; j++) {
+        double common = std::min(rate[j], prate[j]);
+        cum[3*j] = (sum += common);
+        cum[3*j+1] = (sum += rate[j] - common);
+        cum[3*j+2] = (sum += prate[j] - common);
+      }
+      rates_current = true;
+    }
+    double total = cum[3*nr-1];
+    if (s.budget < 0) s.budget = s.rng.exponential();
+    double interval_end = pb.interval_end(s.ntimepoint);
+    double newTime = s.time + s.budget / total;
+    // No reaction in this input interval: use up the budget and move on to the next interval
+    if (!(newTime < interval_end)) {
+      s.budget -= total * (interval_end - s.time);
+      record(interval_end);
+      s.time = interval_end;
+      if (s.time < endTime) {
+        s.ntimepoint++;
+        const double next_Ca = pb.input_ca_at(s.ntimepoint);
+        if ((next_Ca != Ca) || pb.inputs.changes_at(s.ntimepoint)) {
+          Ca = next_Ca;
+          prepare();
+          rates_current = false;
+        }
+      }
+      continue;
+    }
+    // Update output (states before the reaction) and propagate time
+    record(newTime);
+    s.time = newTime;
+    s.budget = -1.0;
+    // Select channel to fire (reaction channel/3; channel%3: 0 both processes, 1 nominal only, 2 perturbed only)
+    double r2 = total * s.rng.uniform();
+    int channel = 0;
+    while ((channel < 3*nr-1) && (cum[channel] < r2)) channel++;
+    int rIndex = channel / 3;
+    int which = channel % 3;
+    // Update system states
+    for (int i = 0; i < ns; i++) {
+      if (which != 2) s.x[i] += stM[i*nr+rIndex];
+      if (which != 1) xp[i] += stM[i*nr+rIndex];
+    }
+    s.nevents++;
+    rates_current = false;
+  }
+  // Output times at the end of the simulation
+  record(HUGE_VAL);
+}
+
+#endif
@@ -0,0 +1,64 @@
+// Deterministic simulator
+// Included by model_definition.hpp, so every model file gets its own copy using the generated right hand side and Jacobian.
+
+
+//' Deterministic Simulator (native stiff ODE solver).
+//'
+//' Simulate a calcium dependent protein coupled to an input calcium time series by integrating the reaction rate equations
+//' of the model (generated from the same definition as the stochastic propensities) with a Rosenbrock method.
+//' The calcium input (and any further input signals of the model, e.g. Vm) is piecewise constant between the time points of the input data frame,
+//' or a procedural input evaluated by the engine (sim param "stimulus", see sim_stimulus()).
+//'
+//' @param user_input_df A data frame: contains the times of the observations (column "time") and the cytosolic calcium concentration [nmol/l] (column "Ca").
+//' @param user_sim_params A List: contains parameters defining the simulation output times (see simulator())
+//'                        and optionally the relative and absolute tolerances of the solver ("rtol", "atol"; default 1e-6 each).
+//' @param default_vols A numeric vector: contains updated default values of all volumes [l].
+//' @param default_init_conc A numeric vector: contains updated default values of all initial concentrations [nmol/l].
+//' @return A dataframe with time, calcium and the concentrations of all species as columns.
+DataFrame det_simulator(DataFrame user_input_df,
+                        List user_sim_params,
+                        NumericVector default_vols,
+                        NumericVector default_init_conc) {
+
+  // result of an identical earlier run from the on-disk cache (see sim_cache())
+  cache_key key;
+  bool cached = cache_enabled(user_sim_params) &&
+                result_cache_key("ode", user_input_df, user_sim_params, default_vols, default_init_conc, key);
+  DataFrame cached_result;
+  if (cached && cache_lookup(key, cached_result)) {
+    return cached_result;
+  }
+
+  /* VARIABLES */
+  // ------------ Simulation problem (input signals, output times, parameters and initial concentrations) ------------
+  sim_problem pb;
+  pb.generator = sim_stimulus_param(user_sim_params);
+  if (pb.generator.active()) {
+    // procedural calcium input (sim param "stimulus", see sim_stimulus()), evaluated by the engine
+    pb.output_times = sim_output_times(user_sim_params, pb.generator.start);
+    pb.generator.prepare(pb.end_time());
+  } else {
+    NumericVector input_ca = user_input_df["Ca"];
+    NumericVector input_time = user_input_df["time"];
+    pb.input_time.assign(input_time.begin(), input_time.end());
+    pb.input_ca.assign(input_ca.begin(), input_ca.end());
+    pb.output_times = sim_output_times(user_sim_params, input_time[0]);
+    pb.inputs = read_model_inputs(user_input_df);
+  }
+  pb.params.assign(param_array(prop_params), param_array(prop_params) + model_nparams);
+  pb.c0.assign(default_init_conc.begin(), default_init_conc.end());
+  pb.f = 6.0221415e14*default_vols[0];
+  // ------------ Solver tolerances ------------
+  double rtol = sim_param(user_sim_params, "rtol", 1e-6);
+  double atol = sim_param(user_sim_params, "atol", 1e-6);
+
+
+
+  /* SIMULATION (generic engine, see ode_engine.hpp) */
+  std::vector<double> out(pb.output_times.size()*model_nspecies);
+  ode_simulator<model_kernel>(pb, rtol, atol, out.empty() ? 0 : &out[0], &sim_check_interrupt);
+
+  DataFrame result = trajectory_frame(find_model(Str(MODEL_NAME)), pb, out);
+  if (cached) cache_store(key, result, false);
+  return result;
+}
@@ -0,0 +1,110 @@
+#ifndef DUAL_HPP
+#define DUAL_HPP
+
+#include <cmath>
+
+
+// Forward mode automatic differentiation
+// A dual number carries a value and its partial derivatives with respect to N independent variables.
+// The propensity functions of all models are templates, so instantiating them with Dual<N> instead of double
+// yields the exact Jacobian of the reaction rates without a separately written (and possibly drifting) derivative.
+template <int N>
+struct Dual {
+  double v;
+  double d[N];
+
+  Dual() : v(0.0) {
+    for (int i = 0; i < N; i++) d[i] = 0.0;
+  }
+  Dual(double value) : v(value) {
+    for (int i = 0; i < N; i++) d[i] = 0.0;
+  }
+  // Independent variable number 'index' (seed for the derivative)
+  static Dual variable(double value, int index) {
+    Dual r(value);
+    r.d[index] = 1.0;
+    return r;
+  }
+
+  Dual &operator+=(const Dual &b) {
+    v += b.v;
+    for (int i = 0; i < N; i++) d[i] += b.d[i];
+    return *this;
+  }
+  Dual &operator-=(const Dual &b) {
+    v -= b.v;
+    for (int i = 0; i < N; i++) d[i] -= b.d[i];
+    return *this;
+  }
+  Dual &operator*=(const Dual &b) {
+    for (int i = 0; i < N; i++) d[i] = d[i] * b.v + v * b.d[i];
+    v *= b.v;
+    return *this;
+  }
+  Dual &operator/=(const Dual &b) {
+    double inv = 1.0 / b.v;
+    for (int i = 0; i < N; i++) d[i] = (d[i] - v * inv * b.d[i]) * inv;
+    v *= inv;
+    return *this;
+  }
+};
+
+template <int N> inline Dual<N> operator-(const Dual<N> &a) {
+  Dual<N> r(-a.v);
+  for (int i = 0; i < N; i++) r.d[i] = -a.d[i];
+  return r;
+}
+template <int N> inline Dual<N> operator+(Dual<N> a, const Dual<N> &b) { return a += b; }
+template <int N> inline Dual<N> operator-(Dual<N> a, const Dual<N> &b) { return a -= b; }
+template <int N> inline Dual<N> operator*(Dual<N> a, const Dual<N> &b) { return a *= b; }
+template <int N> inline Dual<N> operator/(Dual<N> a, const Dual<N> &b) { return a /= b; }
+template <int N> inline Dual<N> operator+(Dual<N> a, double b) { a.v += b; return a; }
+template <int N> inline Dual<N> operator+(double a, Dual<N> b) { b.v += a; return b; }
+template <int N> inline Dual<N> operator-(Dual<N> a, double b) { a.v -= b; return a; }
+template <int N> inline Dual<N> operator-(double a, const Dual<N> &b) { return Dual<N>(a) - b; }
+template <int N> inline Dual<N> operator*(Dual<N> a, double b) {
+  a.v *= b;
+  for (int i = 0; i < N; i++) a.d[i] *= b;
+  return a;
+}
+template <int N> inline Dual<N> operator*(double a, Dual<N> b) { return b * a; }
+template <int N> inline Dual<N> operator/(Dual<N> a, double b) { return a * (1.0 / b); }
+template <int N> inline Dual<N> operator/(double a, const Dual<N> &b) { return Dual<N>(a) / b; }
+
+// Elementary functions (chain rule)
+template <int N> inline Dual<N> pow(const Dual<N> &a, double p) {
+  Dual<N> r(std::pow(a.v, p));
+  double dv = (p == 0.0) ? 0.0 : p * std::pow(a.v, p - 1.0);
+  for (int i = 0; i < N; i++) r.d[i] = dv * a.d[i];
+  return r;
+}
+// Variable exponents (parameter sensitivities, e.g. Hill coefficients); the derivative is taken as 0 at a zero base
+template <int N> inline Dual<N> pow(double a, const Dual<N> &p) {
+  Dual<N> r(std::pow(a, p.v));
+  double dp = (a > 0.0) ? r.v * std::log(a) : 0.0;
+  for (int i = 0; i < N; i++) r.d[i] = dp * p.d[i];
+  return r;
+}
+template <int N> inline Dual<N> pow(const Dual<N> &a, const Dual<N> &p) {
+  Dual<N> r(std::pow(a.v, p.v));
+  double da = (a.v != 0.0) ? p.v * r.v / a.v : 0.0;
+  double dp = (a.v > 0.0) ? r.v * std::log(a.v) : 0.0;
+  for (int i = 0; i < N; i++) r.d[i] = da * a.d[i] + dp * p.d[i];
+  return r;
+}
+template <int N> inline Dual<N> exp(const Dual<N> &a) {
+  Dual<N> r(std::exp(a.v));
+  for (int i = 0; i < N; i++) r.d[i] = r.v * a.d[i];
+  return r;
+}
+template <int N> inline Dual<N> log(const Dual<N> &a) {
+  Dual<N> r(std::log(a.v));
+  for (int i = 0; i < N; i++) r.d[i] = a.d[i] / a.v;
+  return r;
+}
+
+// Plain value of a double or a dual number
+inline double value_of(double a) { return a; }
+template <int N> inline double value_of(const Dual<N> &a) { return a.v; }
+
+#endif
@@ -0,0 +1,49 @@
+#include <string>
+#include <Rcpp.h>
+#include "model_registry.hpp"
+#include "sim_params.hpp"
+using namespace Rcpp;
+
+
+//' Ensemble Simulation (exported to R)
+//'
+//' Simulates many independent replicates of the stochastic simulation of a model (Gillespie's Direct Method, as sim_<MODEL_NAME>()).
+//' The replicates are simulated in blocks of 4 (AVX2) or 8 (AVX-512) with the species counts and propensities of a block stored side by side,
+//' so the propensities of all replicates in a block are computed with vector instructions. This is much faster than repeated calls of
+//' sim_<MODEL_NAME>() for the small models (calmodulin, calcineurin, glycphos).
+//' The results are reproducible with set.seed() (or the simulation parameter "seed") and do not depend on the vector width.
+//' @param model A string: the name of the model ("ano", "calcineurin", "calmodulin", "camkii", "glycphos" or "pkc").
+//' @param input_df A Dataframe: the input Calcium time series (with at least two columns: "time" in s and "Ca" in nmol/l).
+//' @param input_sim_params A List: contains values for the simulation end ("endTime") and its timesteps ("timestep") or a vector of output times ("outputTimes"), and optionally a "seed".
+//'                         With "baselineCa" the replicates start from equilibrated states at this calcium concentration (see sim_equilibrate()).
+//' @param input_model_params A List: the model specific parameters. Can contain up to three different vectors named "vols" (model volumes), "init_conc" (initial conditions) and "params" (reaction parameters).
+//' @param nreplicates An integer: the number of replicates.
+//' @return A dataframe with the replicate index, the output times, the calcium input and the concentrations of all species (one block of rows per replicate).
+//' @examples
+//' ca <- data.frame(time = seq(0, 10, by = 0.01), Ca = 200)
+//' sim_ensemble("calmodulin", ca, list(endTime = 10, timestep = 0.1), list(), nreplicates = 1000)
+//' @export
+// [[Rcpp::export]]
+DataFrame sim_ensemble(std::string model,
+                       DataFrame input_df,
+                       List input_sim_params,
+                       List input_model_params,
+                       int nreplicates = 100) {
+
+  // READ INPUT AND UPDATE DEFAULTS
+  const model_info &info = find_model(model);
+  if (nreplicates < 1) {
+    stop("nreplicates has to be at least 1.");
+  }
+  ensemble_config cfg;
+  static_cast<sim_problem &>(cfg) = read_sim_problem(info, input_df, input_sim_params, input_model_params);
+  cfg.nreplicates = nreplicates;
+  cfg.seed = sim_seed(input_sim_params);
+  cfg.check_interrupt = &sim_check_interrupt;
+
+  // RUN SIMULATION
+  std::vector<double> out;
+  info.ensemble_simulator(cfg, out);
+
+  return ensemble_frame(info, cfg, out);
+}
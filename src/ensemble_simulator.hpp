@@ -0,0 +1,164 @@
+#ifndef ENSEMBLE_SIMULATOR_HPP
+#define ENSEMBLE_SIMULATOR_HPP
+
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <stdint.h>
+#include "simd.hpp"
+#include "rng.hpp"
+#include "sim_problem.hpp"
+
+
+// Ensemble simulation: the simulation problem and the number of replicates
+struct ensemble_config : sim_problem {
+  int nreplicates;
+  int first_replicate;              // index of the first replicate (random number stream), for ensembles simulated in parts
+  uint64_t seed;
+  void (*check_interrupt)();        // called once per block of replicates (may be null)
+
+  ensemble_config() : nreplicates(0), first_replicate(0), seed(0), check_interrupt(0) {}
+};
+
+
+// Ensemble Simulator (Gillespie's Direct Method for many independent replicates)
+// Kernel is the compile time model description generated by model_definition.hpp
+// (nspecies, nreactions, factors_type, prepare(params, Ca, factors), rates<Real>(params, factors, Ca, x, f, rate) and stoichiometry()).
+// Replicates are simulated in blocks of SIMD_LANES. Species counts and propensities of a block are stored as
+// structure of arrays (one Lanes vector per species/reaction), so the propensities of all lanes are computed at once.
+// All lanes of a block advance through the calcium input in lock-step: within an input interval every lane fires reactions
+// until its next event would leave the interval, then the lane is masked until all lanes of the block have reached the interval end.
+// The waiting time of a lane is drawn as integrated total propensity (unit exponential) and carried over to the following
+// input intervals until it is used up (exact for piecewise constant input), so passing an interval needs no random number, and
+// the propensities are only recalculated after a reaction or when the input changes.
+// Every replicate has its own random number stream (seed, first_replicate + replicate index), so the results do not depend on the lane
+// width, and an ensemble simulated in parts gives the same replicates as in one run.
+// out: concentrations at the output times, out[(replicate*noutput + output)*nspecies + species]
+template <class Kernel>
+void ensemble_simulator(const ensemble_config &cfg, std::vector<double> &out) {
+  const int ns = Kernel::nspecies;
+  const int nr = Kernel::nreactions;
+  const int W = SIMD_LANES;
+  const double *stM = Kernel::stoichiometry();
+  std::vector<double> params(cfg.params);
+  const int ninput = cfg.ninput();
+  const int noutput = cfg.output_times.size();
+  const double endTime = cfg.end_time();
+  out.assign((size_t)cfg.nreplicates * noutput * ns, 0.0);
+
+  // Sparse stoichiometry: species changed by reaction j are change_species[change_start[j] .. change_start[j+1]-1]
+  std::vector<int> change_start(nr+1, 0);
+  std::vector<int> change_species;
+  std::vector<double> change_value;
+  for (int j = 0; j < nr; j++) {
+    change_start[j] = change_species.size();
+    for (int i = 0; i < ns; i++) {
+      if (stM[i*nr+j] != 0.0) {
+        change_species.push_back(i);
+        change_value.push_back(stM[i*nr+j]);
+      }
+    }
+  }
+  change_start[nr] = change_species.size();
+
+  // State of one block of replicates (structure of arrays)
+  Lanes x[ns];
+  Lanes rate[nr];
+  Lanes cum[nr];
+  typename Kernel::factors_type factors;
+  Rng rng[W];
+  double lane_time[W];
+  double budget[W];   // integrated total propensity left until the next reaction (< 0: draw a new one)
+  int next_output[W];
+  bool active[W];
+
+  // Write the current state of lane l to all output times before 'until'
+  auto record = [&](int replicate, int l, double until) {
+    while ((next_output[l] < noutput) && (cfg.output_times[next_output[l]] < until)) {
+      double *row = &out[((size_t)replicate * noutput + next_output[l]) * ns];
+      for (int i = 0; i < ns; i++) {
+        row[i] = x[i][l] / cfg.f;
+      }
+      next_output[l]++;
+    }
+  };
+
+  for (int first = 0; first < cfg.nreplicates; first += W) {
+    if (cfg.check_interrupt) cfg.check_interrupt();
+    const int nlanes = std::min(W, cfg.nreplicates - first);
+    for (int l = 0; l < W; l++) {
+      rng[l].seed(cfg.seed, cfg.first_replicate + first + l);
+      const double *x0 = cfg.initial_state(rng[l]);
+      for (int i = 0; i < ns; i++) {
+        x[i].set(l, x0[i]);
+      }
+      next_output[l] = 0;
+      budget[l] = -1.0;
+    }
+
+    /* SIMULATION LOOP (lock-step over the input intervals) */
+    bool rates_current = false;
+    double previous_Ca = 0.0;
+    for (int k = 0; (k < ninput) && (cfg.input_time_at(k) < endTime); k++) {
+      const double Ca = cfg.input_ca_at(k);
+      if ((k == 0) || (Ca != previous_Ca) || cfg.inputs.changes_at(k)) {
+        cfg.inputs.apply(&params[0], k);
+        Kernel::prepare(&params[0], Ca, factors);
+        rates_current = false;
+      }
+      previous_Ca = Ca;
+      const double interval_end = cfg.interval_end(k);
+      int nactive = nlanes;
+      for (int l = 0; l < W; l++) {
+        lane_time[l] = cfg.input_time_at(k);
+        active[l] = (l < nlanes);
+      }
+      while (nactive > 0) {
+        // Propensities of all lanes at once (masked lanes are computed too, but ignored)
+        if (!rates_current) {
+          Kernel::rates(&params[0], factors, Ca, x, cfg.f, rate);
+          cum[0] = rate[0];
+          for (int j = 1; j < nr; j++) {
+            cum[j] = cum[j-1] + rate[j];
+          }
+          rates_current = true;
+        }
+        for (int l = 0; l < nlanes; l++) {
+          if (!active[l]) continue;
+          const int replicate = first + l;
+          // Calculate time step tau (no reaction left if the total propensity is zero)
+          double total = cum[nr-1][l];
+          if (budget[l] < 0) budget[l] = rng[l].exponential();
+          double newTime = lane_time[l] + budget[l] / total;
+          // Lane reached the end of the input interval: keep the rest of the budget and mask it until the block moves on
+          if (!(newTime < interval_end)) {
+            budget[l] -= total * (interval_end - lane_time[l]);
+            record(replicate, l, interval_end);
+            active[l] = false;
+            nactive--;
+            continue;
+          }
+          // Update output (state before the reaction) and propagate time
+          record(replicate, l, newTime);
+          lane_time[l] = newTime;
+          budget[l] = -1.0;
+          rates_current = false;
+          // Select reaction to fire
+          double r2 = total * rng[l].uniform();
+          int rIndex = 0;
+          while ((rIndex < nr-1) && (cum[rIndex][l] < r2)) rIndex++;
+          // Update species of this lane
+          for (int c = change_start[rIndex]; c < change_start[rIndex+1]; c++) {
+            x[change_species[c]].set(l, x[change_species[c]][l] + change_value[c]);
+          }
+        }
+      }
+    }
+    // Output times at the end of the simulation
+    for (int l = 0; l < nlanes; l++) {
+      record(first + l, l, HUGE_VAL);
+    }
+  }
+}
+
+#endif
@@ -0,0 +1,51 @@
+#include <string>
+#include <Rcpp.h>
+#include "evaluation.hpp"
+#include "sim_params.hpp"
+using namespace Rcpp;
+
+
+readout read_readout(const model_info &info, const std::string &species, const std::string &statistic) {
+  readout ro;
+  ro.species = -1;
+  for (int i = 0; i < info.nspecies; i++) {
+    if (info.species_names[i] == species) ro.species = i;
+  }
+  if (ro.species < 0) {
+    stop("Unknown species '" + species + "'.");
+  }
+  if (statistic == "mean") {
+    ro.statistic = readout_mean;
+  } else if (statistic == "max") {
+    ro.statistic = readout_max;
+  } else if (statistic == "final") {
+    ro.statistic = readout_final;
+  } else {
+    stop("statistic has to be \"mean\", \"max\" or \"final\".");
+  }
+  return ro;
+}
+
+model_evaluator read_model_evaluator(const std::string &model, DataFrame input_df, List input_sim_params,
+                                     List input_model_params, CharacterVector params, const std::string &species,
+                                     const std::string &statistic, const std::string &method, int nreplicates) {
+  model_evaluator ev;
+  ev.info = &find_model(model);
+  ev.problem = read_sim_problem(*ev.info, input_df, input_sim_params, input_model_params);
+  // Varied parameters
+  for (int k = 0; k < params.length(); k++) {
+    ev.param_index.push_back(find_param(*ev.info, as<std::string>(params[k])));
+  }
+  // Readout
+  ev.ro = read_readout(*ev.info, species, statistic);
+  // Simulation method
+  if ((method != "ode") && (method != "ssa")) {
+    stop("method has to be \"ode\" or \"ssa\".");
+  }
+  ev.stochastic = (method == "ssa");
+  ev.nreplicates = std::max(1, nreplicates);
+  ev.seed = sim_seed(input_sim_params);
+  ev.rtol = sim_param(input_sim_params, "rtol", 1e-6);
+  ev.atol = sim_param(input_sim_params, "atol", 1e-6);
+  return ev;
+}
@@ -0,0 +1,80 @@
+#ifndef EVALUATION_HPP
+#define EVALUATION_HPP
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include "model_registry.hpp"
+#include "buffer_pool.hpp"
+
+
+// Scalar readout of a simulation (e.g. the time average of a species), used by the analysis drivers
+enum readout_statistic { readout_mean, readout_max, readout_final };
+
+struct readout {
+  int species;
+  readout_statistic statistic;
+
+  // Readout of the concentrations out[output*nspecies + species]
+  double value(const double *out, int noutput, int nspecies) const {
+    if (noutput == 0) return 0.0;
+    if (statistic == readout_final) return out[(size_t)(noutput-1)*nspecies + species];
+    double result = (statistic == readout_max) ? out[species] : 0.0;
+    for (int o = 0; o < noutput; o++) {
+      double c = out[(size_t)o*nspecies + species];
+      if (statistic == readout_max) {
+        if (c > result) result = c;
+      } else {
+        result += c;
+      }
+    }
+    return (statistic == readout_mean) ? result / noutput : result;
+  }
+};
+
+// Readout from the arguments of the R functions: species name and statistic ("mean", "max" or "final")
+readout read_readout(const model_info &info, const std::string &species, const std::string &statistic);
+
+// Evaluation of a readout for given values of some parameters (deterministic, or averaged over stochastic replicates)
+// Input, output times and the other parameters are shared by all evaluations. Every thread of the analysis drivers works on
+// its own copy of the problem (only the varied parameters are overwritten per evaluation) and its own output buffer.
+struct model_evaluator {
+  const model_info *info;
+  sim_problem problem;
+  std::vector<int> param_index;   // parameters set per evaluation (position in the parameter array)
+  readout ro;
+  bool stochastic;
+  int nreplicates;                // stochastic: replicates per evaluation
+  uint64_t seed;
+  double rtol, atol;              // deterministic: solver tolerances
+
+  // Readout for the parameter values (param_index order) on the thread's problem copy pb
+  // Replicate r of evaluation 'stream' uses the random number stream stream*nreplicates + r.
+  double operator()(sim_problem &pb, const double *values, uint64_t stream) const {
+    const int ns = info->nspecies;
+    const int noutput = pb.output_times.size();
+    for (size_t k = 0; k < param_index.size(); k++) {
+      pb.params[param_index[k]] = values[k];
+    }
+    double *out = thread_buffers().get(buffer_output, (size_t)noutput*ns);
+    if (!stochastic) {
+      info->ode_simulator(pb, rtol, atol, out, 0);
+      return ro.value(out, noutput, ns);
+    }
+    double sum = 0.0;
+    for (int r = 0; r < nreplicates; r++) {
+      ssa_state s = ssa_initial_state(pb, seed, stream*nreplicates + r);
+      info->ssa_simulator(pb, s, HUGE_VAL, out, UINT64_MAX, 0, 0);
+      sum += ro.value(out, noutput, ns);
+    }
+    return sum / nreplicates;
+  }
+};
+
+// Evaluator from the arguments of the R functions (on the R thread): species and statistic of the readout, names of the varied
+// parameters, method ("ode" or "ssa") and the sim parameters "rtol", "atol" and "seed"
+model_evaluator read_model_evaluator(const std::string &model, Rcpp::DataFrame input_df, Rcpp::List input_sim_params,
+                                     Rcpp::List input_model_params, Rcpp::CharacterVector params, const std::string &species,
+                                     const std::string &statistic, const std::string &method, int nreplicates);
+
+#endif
@@ -0,0 +1,46 @@
+#ifndef EVENT_LOG_HPP
+#define EVENT_LOG_HPP
+
+#include <string>
+#include <cmath>
+#include <stdint.h>
+#include "varint.hpp"
+
+
+// Compressed jump trajectory of a stochastic simulation run (see events.cpp)
+// Every reaction is one varint: the time since the previous reaction in multiples of 'resolution' [s], times the number of
+// reactions, plus the index of the reaction. The event times are rounded to the resolution (absolute, so the rounding errors do
+// not add up); the reaction sequence is exact, so the state is exact at every point that is not within resolution/2 of an event.
+// With the waiting times of a model well above the resolution, an event takes 1-3 bytes (2 for the small models at 1e-6 s).
+struct event_log {
+  double start;        // start time of the run [s]
+  double resolution;   // [s]
+  int nreactions;
+  std::string bytes;
+  uint64_t nevents;
+  int64_t last;        // rounded time of the last event [resolution]
+
+  event_log(double start, double resolution, int nreactions)
+    : start(start), resolution(resolution), nreactions(nreactions), nevents(0), last(0) {}
+
+  void add(double time, int reaction) {
+    int64_t t = (int64_t)std::floor((time - start) / resolution + 0.5);
+    put_uvarint(bytes, (uint64_t)(t - last) * nreactions + reaction);
+    last = t;
+    nevents++;
+  }
+};
+
+// Replays a log: calls f(time, reaction) for every event in order; returns false if the log is truncated
+template <class F>
+bool replay_events(const unsigned char *p, const unsigned char *end, double start, double resolution, int nreactions, F f) {
+  uint64_t t = 0, value;
+  while (p < end) {
+    if (!get_uvarint(p, end, value)) return false;
+    t += value / nreactions;
+    f(start + t * resolution, (int)(value % nreactions));
+  }
+  return true;
+}
+
+#endif
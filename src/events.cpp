@@ -0,0 +1,320 @@
+#include <string>
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <Rcpp.h>
+#include "model_registry.hpp"
+#include "buffer_pool.hpp"
+#include "parallel.hpp"
+#include "sim_params.hpp"
+#include "event_log.hpp"
+#include "result_columns.hpp"
+using namespace Rcpp;
+
+
+// Recorded jump trajectories (list of class "sim_events", see sim_events()) prepared for the reconstruction on native threads
+struct recorded_events {
+  const model_info *info;
+  double f, start, end, resolution;
+  std::vector<double> input_time, input_ca;
+  std::vector<double> initial;                    // initial particle numbers, initial[replicate*nspecies + species]
+  std::vector<const unsigned char *> log_begin, log_end;   // encoded events of each replicate
+  int nreplicates;
+
+  // Calcium input at time t (piecewise constant)
+  double ca(double t) const {
+    size_t k = std::upper_bound(input_time.begin(), input_time.end(), t) - input_time.begin();
+    return input_ca[(k > 0) ? k - 1 : 0];
+  }
+  // Replays the events of replicate r on the state x (initialised to the initial state)
+  template <class F>
+  bool replay(int r, std::vector<double> &x, F f) const {
+    const int ns = info->nspecies, nr = info->nreactions;
+    const double *stM = info->stoichiometry;
+    x.assign(initial.begin() + (size_t)r*ns, initial.begin() + (size_t)(r+1)*ns);
+    return replay_events(log_begin[r], log_end[r], start, resolution, nr, [&](double t, int j) {
+      f(t);
+      for (int i = 0; i < ns; i++) {
+        x[i] += stM[i*nr+j];
+      }
+    });
+  }
+};
+
+static recorded_events read_events(List events) {
+  if (!Rf_inherits(events, "sim_events")) {
+    stop("events has to be a recording of sim_events().");
+  }
+  recorded_events rec;
+  rec.info = &find_model(as<std::string>(events["model"]));
+  rec.f = events["f"];
+  rec.start = events["start"];
+  rec.end = events["end"];
+  rec.resolution = events["resolution"];
+  DataFrame input = events["input"];
+  NumericVector input_time = input["time"], input_ca = input["Ca"];
+  rec.input_time.assign(input_time.begin(), input_time.end());
+  rec.input_ca.assign(input_ca.begin(), input_ca.end());
+  NumericMatrix initial = as<NumericMatrix>(events["initial"]);
+  List logs = events["events"];
+  rec.nreplicates = logs.length();
+  if ((as<int>(events["nreactions"]) != rec.info->nreactions) || (initial.ncol() != rec.info->nspecies) ||
+      (initial.nrow() != rec.nreplicates) || rec.input_time.empty()) {
+    stop("The recording does not match the model '" + rec.info->name + "'.");
+  }
+  rec.initial.resize((size_t)rec.nreplicates * rec.info->nspecies);
+  for (int r = 0; r < rec.nreplicates; r++) {
+    RawVector log = logs[r];
+    rec.log_begin.push_back(log.begin());
+    rec.log_end.push_back(log.end());
+    for (int i = 0; i < rec.info->nspecies; i++) {
+      rec.initial[(size_t)r*rec.info->nspecies + i] = initial(r, i);
+    }
+  }
+  return rec;
+}
+
+// Species indices of a selection (all species if empty)
+static std::vector<int> selected_species(const model_info &info, CharacterVector species) {
+  std::vector<int> selected;
+  for (int i = 0; i < info.nspecies; i++) {
+    if (species.length() == 0) selected.push_back(i);
+  }
+  for (int k = 0; k < species.length(); k++) {
+    std::string name = as<std::string>(species[k]);
+    int i = std::find(info.species_names.begin(), info.species_names.end(), name) - info.species_names.begin();
+    if (i == info.nspecies) {
+      stop("The model '" + info.name + "' has no species '" + name + "'.");
+    }
+    selected.push_back(i);
+  }
+  return selected;
+}
+
+
+//' Record Exact Jump Trajectories (exported to R)
+//'
+//' Simulates replicates of the stochastic simulation of a model (Gillespie's Direct Method) and records every reaction instead of the
+//' state at output times: the exact jump trajectory, from which any output grid (sim_events_sample()) or time average
+//' (sim_events_average()) can be reconstructed later without simulating again, including transitions faster than any output grid.
+//' A reaction is stored as one variable length integer combining the time since the previous reaction (in multiples of the resolution)
+//' and the index of the reaction, typically 1-3 bytes; a dense output grid takes 8 bytes per species and output time. The
+//' recording is an ordinary R list, so it can be saved and loaded.
+//' @param model A string: the name of the model ("ano", "calcineurin", "calmodulin", "camkii", "glycphos" or "pkc").
+//' @param input_df A Dataframe: the input Calcium time series (with at least two columns: "time" in s and "Ca" in nmol/l).
+//' @param input_sim_params A List: contains the simulation end ("endTime", or the last of the "outputTimes") and optionally a "seed".
+//'                         With "baselineCa" the replicates start from equilibrated states at this calcium concentration (see sim_equilibrate()).
+//' @param input_model_params A List: the model specific parameters. Can contain up to three different vectors named "vols" (model volumes), "init_conc" (initial conditions) and "params" (reaction parameters).
+//' @param nreplicates An integer: the number of replicates.
+//' @param resolution A number: the resolution of the recorded event times [s] (the reactions and their order are exact).
+//' @param nthreads An integer: the number of threads (default: all hardware threads).
+//' @return A list of class "sim_events" with the model, its species, the simulated time span ("start", "end"), the calcium input ("input"),
+//'         the initial particle numbers of the replicates ("initial"), the encoded events per replicate ("events", raw vectors) and
+//'         the number of events per replicate ("nevents").
+//' @examples
+//' ca <- data.frame(time = seq(0, 10, by = 0.01), Ca = rep(c(100, 1000), each = 501))
+//' rec <- sim_events("calmodulin", ca, list(endTime = 10), list(), nreplicates = 10)
+//' sum(rec$nevents)
+//' object.size(rec$events)
+//' @export
+// [[Rcpp::export]]
+List sim_events(std::string model,
+                DataFrame input_df,
+                List input_sim_params,
+                List input_model_params,
+                int nreplicates = 1,
+                double resolution = 1e-6,
+                int nthreads = 0) {
+
+  // READ INPUT AND UPDATE DEFAULTS
+  const model_info &info = find_model(model);
+  const int ns = info.nspecies;
+  sim_problem pb = read_sim_problem(info, input_df, input_sim_params, input_model_params);
+  const uint64_t seed = sim_seed(input_sim_params);
+  if (!(resolution > 0) || (nreplicates < 0)) {
+    stop("resolution has to be positive and nreplicates non-negative.");
+  }
+  // Only the end of the simulation is an output time (the trajectory is in the events)
+  const double start = pb.input_time_at(0), end = pb.end_time();
+  pb.output_times.assign(1, end);
+
+  // RUN SIMULATIONS (replicate r on random number stream r)
+  std::vector<std::string> logs(nreplicates);
+  std::vector<double> nevents(nreplicates);
+  NumericMatrix initial(nreplicates, ns);
+  double *initial_values = initial.begin();
+  nthreads = worker_threads(nthreads);
+  parallel_for(nreplicates, nthreads, [&](int r, int thread) {
+    ssa_state s = ssa_initial_state(pb, seed, r);
+    for (int i = 0; i < ns; i++) {
+      initial_values[(size_t)i*nreplicates + r] = s.x[i];
+    }
+    event_log log(start, resolution, info.nreactions);
+    double *out = thread_buffers().get(buffer_output, ns);
+    info.ssa_simulator(pb, s, HUGE_VAL, out, UINT64_MAX, 0, &log);
+    logs[r].swap(log.bytes);
+    nevents[r] = log.nevents;
+  }, &sim_check_interrupt);
+  sim_check_interrupt();
+
+  List events(nreplicates);
+  for (int r = 0; r < nreplicates; r++) {
+    RawVector bytes(logs[r].size());
+    std::copy(logs[r].begin(), logs[r].end(), bytes.begin());
+    events[r] = bytes;
+    std::string().swap(logs[r]);
+  }
+  CharacterVector species(ns);
+  for (int i = 0; i < ns; i++) {
+    species[i] = info.species_names[i];
+  }
+  colnames(initial) = species;
+  // calcium input of the recording (also of a procedural input, see sim_stimulus())
+  const int ninput = pb.ninput();
+  NumericVector input_time(ninput), input_ca(ninput);
+  for (int k = 0; k < ninput; k++) {
+    input_time[k] = pb.input_time_at(k);
+    input_ca[k] = pb.input_ca_at(k);
+  }
+  DataFrame input = DataFrame::create(_["time"] = input_time, _["Ca"] = input_ca);
+  List result = List::create(_["model"] = model, _["species"] = species, _["f"] = pb.f, _["start"] = start, _["end"] = end,
+                             _["resolution"] = resolution, _["nreactions"] = info.nreactions, _["input"] = input,
+                             _["initial"] = initial, _["events"] = events, _["nevents"] = NumericVector(nevents.begin(), nevents.end()));
+  result.attr("class") = "sim_events";
+  return result;
+}
+
+//' Sample Recorded Trajectories (exported to R)
+//'
+//' Reconstructs the concentrations of recorded replicates (see sim_events()) at any output times, without simulating again. The value
+//' at an output time includes all reactions up to and including this time (right-continuous, like the output of sim_ensemble()); event
+//' times are those of the recording, rounded to its resolution.
+//' @param events A recording of sim_events().
+//' @param times A numeric vector: the output times [s] (increasing; times outside the simulated time span give NA).
+//' @param species A character vector: the species (default: all species of the model).
+//' @param nthreads An integer: the number of threads (default: all hardware threads).
+//' @return A dataframe with the replicate index, the output times, the calcium input and the concentrations of the species (one block of rows per replicate).
+//' @examples
+//' ca <- data.frame(time = seq(0, 10, by = 0.01), Ca = rep(c(100, 1000), each = 501))
+//' rec <- sim_events("calmodulin", ca, list(endTime = 10), list(), nreplicates = 10)
+//' fine <- sim_events_sample(rec, seq(4.9, 5.2, by = 0.001), species = "Prot_act")
+//' @export
+// [[Rcpp::export]]
+DataFrame sim_events_sample(List events, NumericVector times, CharacterVector species = CharacterVector::create(), int nthreads = 0) {
+  const recorded_events rec = read_events(events);
+  const std::vector<int> selected = selected_species(*rec.info, species);
+  const int ntimes = times.length();
+  for (int k = 1; k < ntimes; k++) {
+    if (!(times[k] >= times[k-1])) stop("times have to be increasing.");
+  }
+  const R_xlen_t nrow = (R_xlen_t)rec.nreplicates * ntimes;
+  const size_t ncol = selected.size() + 3;
+  std::vector<NumericVector> columns(ncol, NumericVector());
+  std::vector<double *> column_values(ncol);
+  for (size_t c = 0; c < ncol; c++) {
+    columns[c] = NumericVector(nrow);
+    column_values[c] = columns[c].begin();
+  }
+  const double *t = times.begin();
+
+  // RECONSTRUCT (right-continuous like the engine, see ssa_simulator(): write(until) is called before the event at 'until' is applied
+  // and writes the output times t < until with the state before the event; an output time equal to the event time is written
+  // after it, with the state after the event)
+  std::vector<char> damaged(rec.nreplicates, 0);
+  parallel_for(rec.nreplicates, worker_threads(nthreads), [&](int r, int thread) {
+    std::vector<double> x;
+    int k = 0;
+    auto write = [&](double until) {
+      for (; (k < ntimes) && (t[k] < until); k++) {
+        const size_t row = (size_t)r*ntimes + k;
+        const bool inside = (t[k] >= rec.start) && (t[k] <= rec.end);
+        column_values[0][row] = r + 1;
+        column_values[1][row] = t[k];
+        column_values[2][row] = inside ? rec.ca(t[k]) : NA_REAL;
+        for (size_t c = 0; c < selected.size(); c++) {
+          column_values[c+3][row] = inside ? x[selected[c]] / rec.f : NA_REAL;
+        }
+      }
+    };
+    damaged[r] = !rec.replay(r, x, write);
+    write(HUGE_VAL);
+  }, &sim_check_interrupt);
+  if (std::find(damaged.begin(), damaged.end(), 1) != damaged.end()) {
+    stop("The recording is damaged (truncated events).");
+  }
+
+  List result(ncol);
+  CharacterVector names(ncol);
+  names[0] = "replicate";
+  names[1] = "time";
+  names[2] = "Ca";
+  for (size_t c = 0; c < ncol; c++) {
+    result[c] = columns[c];
+    if (c >= 3) names[c] = rec.info->species_names[selected[c-3]];
+  }
+  return result_frame(result, names, nrow);
+}
+
+//' Time Averages of Recorded Trajectories (exported to R)
+//'
+//' Computes the exact time averages of the concentrations of recorded replicates (see sim_events()) over a time window from the jump
+//' trajectories, without simulating again and without output grid.
+//' @param events A recording of sim_events().
+//' @param from A number: the start of the window [s] (default: the start of the simulation).
+//' @param to A number: the end of the window [s] (default: the end of the simulation).
+//' @param species A character vector: the species (default: all species of the model).
+//' @param nthreads An integer: the number of threads (default: all hardware threads).
+//' @return A dataframe with the replicate index and the time averaged concentrations of the species.
+//' @examples
+//' ca <- data.frame(time = seq(0, 10, by = 0.01), Ca = rep(c(100, 1000), each = 501))
+//' rec <- sim_events("calmodulin", ca, list(endTime = 10), list(), nreplicates = 10)
+//' sim_events_average(rec, from = 5, to = 10)
+//' @export
+// [[Rcpp::export]]
+DataFrame sim_events_average(List events, double from = NA_REAL, double to = NA_REAL,
+                             CharacterVector species = CharacterVector::create(), int nthreads = 0) {
+  const recorded_events rec = read_events(events);
+  const std::vector<int> selected = selected_species(*rec.info, species);
+  if (ISNAN(from)) from = rec.start;
+  if (ISNAN(to)) to = rec.end;
+  if (!(from >= rec.start) || !(to <= rec.end) || !(to > from)) {
+    stop("The window has to be within the simulated time span (from < to).");
+  }
+  const size_t ns = selected.size();
+  std::vector<double> averages(rec.nreplicates * ns);
+  std::vector<char> damaged(rec.nreplicates, 0);
+
+  // INTEGRATE the piecewise constant trajectories over the window
+  parallel_for(rec.nreplicates, worker_threads(nthreads), [&](int r, int thread) {
+    std::vector<double> x;
+    double *sum = &averages[r * ns];
+    double previous = rec.start;
+    auto advance = [&](double t) {
+      double a = std::max(previous, from), b = std::min(t, to);
+      if (b > a) {
+        for (size_t c = 0; c < ns; c++) sum[c] += x[selected[c]] * (b - a);
+      }
+      previous = t;
+    };
+    damaged[r] = !rec.replay(r, x, advance);
+    advance(rec.end);
+    for (size_t c = 0; c < ns; c++) sum[c] /= (to - from) * rec.f;
+  }, &sim_check_interrupt);
+  if (std::find(damaged.begin(), damaged.end(), 1) != damaged.end()) {
+    stop("The recording is damaged (truncated events).");
+  }
+
+  List result(ns + 1);
+  CharacterVector names(ns + 1);
+  IntegerVector replicate(rec.nreplicates);
+  for (int r = 0; r < rec.nreplicates; r++) replicate[r] = r + 1;
+  result[0] = replicate;
+  names[0] = "replicate";
+  for (size_t c = 0; c < ns; c++) {
+    NumericVector column(rec.nreplicates);
+    for (int r = 0; r < rec.nreplicates; r++) column[r] = averages[r * ns + c];
+    result[c+1] = column;
+    names[c+1] = rec.info->species_names[selected[c]];
+  }
+  return result_frame(result, names, rec.nreplicates);
+}
@@ -0,0 +1,103 @@
+#include <string>
+#include <vector>
+#include <cmath>
+#include <Rcpp.h>
+#include "model_registry.hpp"
+#include "buffer_pool.hpp"
+#include "parallel.hpp"
+#include "sim_params.hpp"
+using namespace Rcpp;
+
+
+//' First Passage Times of the Stochastic Models (exported to R)
+//'
+//' Simulates replicates of the stochastic model (Gillespie's Direct Method) until a stopping condition on the species is met, e.g.
+//' "active CaMKII exceeds X" or "the sum of two species falls below Y". The conditions are checked after every reaction, so each
+//' replicate stops at the exact reaction that crosses the threshold and reports this hitting time and the state at that moment;
+//' replicates that never cross run until the end of the simulation. No trajectory grid is recorded, and replicates that cross early
+//' stop early, so the run time shrinks with the hitting times. Replicates are simulated in parallel on native threads, and the
+//' results do not depend on the number of threads.
+//' @param model A string: the name of the model ("ano", "calcineurin", "calmodulin", "camkii", "glycphos" or "pkc").
+//' @param input_df A Dataframe: the input Calcium time series (with at least two columns: "time" in s and "Ca" in nmol/l).
+//' @param input_sim_params A List: contains the simulation end ("endTime", or the last of the "outputTimes"), and optionally a "seed".
+//'                         With "baselineCa" the replicates start from equilibrated states at this calcium concentration (see sim_equilibrate()).
+//' @param input_model_params A List: the model specific parameters. Can contain up to three different vectors named "vols" (model volumes), "init_conc" (initial conditions) and "params" (reaction parameters).
+//' @param conditions A List: one stopping condition or a list of conditions, each a list with "species" (a species name, several species names
+//'                   (their sum) or a named vector of weights (a linear combination)), "threshold" [nmol/l] and "direction" ("above", default, or "below").
+//' @param nreplicates An integer: the number of replicates.
+//' @param nthreads An integer: the number of threads (default: all hardware threads).
+//' @return A dataframe with one row per replicate: the replicate index, the index of the condition that was met first ("condition", NA if none),
+//'         the hitting time ("time", NA if no condition was met), and the calcium input and the concentrations of all species at the hitting time
+//'         (at the end of the simulation if no condition was met). A condition that holds initially is met at the start time.
+//' @examples
+//' ca <- data.frame(time = seq(0, 50, by = 0.01), Ca = 500)
+//' hits <- first_passage("calmodulin", ca, list(endTime = 50), list(),
+//'                       list(species = "Prot_act", threshold = 100), nreplicates = 1000)
+//' mean(hits$time, na.rm = TRUE)
+//' @export
+// [[Rcpp::export]]
+DataFrame first_passage(std::string model,
+                        DataFrame input_df,
+                        List input_sim_params,
+                        List input_model_params,
+                        List conditions,
+                        int nreplicates = 100,
+                        int nthreads = 0) {
+
+  // READ INPUT AND UPDATE DEFAULTS
+  const model_info &info = find_model(model);
+  const int ns = info.nspecies;
+  sim_problem pb = read_sim_problem(info, input_df, input_sim_params, input_model_params);
+  const stop_conditions stopping = read_stop_conditions(info, pb, conditions);
+  const uint64_t seed = sim_seed(input_sim_params);
+  // Only the end of the simulation is recorded (state of the replicates that never cross)
+  pb.output_times.assign(1, pb.end_time());
+
+  // RUN SIMULATIONS (replicate r on random number stream r)
+  std::vector<double> hit_time(nreplicates, NA_REAL), state((size_t)nreplicates*ns);
+  std::vector<int> hit(nreplicates, -1);
+  nthreads = worker_threads(nthreads);
+  parallel_for(nreplicates, nthreads, [&](int r, int thread) {
+    ssa_state s = ssa_initial_state(pb, seed, r);
+    double *out = thread_buffers().get(buffer_output, ns);
+    const stop_conditions &stop = stopping;
+    hit[r] = stop.met(&s.x[0]);
+    if (hit[r] < 0) {
+      info.ssa_simulator(pb, s, HUGE_VAL, out, UINT64_MAX, &stop, 0);
+      hit[r] = stop.met(&s.x[0]);
+    }
+    if (hit[r] >= 0) hit_time[r] = s.time;
+    for (int i = 0; i < ns; i++) {
+      state[(size_t)r*ns + i] = s.x[i] / pb.f;
+    }
+  }, &sim_check_interrupt);
+
+  // one row per replicate; cols. = replicate + condition + time + ca + species
+  NumericMatrix retval(nreplicates, ns+4);
+  CharacterVector col_names(ns+4);
+  col_names[0] = "replicate";
+  col_names[1] = "condition";
+  col_names[2] = "time";
+  col_names[3] = "Ca";
+  for (int i = 0; i < ns; i++) {
+    col_names[i+4] = info.species_names[i];
+  }
+  colnames(retval) = col_names;
+  for (int r = 0; r < nreplicates; r++) {
+    // calcium input interval of the hitting time (or the end)
+    double t = (hit[r] >= 0) ? hit_time[r] : pb.end_time();
+    int k = pb.input_interval(t);
+    retval(r, 0) = r+1;
+    retval(r, 1) = (hit[r] >= 0) ? hit[r]+1 : NA_REAL;
+    retval(r, 2) = hit_time[r];
+    retval(r, 3) = pb.input_ca_at(k);
+    for (int i = 0; i < ns; i++) {
+      retval(r, i+4) = state[(size_t)r*ns + i];
+    }
+  }
+
+  // Convert NumericMatrix retval to DataFrame
+  DataFrame df_retval(retval);
+
+  return df_retval;
+}
@@ -0,0 +1,258 @@
+#include <string>
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
+#include <Rcpp.h>
+#include "model_registry.hpp"
+#include "sim_params.hpp"
+using namespace Rcpp;
+
+
+// Solves the symmetric system A z = b of size n (Gaussian elimination with partial pivoting, A and b are overwritten)
+static bool solve_system(std::vector<double> &A, std::vector<double> &b, int n) {
+  for (int c = 0; c < n; c++) {
+    int p = c;
+    for (int r = c+1; r < n; r++) {
+      if (std::fabs(A[r*n+c]) > std::fabs(A[p*n+c])) p = r;
+    }
+    if (!(std::fabs(A[p*n+c]) > 0)) return false;
+    if (p != c) {
+      for (int k = 0; k < n; k++) std::swap(A[c*n+k], A[p*n+k]);
+      std::swap(b[c], b[p]);
+    }
+    for (int r = c+1; r < n; r++) {
+      double l = A[r*n+c] / A[c*n+c];
+      for (int k = c; k < n; k++) A[r*n+k] -= l * A[c*n+k];
+      b[r] -= l * b[c];
+    }
+  }
+  for (int r = n-1; r >= 0; r--) {
+    for (int k = r+1; k < n; k++) b[r] -= A[r*n+k] * b[k];
+    b[r] /= A[r*n+r];
+  }
+  return true;
+}
+
+// Least squares problem: weighted residuals of the deterministic model at the data points and their Jacobian
+// with respect to the fitted variables (on log scale: with respect to the logarithms), from one sensitivity solve
+struct fit_problem {
+  const model_info *info;
+  sim_problem pb;
+  std::vector<int> variables;
+  int nparams;
+  bool log_scale;
+  double rtol, atol;
+  std::vector<int> point_output, point_species;   // data points (output time and species)
+  std::vector<double> point_value, point_weight;
+  std::vector<double> out, sens;
+
+  // Sets the variables to theta (log values on log scale)
+  void set(const std::vector<double> &theta) {
+    for (size_t v = 0; v < variables.size(); v++) {
+      double value = log_scale ? std::exp(theta[v]) : theta[v];
+      if (variables[v] < nparams) {
+        pb.params[variables[v]] = value;
+      } else {
+        pb.c0[variables[v] - nparams] = value;
+      }
+    }
+  }
+
+  // Residuals r and Jacobian Jr[point*nvariables + variable]; returns the sum of squares (NaN if the solver failed, so that a trial
+  // step into a region the solver cannot integrate is rejected like any step that does not reduce the sum of squares)
+  double evaluate(const std::vector<double> &theta, std::vector<double> &r, std::vector<double> &Jr) {
+    const int ns = info->nspecies;
+    const int k = variables.size();
+    set(theta);
+    try {
+      info->ode_sensitivity_simulator(pb, variables, rtol, atol, &out[0], &sens[0], &sim_check_interrupt);
+    } catch (std::runtime_error &) {
+      return NAN;
+    }
+    double ssr = 0.0;
+    for (size_t j = 0; j < point_value.size(); j++) {
+      const int o = point_output[j], i = point_species[j];
+      r[j] = point_weight[j] * (out[(size_t)o*ns + i] - point_value[j]);
+      ssr += r[j] * r[j];
+      for (int v = 0; v < k; v++) {
+        double scale = log_scale ? std::exp(theta[v]) : 1.0;
+        Jr[j*k + v] = point_weight[j] * sens[((size_t)o*k + v)*ns + i] * scale;
+      }
+    }
+    return (ssr == ssr) ? ssr : NAN;
+  }
+};
+
+
+//' Fit Deterministic Model to Data (exported to R)
+//'
+//' Fits reaction parameters and/or initial concentrations of the deterministic model to measured concentration time courses by
+//' weighted nonlinear least squares (Levenberg-Marquardt). The Jacobian of the residuals comes from the exact forward
+//' sensitivities of the model (see ode_sensitivity()), so every iteration costs one augmented solve instead of one solve per
+//' fitted variable. Positive variables are fitted on log scale by default.
+//' @param model A string: the name of the model ("ano", "calcineurin", "calmodulin", "camkii", "glycphos" or "pkc").
+//' @param input_df A Dataframe: the input Calcium time series (with at least two columns: "time" in s and "Ca" in nmol/l).
+//' @param data A Dataframe: the measurements, a column "time" (increasing, within the input) and one column per measured species [nmol/l] (NA for missing values).
+//' @param params A character vector: the reaction parameters and species (initial concentrations) to fit (not parameters given as input
+//'               signals in input_df, e.g. "Vm" of Ano1).
+//' @param input_sim_params A List: optionally the solver tolerances ("rtol", "atol"; default 1e-8 and 1e-10).
+//' @param input_model_params A List: the model specific parameters (the start values of the fitted variables and the fixed values). Can contain up to three different vectors named "vols" (model volumes), "init_conc" (initial conditions) and "params" (reaction parameters).
+//' @param weights A named numeric vector: weights of the measured species (default 1 for all).
+//' @param log_scale A boolean: fit the logarithms of the variables (start values have to be positive).
+//' @param max_iterations An integer: the maximum number of iterations.
+//' @param tolerance A number: convergence tolerance (relative change of the sum of squares and of the variables).
+//' @return A list with the fitted values ("params"), their approximate standard errors ("std_errors", from the Gauss-Newton covariance),
+//'         the residual sum of squares ("ssr"), the number of iterations, whether the fit converged, the "status" ("converged"; "stalled": no
+//'         step reduces the sum of squares before the convergence criteria are met; "max_iterations") and the fitted trajectory at the data
+//'         times ("fitted").
+//' @examples
+//' ca <- data.frame(time = seq(0, 20, by = 0.1), Ca = 500)
+//' data <- data.frame(time = 1:20, Prot_act = detSim_calmodulin(ca, list(outputTimes = 1:20), list())$Prot_act)
+//' fit <- fit_model("calmodulin", ca, data, c("k_on", "k_off"), input_model_params = list(params = c(k_on = 0.01, k_off = 0.01)))
+//' fit$params
+//' @export
+// [[Rcpp::export]]
+List fit_model(std::string model,
+               DataFrame input_df,
+               DataFrame data,
+               CharacterVector params,
+               List input_sim_params = List::create(),
+               List input_model_params = List::create(),
+               NumericVector weights = NumericVector::create(),
+               bool log_scale = true,
+               int max_iterations = 100,
+               double tolerance = 1e-8) {
+
+  // READ INPUT AND UPDATE DEFAULTS
+  fit_problem fp;
+  fp.info = &find_model(model);
+  const model_info &info = *fp.info;
+  fp.pb = read_sim_problem(info, input_df, input_sim_params, input_model_params);
+  fp.nparams = fp.pb.params.size();
+  fp.log_scale = log_scale;
+  fp.rtol = sim_param(input_sim_params, "rtol", 1e-8);
+  fp.atol = sim_param(input_sim_params, "atol", 1e-10);
+  const int k = params.length();
+  if (k == 0) {
+    stop("No parameters to fit.");
+  }
+  std::vector<double> theta(k);
+  for (int v = 0; v < k; v++) {
+    fp.variables.push_back(find_variable(info, as<std::string>(params[v])));
+    const std::vector<int> &signals = fp.pb.inputs.param_index;
+    if (std::find(signals.begin(), signals.end(), fp.variables[v]) != signals.end()) {
+      stop("'" + as<std::string>(params[v]) + "' is given as input signal (column of input_df) and cannot be fitted.");
+    }
+    double value = (fp.variables[v] < fp.nparams) ? fp.pb.params[fp.variables[v]] : fp.pb.c0[fp.variables[v] - fp.nparams];
+    if (log_scale && !(value > 0)) {
+      stop("The start value of '" + as<std::string>(params[v]) + "' has to be positive for fitting on log scale.");
+    }
+    theta[v] = log_scale ? std::log(value) : value;
+  }
+  // Data points (output times are the data times)
+  if (!data.containsElementNamed("time")) {
+    stop("data needs a column \"time\".");
+  }
+  NumericVector data_time = data["time"];
+  fp.pb.output_times.assign(data_time.begin(), data_time.end());
+  for (size_t o = 0; o < fp.pb.output_times.size(); o++) {
+    if ((fp.pb.output_times[o] < fp.pb.input_time_at(0)) || ((o > 0) && (fp.pb.output_times[o] <= fp.pb.output_times[o-1]))) {
+      stop("The data times have to be increasing and not before the start of the input.");
+    }
+  }
+  fp.pb.generator.prepare(fp.pb.end_time());
+  for (int i = 0; i < info.nspecies; i++) {
+    const std::string &name = info.species_names[i];
+    if (!data.containsElementNamed(name.c_str())) continue;
+    double weight = weights.containsElementNamed(name.c_str()) ? (double)weights[name] : 1.0;
+    NumericVector values = data[name];
+    for (int o = 0; o < values.length(); o++) {
+      if (ISNAN(values[o])) continue;
+      fp.point_output.push_back(o);
+      fp.point_species.push_back(i);
+      fp.point_value.push_back(values[o]);
+      fp.point_weight.push_back(weight);
+    }
+  }
+  const int npoints = fp.point_value.size();
+  if (npoints == 0) {
+    stop("data has no values of species of the model.");
+  }
+  fp.out.resize(fp.pb.output_times.size()*info.nspecies);
+  fp.sens.resize(fp.pb.output_times.size()*k*info.nspecies);
+
+  // LEVENBERG-MARQUARDT ITERATION (damping of the Gauss-Newton step with the diagonal of J'J)
+  std::vector<double> r(npoints), Jr((size_t)npoints*k), r_new(npoints), Jr_new((size_t)npoints*k);
+  double ssr = fp.evaluate(theta, r, Jr);
+  if (ssr != ssr) {
+    stop("The model could not be solved with the start values.");
+  }
+  double lambda = 1e-3;
+  bool converged = false, stalled = false;
+  int iteration = 0;
+  std::vector<double> A(k*k), g(k), step(k), theta_new(k);
+  while ((iteration < max_iterations) && !converged && !stalled) {
+    iteration++;
+    sim_check_interrupt();
+    std::vector<double> JtJ(k*k, 0.0), Jtr(k, 0.0);
+    for (int j = 0; j < npoints; j++) {
+      for (int a = 0; a < k; a++) {
+        Jtr[a] += Jr[j*k+a] * r[j];
+        for (int b = 0; b < k; b++) JtJ[a*k+b] += Jr[j*k+a] * Jr[j*k+b];
+      }
+    }
+    // Increase the damping until a step reduces the sum of squares
+    bool accepted = false;
+    while (!accepted && (lambda < 1e12)) {
+      A = JtJ;
+      for (int a = 0; a < k; a++) {
+        A[a*k+a] += lambda * std::max(JtJ[a*k+a], 1e-12);
+        step[a] = -Jtr[a];
+      }
+      if (solve_system(A, step, k)) {
+        for (int a = 0; a < k; a++) theta_new[a] = theta[a] + step[a];
+        double ssr_new = fp.evaluate(theta_new, r_new, Jr_new);
+        if (ssr_new <= ssr) {
+          double max_step = 0.0;
+          for (int a = 0; a < k; a++) max_step = std::max(max_step, std::fabs(step[a]) / (std::fabs(theta[a]) + tolerance));
+          converged = (ssr - ssr_new <= tolerance * ssr) || (max_step <= tolerance);
+          theta.swap(theta_new);
+          r.swap(r_new);
+          Jr.swap(Jr_new);
+          ssr = ssr_new;
+          lambda = std::max(lambda / 10, 1e-12);
+          accepted = true;
+        }
+      }
+      if (!accepted) lambda *= 10;
+    }
+    // no step reduces the sum of squares even at the largest damping: the fit stalls before the convergence criteria are met
+    // (e.g. a minimum within the accuracy of the solver, or variables the data does not determine)
+    stalled = !accepted;
+  }
+
+  // Fitted values, standard errors from the covariance sigma^2 (J'J)^-1 (delta method on log scale) and the fitted trajectory
+  fp.set(theta);
+  NumericVector values(k), std_errors(k);
+  std::vector<double> JtJ(k*k, 0.0);
+  for (int j = 0; j < npoints; j++) {
+    for (int a = 0; a < k; a++) {
+      for (int b = 0; b < k; b++) JtJ[a*k+b] += Jr[j*k+a] * Jr[j*k+b];
+    }
+  }
+  double sigma2 = (npoints > k) ? ssr / (npoints - k) : NA_REAL;
+  for (int a = 0; a < k; a++) {
+    values[a] = log_scale ? std::exp(theta[a]) : theta[a];
+    std::vector<double> M(JtJ), e(k, 0.0);
+    e[a] = 1.0;
+    std_errors[a] = solve_system(M, e, k) ? std::sqrt(sigma2 * e[a]) * (log_scale ? values[a] : 1.0) : NA_REAL;
+  }
+  values.names() = params;
+  std_errors.names() = params;
+  info.ode_simulator(fp.pb, fp.rtol, fp.atol, &fp.out[0], &sim_check_interrupt);
+
+  const char *status = converged ? "converged" : (stalled ? "stalled" : "max_iterations");
+  return List::create(_["params"] = values, _["std_errors"] = std_errors, _["ssr"] = ssr, _["iterations"] = iteration,
+                      _["converged"] = converged, _["status"] = status, _["fitted"] = trajectory_frame(info, fp.pb, &fp.out[0]));
+}
@@ -0,0 +1,337 @@
+#include <string>
+#include <vector>
+#include <complex>
+#include <cmath>
+#include <algorithm>
+#include <Rcpp.h>
+#include "model_registry.hpp"
+#include "buffer_pool.hpp"
+#include "parallel.hpp"
+#include "sim_params.hpp"
+#include "result_columns.hpp"
+using namespace Rcpp;
+
+
+// Frequency response of the models to oscillating calcium (see sim_frequency_response())
+// Every point of the sweep is simulated cycle by cycle with the procedural input of stimulus.hpp, sampled at the ends of the
+// input intervals (samples per cycle). Per cycle and selected species the time average and the first Fourier coefficient of the
+// samples are computed; the run stops in the periodic steady state, when they do not change from one cycle to the next.
+
+typedef std::complex<double> phasor;
+
+struct sweep_model {
+  const model_info *info;
+  sim_problem problem;        // parameters and initial state (the input is set per point)
+  std::vector<int> species;   // selected species
+};
+
+struct sweep_settings {
+  stimulus_type waveform;
+  double baseline, tau;
+  int samples, max_cycles;
+  double tolerance;
+  bool stochastic;
+  int nreplicates;
+  uint64_t seed;
+  double rtol, atol;
+};
+
+// Statistics of one cycle per selected species (replicate averages and their standard errors for the stochastic engine)
+struct cycle_statistics {
+  std::vector<double> mean, mean_se;
+  std::vector<phasor> harmonic;
+  std::vector<double> harmonic_se;   // of the real and imaginary part (larger one)
+};
+
+struct sweep_result {
+  std::vector<double> mean, gain, phase;   // per selected species
+  int cycles;
+  bool steady;
+};
+
+// Changes between consecutive cycles within the tolerance (relative to the time average, at least atol) plus three standard errors
+static bool periodic(const cycle_statistics &a, const cycle_statistics &b, double tolerance, double atol) {
+  for (size_t c = 0; c < a.mean.size(); c++) {
+    double allowed = tolerance * std::max(std::fabs(b.mean[c]), atol);
+    double noise = 3.0 * std::sqrt(a.mean_se[c]*a.mean_se[c] + b.mean_se[c]*b.mean_se[c]);
+    double harmonic_noise = 3.0 * std::sqrt(a.harmonic_se[c]*a.harmonic_se[c] + b.harmonic_se[c]*b.harmonic_se[c]);
+    if (std::fabs(b.mean[c] - a.mean[c]) > allowed + noise) return false;
+    if (std::fabs(b.harmonic[c].real() - a.harmonic[c].real()) > allowed + harmonic_noise) return false;
+    if (std::fabs(b.harmonic[c].imag() - a.harmonic[c].imag()) > allowed + harmonic_noise) return false;
+  }
+  return true;
+}
+
+// Simulates one point of the sweep (replicates on the random number streams stream*nreplicates + r)
+static void sweep_point(const sweep_model &m, const sweep_settings &cfg, double frequency, double amplitude, double duty,
+                        uint64_t stream, sweep_result &result) {
+  const model_info &info = *m.info;
+  const int ns = info.nspecies, nsel = m.species.size(), N = cfg.samples;
+  const double period = 1.0 / frequency, w = 6.283185307179586 * frequency;
+  sim_problem pb = m.problem;
+  stimulus &g = pb.generator;
+  g.type = cfg.waveform;
+  g.resolution = period / N;
+  g.baseline = cfg.baseline;
+  g.amplitude = amplitude;
+  g.frequency = frequency;
+  g.duty = duty;
+  g.tau = cfg.tau;
+  // Fourier weights of the samples (end of input interval j+1 of a cycle)
+  std::vector<phasor> weight(N);
+  for (int j = 0; j < N; j++) {
+    weight[j] = std::polar(1.0 / N, -w * (j + 1) * g.resolution);
+  }
+
+  std::vector<cycle_statistics> stats(2);
+  for (int k = 0; k < 2; k++) {
+    stats[k].mean.assign(nsel, 0.0);
+    stats[k].mean_se.assign(nsel, 0.0);
+    stats[k].harmonic.assign(nsel, phasor(0.0, 0.0));
+    stats[k].harmonic_se.assign(nsel, 0.0);
+  }
+  std::vector<double> y, means(nsel), sum(nsel), sq(nsel), re_sq(nsel), im_sq(nsel);
+  std::vector<phasor> harmonic(nsel);
+  std::vector<ssa_state> states;
+  if (cfg.stochastic) {
+    // one problem for the whole run: the engine stops exactly at the interval ends 'until'
+    pb.output_times.assign(1, cfg.max_cycles * period);
+    for (int r = 0; r < cfg.nreplicates; r++) {
+      states.push_back(ssa_initial_state(pb, cfg.seed, stream * cfg.nreplicates + r));
+    }
+  } else {
+    y = pb.c0;
+    pb.output_times.resize(N);
+  }
+  double *out = thread_buffers().get(buffer_output, (size_t)N * ns);
+
+  result.steady = false;
+  int n = 0;
+  for (; (n < cfg.max_cycles) && !result.steady && !parallel_cancelled(); n++) {
+    cycle_statistics &current = stats[n % 2];
+    if (cfg.stochastic) {
+      std::fill(sum.begin(), sum.end(), 0.0);
+      std::fill(sq.begin(), sq.end(), 0.0);
+      std::fill(re_sq.begin(), re_sq.end(), 0.0);
+      std::fill(im_sq.begin(), im_sq.end(), 0.0);
+      std::fill(current.harmonic.begin(), current.harmonic.end(), phasor(0.0, 0.0));
+      for (int r = 0; r < cfg.nreplicates; r++) {
+        std::fill(harmonic.begin(), harmonic.end(), phasor(0.0, 0.0));
+        std::fill(means.begin(), means.end(), 0.0);
+        for (int j = 0; j < N; j++) {
+          info.ssa_simulator(pb, states[r], g.time(n*N + j + 1), out, UINT64_MAX, 0, 0);
+          for (int c = 0; c < nsel; c++) {
+            double x = states[r].x[m.species[c]] / pb.f;
+            means[c] += x / N;
+            harmonic[c] += x * weight[j];
+          }
+        }
+        for (int c = 0; c < nsel; c++) {
+          sum[c] += means[c];
+          sq[c] += means[c] * means[c];
+          current.harmonic[c] += harmonic[c];
+          re_sq[c] += harmonic[c].real() * harmonic[c].real();
+          im_sq[c] += harmonic[c].imag() * harmonic[c].imag();
+        }
+      }
+      const double R = cfg.nreplicates;
+      for (int c = 0; c < nsel; c++) {
+        current.mean[c] = sum[c] / R;
+        current.harmonic[c] /= R;
+        const phasor &h = current.harmonic[c];
+        current.mean_se[c] = (R > 1) ? std::sqrt(std::max(0.0, sq[c]/R - current.mean[c]*current.mean[c]) / (R - 1)) : 0.0;
+        current.harmonic_se[c] = (R > 1) ? std::sqrt(std::max(0.0, std::max(re_sq[c]/R - h.real()*h.real(),
+                                                                          im_sq[c]/R - h.imag()*h.imag())) / (R - 1)) : 0.0;
+      }
+    } else {
+      // the cycle as a problem of its own, starting from the state at the end of the previous one (the origin of the input stays)
+      g.start = n * period;
+      for (int j = 0; j < N; j++) {
+        pb.output_times[j] = g.time(j + 1);
+      }
+      pb.c0 = y;
+      info.ode_simulator(pb, cfg.rtol, cfg.atol, out, 0);
+      y.assign(out + (size_t)(N-1)*ns, out + (size_t)N*ns);
+      for (int c = 0; c < nsel; c++) {
+        current.mean[c] = 0.0;
+        current.harmonic[c] = phasor(0.0, 0.0);
+        for (int j = 0; j < N; j++) {
+          double x = out[(size_t)j*ns + m.species[c]];
+          current.mean[c] += x / N;
+          current.harmonic[c] += x * weight[j];
+        }
+      }
+    }
+    result.steady = (n > 0) && periodic(stats[(n+1) % 2], current, cfg.tolerance, cfg.atol);
+  }
+  result.cycles = n;
+  if (n == 0) return;   // cancelled before the first cycle (the result is discarded)
+
+  // Fourier coefficient of the input over the last cycle (exact for the piecewise constant input; the response is sampled at the
+  // interval ends, which delays its phase by half an interval against the continuous coefficient)
+  const double start = g.start;
+  g.start = 0.0;
+  phasor input(0.0, 0.0);
+  const double dt = g.resolution;
+  for (int k = 0; k < N; k++) {
+    input += g.value((n-1)*N + k) * std::polar(1.0, -w * k * dt);
+  }
+  input *= (phasor(1.0, 0.0) - std::polar(1.0, -w * dt)) / phasor(0.0, w * period);
+  g.start = start;
+  const cycle_statistics &last = stats[(n-1) % 2];
+  result.mean = last.mean;
+  result.gain.assign(nsel, NA_REAL);
+  result.phase.assign(nsel, NA_REAL);
+  for (int c = 0; c < nsel; c++) {
+    if (std::abs(input) > 0) {
+      result.gain[c] = std::abs(last.harmonic[c]) / std::abs(input);
+      if (std::abs(last.harmonic[c]) > 0) result.phase[c] = std::arg(last.harmonic[c] / input);
+    }
+  }
+}
+
+
+//' Frequency Response Sweep (exported to R)
+//'
+//' Simulates models with oscillating calcium input on a grid of frequencies, amplitudes and duty cycles (all combinations) and
+//' reports, per point and species, the response in the periodic steady state: the time average ("mean"), the gain (amplitude of the
+//' first harmonic of the response per amplitude of the first harmonic of the input) and the phase of the first harmonic relative to
+//' the input (negative: the response lags behind). The input is procedural (see sim_stimulus(): "pulses", "sine" or "spikes",
+//' from the baseline to baseline + amplitude) and evaluated by the engine, the points run in parallel on native threads.
+//' Every run is simulated cycle by cycle and stops as soon as the time average and the first harmonic of all selected species
+//' change by less than the tolerance (relative to the time average) from one cycle to the next; with the stochastic engine,
+//' changes within three standard errors of the ensemble averages count as unchanged.
+//' @param models A character vector: the names of the models ("ano", "calcineurin", "calmodulin", "camkii", "glycphos" or "pkc").
+//' @param frequencies A numeric vector: the frequencies [Hz].
+//' @param amplitudes A numeric vector: the amplitudes above the baseline [nmol/l].
+//' @param duty A numeric vector: the duty cycles (fraction of the cycle with high calcium, "pulses" only).
+//' @param species A character vector: the species (default: all species of each model; species a model does not have are skipped).
+//' @param input_sim_params A List: optionally the solver tolerances ("rtol", "atol"), a "seed" and "baselineCa" (the stochastic runs start
+//'                         from equilibrated states at this calcium concentration, see sim_equilibrate()).
+//' @param input_model_params A List: the model specific parameters ("vols", "init_conc" and "params"), or a list of them named by model.
+//' @param waveform A string: "pulses", "sine" or "spikes".
+//' @param baseline A number: the baseline calcium concentration [nmol/l].
+//' @param method A string: "ode" (deterministic) or "ssa" (ensemble of stochastic replicates).
+//' @param nreplicates An integer: the number of replicates per point ("ssa").
+//' @param samples_per_cycle An integer: the number of input intervals and samples per cycle (the duty cycles are rounded to them).
+//' @param max_cycles An integer: the maximum number of cycles per point.
+//' @param tolerance A number: the relative change between cycles regarded as periodic steady state.
+//' @param tau A number: the decay time of the spikes [s] ("spikes" only).
+//' @param nthreads An integer: the number of threads (default: all hardware threads).
+//' @return A dataframe with the model, frequency, amplitude, duty cycle and species of each point, the time average ("mean"), "gain" and
+//'         "phase" [rad] of the response in the last cycle, the number of simulated cycles and whether the periodic steady state was reached.
+//' @examples
+//' fr <- sim_frequency_response(c("camkii", "calcineurin"), frequencies = c(0.1, 0.5, 1, 2), amplitudes = c(500, 1000),
+//'                              duty = c(0.2, 0.5), species = c("W_A", "Prot_act"))
+//' @export
+// [[Rcpp::export]]
+DataFrame sim_frequency_response(CharacterVector models,
+                                 NumericVector frequencies,
+                                 NumericVector amplitudes,
+                                 NumericVector duty = NumericVector::create(0.5),
+                                 CharacterVector species = CharacterVector::create(),
+                                 List input_sim_params = List::create(),
+                                 List input_model_params = List::create(),
+                                 std::string waveform = "pulses",
+                                 double baseline = 100,
+                                 std::string method = "ode",
+                                 int nreplicates = 100,
+                                 int samples_per_cycle = 100,
+                                 int max_cycles = 100,
+                                 double tolerance = 1e-3,
+                                 double tau = 0.1,
+                                 int nthreads = 0) {
+
+  // READ INPUT AND UPDATE DEFAULTS
+  sweep_settings cfg;
+  if (waveform == "pulses") {
+    cfg.waveform = stimulus_pulses;
+  } else if (waveform == "sine") {
+    cfg.waveform = stimulus_sine;
+  } else if (waveform == "spikes") {
+    cfg.waveform = stimulus_spikes;
+  } else {
+    stop("waveform has to be \"pulses\", \"sine\" or \"spikes\".");
+  }
+  if ((method != "ode") && (method != "ssa")) {
+    stop("method has to be \"ode\" or \"ssa\".");
+  }
+  if ((samples_per_cycle < 2) || (max_cycles < 2) || !(tolerance > 0) || (nreplicates < 1) || !(tau > 0)) {
+    stop("samples_per_cycle and max_cycles have to be at least 2, nreplicates at least 1, tolerance and tau positive.");
+  }
+  for (int k = 0; k < frequencies.length(); k++) {
+    if (!(frequencies[k] > 0)) stop("The frequencies have to be positive.");
+  }
+  cfg.baseline = baseline;
+  cfg.tau = tau;
+  cfg.samples = samples_per_cycle;
+  cfg.max_cycles = max_cycles;
+  cfg.tolerance = tolerance;
+  cfg.stochastic = (method == "ssa");
+  cfg.nreplicates = cfg.stochastic ? nreplicates : 1;
+  cfg.seed = sim_seed(input_sim_params);
+  cfg.rtol = sim_param(input_sim_params, "rtol", 1e-6);
+  cfg.atol = sim_param(input_sim_params, "atol", 1e-6);
+
+  std::vector<std::string> selected = as<std::vector<std::string> >(species);
+  std::vector<sweep_model> sweep_models(models.length());
+  for (int i = 0; i < models.length(); i++) {
+    const std::string name = as<std::string>(models[i]);
+    sweep_model &m = sweep_models[i];
+    m.info = &find_model(name);
+    List params = input_model_params.containsElementNamed(name.c_str()) ? as<List>(input_model_params[name]) : input_model_params;
+    read_model_problem(*m.info, m.info->resolve_params(params), m.problem);
+    if (cfg.stochastic && input_sim_params.containsElementNamed("baselineCa")) {
+      m.problem.x0_pool = equilibrated_states(*m.info, m.problem, read_warm_start_options(input_sim_params));
+    }
+    for (int k = 0; k < m.info->nspecies; k++) {
+      const std::string &s = m.info->species_names[k];
+      if (selected.empty() || (std::find(selected.begin(), selected.end(), s) != selected.end())) m.species.push_back(k);
+    }
+    if (m.species.empty()) {
+      stop("The model '" + name + "' has none of the species.");
+    }
+  }
+
+  // RUN SIMULATIONS (one task per model and point)
+  const int nf = frequencies.length(), na = amplitudes.length(), nd = duty.length();
+  const int npoints = nf * na * nd, ntasks = models.length() * npoints;
+  std::vector<sweep_result> results(ntasks);
+  const double *f = frequencies.begin(), *a = amplitudes.begin(), *d = duty.begin();
+  parallel_for(ntasks, worker_threads(nthreads), [&](int t, int thread) {
+    const int p = t % npoints;
+    sweep_point(sweep_models[t / npoints], cfg, f[p / (na*nd)], a[(p / nd) % na], d[p % nd], t, results[t]);
+  }, &sim_check_interrupt);
+  sim_check_interrupt();
+
+  // Result rows: model, point, species
+  int nrow = 0;
+  for (int t = 0; t < ntasks; t++) nrow += sweep_models[t / npoints].species.size();
+  CharacterVector model_column(nrow), species_column(nrow);
+  NumericVector frequency_column(nrow), amplitude_column(nrow), duty_column(nrow), mean_column(nrow), gain_column(nrow),
+                phase_column(nrow);
+  IntegerVector cycles_column(nrow);
+  LogicalVector steady_column(nrow);
+  for (int t = 0, row = 0; t < ntasks; t++) {
+    const sweep_model &m = sweep_models[t / npoints];
+    const int p = t % npoints;
+    for (size_t c = 0; c < m.species.size(); c++, row++) {
+      model_column[row] = m.info->name;
+      frequency_column[row] = f[p / (na*nd)];
+      amplitude_column[row] = a[(p / nd) % na];
+      duty_column[row] = d[p % nd];
+      species_column[row] = m.info->species_names[m.species[c]];
+      mean_column[row] = results[t].mean[c];
+      gain_column[row] = results[t].gain[c];
+      phase_column[row] = results[t].phase[c];
+      cycles_column[row] = results[t].cycles;
+      steady_column[row] = results[t].steady;
+    }
+  }
+  List columns = List::create(model_column, frequency_column, amplitude_column, duty_column, species_column, mean_column,
+                              gain_column, phase_column, cycles_column, steady_column);
+  CharacterVector names(10);
+  const char *column_names[] = { "model", "frequency", "amplitude", "duty", "species", "mean", "gain", "phase", "cycles", "steady" };
+  for (int c = 0; c < 10; c++) names[c] = column_names[c];
+  return result_frame(columns, names, nrow);
+}
@@ -0,0 +1,32 @@
+#ifndef INPUT_SIGNALS_HPP
+#define INPUT_SIGNALS_HPP
+
+#include <vector>
+
+
+// Additional input signals
+// Model parameters declared in MODEL_INPUTS (e.g. the membrane potential Vm of Ano1) can be supplied as columns of the
+// input data frame. Like calcium they are piecewise constant between the input time points.
+struct input_signals {
+  std::vector<int> param_index;              // position in the parameter array (model definition order)
+  std::vector<std::vector<double> > values;  // value on every input interval
+
+  bool empty() const { return param_index.empty(); }
+
+  // True if one of the signals changes at input time point k
+  bool changes_at(int k) const {
+    for (size_t i = 0; i < values.size(); i++) {
+      if (values[i][k] != values[i][k-1]) return true;
+    }
+    return false;
+  }
+
+  // Set the parameters given as input signals to their values on input interval k
+  void apply(double *params, int k) const {
+    for (size_t i = 0; i < param_index.size(); i++) {
+      params[param_index[i]] = values[i][k];
+    }
+  }
+};
+
+#endif
@@ -0,0 +1,108 @@
+#ifndef MAPPED_FILE_HPP
+#define MAPPED_FILE_HPP
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdio>
+#include <algorithm>
+#ifdef _WIN32
+  #ifndef WIN32_LEAN_AND_MEAN
+    #define WIN32_LEAN_AND_MEAN
+  #endif
+  #ifndef NOMINMAX
+    #define NOMINMAX
+  #endif
+  #include <windows.h>
+#else
+  #include <fcntl.h>
+  #include <unistd.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+#endif
+
+
+// Read-only memory-mapped file (the pages are loaded on demand by the operating system and shared between processes)
+// POSIX mmap or, on Windows, a file mapping object (CreateFileMapping/MapViewOfFile). data is null if the file cannot be opened.
+class mapped_file {
+public:
+  explicit mapped_file(const std::string &path) : data(0), size(0), mapping(0) {
+#ifdef _WIN32
+    // other processes may write, rename or delete the file meanwhile (like with mmap)
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, 0, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL, 0);
+    if (file == INVALID_HANDLE_VALUE) return;
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size)) file_size.QuadPart = -1;
+    if ((file_size.QuadPart > 0) && ((unsigned long long)file_size.QuadPart <= (size_t)-1)) {
+      HANDLE view_source = CreateFileMappingA(file, 0, PAGE_READONLY, 0, 0, 0);
+      if (view_source) {
+        void *p = MapViewOfFile(view_source, FILE_MAP_READ, 0, 0, 0);
+        if (p) {
+          mapping = p;
+          data = static_cast<const unsigned char *>(p);
+          size = (size_t)file_size.QuadPart;
+        }
+        // the view keeps the mapping object alive
+        CloseHandle(view_source);
+      }
+    } else if (file_size.QuadPart == 0) {
+      data = reinterpret_cast<const unsigned char *>("");
+    }
+    CloseHandle(file);
+#else
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) return;
+    struct stat st;
+    if ((fstat(fd, &st) == 0) && (st.st_size > 0)) {
+      void *p = mmap(0, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (p != MAP_FAILED) {
+        mapping = p;
+        data = static_cast<const unsigned char *>(p);
+        size = (size_t)st.st_size;
+      }
+    } else if (st.st_size == 0) {
+      data = reinterpret_cast<const unsigned char *>("");
+    }
+    close(fd);
+#endif
+  }
+  // Drops the pages of bytes from..to-1 from memory (they are read again from the file if needed), for files read once in blocks
+  void release(size_t from, size_t to) {
+    if (!mapping) return;
+#ifdef _WIN32
+    // unlocking pages that are not locked removes them from the working set
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    const size_t page = info.dwPageSize;
+#else
+    const size_t page = (size_t)sysconf(_SC_PAGESIZE);
+#endif
+    from = (from + page - 1) / page * page;
+    to = std::min(to, size);
+    if (to <= from) return;
+#ifdef _WIN32
+    VirtualUnlock(static_cast<char *>(mapping) + from, to - from);
+#else
+    madvise(static_cast<char *>(mapping) + from, to - from, MADV_DONTNEED);
+#endif
+  }
+  ~mapped_file() {
+    if (!mapping) return;
+#ifdef _WIN32
+    UnmapViewOfFile(mapping);
+#else
+    munmap(mapping, size);
+#endif
+  }
+
+  const unsigned char *data;
+  size_t size;
+
+private:
+  mapped_file(const mapped_file &);
+  mapped_file &operator=(const mapped_file &);
+  void *mapping;
+};
+
+#endif
@@ -0,0 +1,162 @@
+#include <string>
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <Rcpp.h>
+#include "evaluation.hpp"
+#include "parallel.hpp"
+#include "sim_params.hpp"
+using namespace Rcpp;
+
+
+// Samples of one level of the multilevel estimator: corrections (fine minus coarse readout), fine readouts and work per sample
+struct mlmc_level {
+  mlmc_coupling coupling;
+  double tau;                 // (fine) tau-leap step; exact pair: the step of the coarse tau-leap path
+  std::vector<double> y, q, work;
+
+  double mean(const std::vector<double> &v) const {
+    double sum = 0.0;
+    for (size_t i = 0; i < v.size(); i++) sum += v[i];
+    return v.empty() ? 0.0 : sum / v.size();
+  }
+  double variance(const std::vector<double> &v) const {
+    double m = mean(v), sum = 0.0;
+    for (size_t i = 0; i < v.size(); i++) sum += (v[i] - m) * (v[i] - m);
+    return (v.size() > 1) ? sum / (v.size() - 1) : 0.0;
+  }
+};
+
+
+//' Multilevel Monte Carlo Estimation of Expected Readouts (exported to R)
+//'
+//' Estimates the expectation of a readout of the stochastic model (e.g. the time average of an active species) to a requested root mean
+//' square error with the multilevel Monte Carlo method for continuous time Markov chains (Anderson & Higham 2012): the expectation of
+//' a cheap tau-leap path with a coarse step is corrected by the expected differences of coupled tau-leap paths with steps refined by a
+//' constant factor, and finally by the expected difference between exact SSA paths and coupled tau-leap paths with the finest step.
+//' The estimate is unbiased for the exact (SSA) expectation. The coupled paths stay close, so the corrections have small variances and
+//' need few samples. After a pilot run the number of samples per level is chosen to minimise the work for the requested error
+//' (work: propensity evaluations), and refined until the estimated variances agree. Samples are simulated in parallel on native
+//' threads; the results do not depend on the number of threads.
+//' @param model A string: the name of the model ("ano", "calcineurin", "calmodulin", "camkii", "glycphos" or "pkc").
+//' @param input_df A Dataframe: the input Calcium time series (with at least two columns: "time" in s and "Ca" in nmol/l).
+//' @param input_sim_params A List: contains values for the simulation end ("endTime") and its timesteps ("timestep") or a vector of output times ("outputTimes"), and optionally a "seed".
+//'                         With "baselineCa" the paths start from equilibrated states at this calcium concentration (see sim_equilibrate()).
+//' @param input_model_params A List: the model specific parameters. Can contain up to three different vectors named "vols" (model volumes), "init_conc" (initial conditions) and "params" (reaction parameters).
+//' @param species A string: the species of the readout.
+//' @param rmse A number: the requested root mean square error of the estimate [nmol/l].
+//' @param statistic A string: the readout, "mean" (time average over the output times), "max" or "final" (value at the last output time).
+//' @param tau A number: the tau-leap step of the coarsest level [s] (default: a hundredth of the simulated time).
+//' @param refinement An integer: the factor between the steps of consecutive levels.
+//' @param nlevels An integer: the number of tau-leap levels (the exact level comes on top).
+//' @param pilot_samples An integer: the number of samples per level of the pilot run.
+//' @param max_samples An integer: the maximum number of samples per level.
+//' @param nthreads An integer: the number of threads (default: all hardware threads).
+//' @return A list with the estimate, its standard error, whether the requested error was reached, a dataframe with the level, its coupling
+//'         ("tau_leap", "tau_pair", "exact_pair"), step, number of samples, mean and variance of the corrections and mean work per sample ("levels"),
+//'         the total work and the estimated work of a plain SSA ensemble with the same error ("ssa_work").
+//' @examples
+//' ca <- data.frame(time = seq(0, 10, by = 0.01), Ca = 500)
+//' res <- mlmc_expectation("pkc", ca, list(endTime = 10, timestep = 0.1), list(), species = "AADAGPKC_act", rmse = 0.5, tau = 0.1)
+//' res$estimate
+//' @export
+// [[Rcpp::export]]
+List mlmc_expectation(std::string model,
+                      DataFrame input_df,
+                      List input_sim_params,
+                      List input_model_params,
+                      std::string species,
+                      double rmse,
+                      std::string statistic = "mean",
+                      double tau = 0,
+                      int refinement = 4,
+                      int nlevels = 4,
+                      int pilot_samples = 100,
+                      int max_samples = 1000000,
+                      int nthreads = 0) {
+
+  // READ INPUT AND UPDATE DEFAULTS
+  const model_info &info = find_model(model);
+  const int ns = info.nspecies;
+  const sim_problem pb = read_sim_problem(info, input_df, input_sim_params, input_model_params);
+  const readout ro = read_readout(info, species, statistic);
+  const uint64_t seed = sim_seed(input_sim_params);
+  const int noutput = pb.output_times.size();
+  if (!(tau > 0)) tau = (pb.end_time() - pb.input_time_at(0)) / 100;
+  if (!(rmse > 0) || !(tau > 0) || (refinement < 2) || (nlevels < 1) || (pilot_samples < 2) || (max_samples < pilot_samples)) {
+    stop("rmse and tau have to be positive, refinement at least 2, nlevels at least 1, pilot_samples at least 2 and max_samples at least pilot_samples.");
+  }
+  // Levels: tau-leap with the coarsest step, coupled tau-leap pairs with refined steps, exact paths coupled with the finest tau-leap paths
+  std::vector<mlmc_level> levels(nlevels + 1);
+  for (int l = 0; l <= nlevels; l++) {
+    levels[l].coupling = (l == 0) ? mlmc_tau_leap : ((l < nlevels) ? mlmc_tau_pair : mlmc_exact_pair);
+    levels[l].tau = tau / std::pow((double)refinement, (l < nlevels) ? l : l - 1);
+  }
+  nthreads = worker_threads(nthreads);
+
+  // Samples from..to-1 of level l (sample i on random number stream (l << 40) + i)
+  auto run = [&](int l, int from, int to) {
+    mlmc_level &level = levels[l];
+    level.y.resize(to);
+    level.q.resize(to);
+    level.work.resize(to);
+    parallel_for(to - from, nthreads, [&](int n, int thread) {
+      const int i = from + n;
+      Rng rng(seed, ((uint64_t)l << 40) + i);
+      double *out = thread_buffers().get(buffer_output, (size_t)2*noutput*ns);
+      double *out_coarse = out + (size_t)noutput*ns;
+      level.work[i] = info.mlmc_simulator(pb, level.coupling, level.tau, refinement, rng, out, out_coarse);
+      level.q[i] = ro.value(out, noutput, ns);
+      level.y[i] = level.q[i] - ((level.coupling == mlmc_tau_leap) ? 0.0 : ro.value(out_coarse, noutput, ns));
+    }, &sim_check_interrupt);
+  };
+
+  // OPTIMAL NUMBER OF SAMPLES: N_l = sqrt(V_l / C_l) * sum_k sqrt(V_k C_k) / rmse^2 (variance rmse^2 at minimal work, no bias)
+  std::vector<int> target(nlevels + 1, pilot_samples);
+  for (;;) {
+    for (int l = 0; l <= nlevels; l++) {
+      if ((int)levels[l].y.size() < target[l]) run(l, levels[l].y.size(), target[l]);
+    }
+    sim_check_interrupt();
+    double sum = 0.0;
+    for (int l = 0; l <= nlevels; l++) {
+      sum += std::sqrt(levels[l].variance(levels[l].y) * levels[l].mean(levels[l].work));
+    }
+    bool more = false;
+    for (int l = 0; l <= nlevels; l++) {
+      double V = levels[l].variance(levels[l].y), C = levels[l].mean(levels[l].work);
+      double N = (V > 0 && C > 0) ? std::ceil(std::sqrt(V / C) * sum / (rmse * rmse)) : pilot_samples;
+      target[l] = (int)std::min((double)max_samples, std::max(N, (double)pilot_samples));
+      if (target[l] > (int)levels[l].y.size()) more = true;
+    }
+    if (!more) break;
+  }
+
+  // Estimate and summary per level
+  double estimate = 0.0, variance = 0.0, total_work = 0.0;
+  IntegerVector level_index(nlevels + 1), nsamples(nlevels + 1);
+  CharacterVector coupling(nlevels + 1);
+  NumericVector step(nlevels + 1), means(nlevels + 1), variances(nlevels + 1), work(nlevels + 1);
+  const char *coupling_names[] = {"tau_leap", "tau_pair", "exact_pair"};
+  for (int l = 0; l <= nlevels; l++) {
+    const mlmc_level &level = levels[l];
+    level_index[l] = l;
+    coupling[l] = coupling_names[level.coupling];
+    step[l] = level.tau;
+    nsamples[l] = level.y.size();
+    means[l] = level.mean(level.y);
+    variances[l] = level.variance(level.y);
+    work[l] = level.mean(level.work);
+    estimate += means[l];
+    variance += variances[l] / nsamples[l];
+    total_work += work[l] * nsamples[l];
+  }
+  const mlmc_level &exact = levels[nlevels];
+  double ssa_work = exact.variance(exact.q) / (rmse * rmse) * exact.mean(exact.work);
+  DataFrame level_frame = DataFrame::create(_["level"] = level_index, _["coupling"] = coupling, _["tau"] = step,
+                                            _["nsamples"] = nsamples, _["mean"] = means, _["variance"] = variances,
+                                            _["work"] = work, _["stringsAsFactors"] = false);
+
+  return List::create(_["estimate"] = estimate, _["std_error"] = std::sqrt(variance), _["converged"] = std::sqrt(variance) <= rmse,
+                      _["levels"] = level_frame, _["work"] = total_work, _["ssa_work"] = ssa_work);
+}
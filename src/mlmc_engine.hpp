@@ -0,0 +1,147 @@
+#ifndef MLMC_ENGINE_HPP
+#define MLMC_ENGINE_HPP
+
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include "rng.hpp"
+#include "sim_problem.hpp"
+
+
+// Paths of one level of the multilevel Monte Carlo estimator (see mlmc.cpp)
+// mlmc_tau_leap: a tau-leap path with step tau (coarsest level)
+// mlmc_tau_pair: coupled tau-leap paths with steps tau (fine) and tau*refinement (coarse)
+// mlmc_exact_pair: an exact SSA path (fine) coupled with a tau-leap path with step tau (coarse)
+enum mlmc_coupling { mlmc_tau_leap, mlmc_tau_pair, mlmc_exact_pair };
+
+// Multilevel Monte Carlo Simulator (split coupling of tau-leap and exact paths, Anderson & Higham 2012)
+// Kernel is the compile time model description generated by model_definition.hpp (rates and stoichiometry as in ssa_simulator).
+// Both paths start from the same initial state (pb.initial_state) and every reaction j is split into a common channel with the rate
+// min(a_j, b_j), which fires in both paths, and two channels with the rates a_j - min and b_j - min, which fire in only one of them:
+// the paths stay close, so the variance of their difference shrinks with the step. The propensities of a tau-leap path are frozen
+// over its steps (negative propensities of negative particle numbers count as 0); tau-leap pairs draw Poisson numbers of firings per
+// fine step, the exact pair simulates the channels event by event (exact path: propensities after every reaction). Steps restart at
+// every input time point and output time, so the coarse steps are unions of fine steps and calcium is constant on every step.
+// Writes the concentrations at the output times to out_fine and out_coarse (out[output*nspecies + species]; out_coarse is not
+// used for mlmc_tau_leap) and returns the work: the number of propensity evaluations.
+template <class Kernel>
+double mlmc_simulator(const sim_problem &pb, mlmc_coupling coupling, double tau, int refinement, Rng &rng,
+                      double *out_fine, double *out_coarse) {
+  const int ns = Kernel::nspecies;
+  const int nr = Kernel::nreactions;
+  const double *stM = Kernel::stoichiometry();
+  const int noutput = pb.output_times.size();
+  const double endTime = pb.end_time();
+  std::vector<double> params(pb.params);
+  typename Kernel::factors_type factors;
+  double rate[nr];
+  double crate[nr];
+  double cum[3*nr];
+  const double *x0 = pb.initial_state(rng);
+  std::vector<double> x(x0, x0 + ns), xc(x);
+  double work = 0.0;
+  int o = 0;
+
+  // Write the current states to all output times up to 'until'
+  auto record = [&](double until) {
+    while ((o < noutput) && (pb.output_times[o] <= until)) {
+      for (int i = 0; i < ns; i++) {
+        out_fine[(size_t)o*ns + i] = x[i] / pb.f;
+        if (coupling != mlmc_tau_leap) out_coarse[(size_t)o*ns + i] = xc[i] / pb.f;
+      }
+      o++;
+    }
+  };
+  auto propensities = [&](const double *state, double Ca, double *a) {
+    Kernel::rates(&params[0], factors, Ca, state, pb.f, a);
+    for (int j = 0; j < nr; j++) {
+      if (!(a[j] > 0)) a[j] = 0.0;
+    }
+    work++;
+  };
+  auto fire = [&](std::vector<double> &state, int j, double n) {
+    for (int i = 0; i < ns; i++) {
+      state[i] += n * stM[i*nr+j];
+    }
+  };
+
+  double t = pb.input_time_at(0);
+  double budget = -1.0;
+  record(t);
+
+  /* SIMULATION LOOP (input intervals, segments between output times, coarse steps, fine steps) */
+  for (int k = 0; t < endTime; k++) {
+    const double Ca = pb.input_ca_at(k);
+    const double interval_end = pb.interval_end(k);
+    pb.inputs.apply(&params[0], k);
+    Kernel::prepare(&params[0], Ca, factors);
+    while (t < interval_end) {
+      const double segment_end = ((o < noutput) && (pb.output_times[o] < interval_end)) ? pb.output_times[o] : interval_end;
+      while (t < segment_end) {
+        const double coarse_step = (coupling == mlmc_tau_pair) ? tau * refinement : tau;
+        const double coarse_end = (segment_end - t > coarse_step) ? t + coarse_step : segment_end;
+        if (coupling != mlmc_tau_leap) propensities(&xc[0], Ca, crate);
+
+        if (coupling == mlmc_exact_pair) {
+          // Event by event: channels of the exact path (rates updated after each of its reactions) and the frozen tau-leap path
+          bool rates_current = false;
+          for (;;) {
+            if (!rates_current) {
+              propensities(&x[0], Ca, rate);
+              rates_current = true;
+            }
+            double sum = 0.0;
+            for (int j = 0; j < nr; j++) {
+              double common = std::min(rate[j], crate[j]);
+              cum[3*j] = (sum += common);
+              cum[3*j+1] = (sum += rate[j] - common);
+              cum[3*j+2] = (sum += crate[j] - common);
+            }
+            double total = cum[3*nr-1];
+            if (budget < 0) budget = rng.exponential();
+            double newTime = t + budget / total;
+            if (!(newTime < coarse_end)) {
+              budget -= total * (coarse_end - t);
+              t = coarse_end;
+              break;
+            }
+            t = newTime;
+            budget = -1.0;
+            double r2 = total * rng.uniform();
+            int channel = 0;
+            while ((channel < 3*nr-1) && (cum[channel] < r2)) channel++;
+            if (channel % 3 != 2) {
+              fire(x, channel / 3, 1.0);
+              rates_current = false;
+            }
+            if (channel % 3 != 1) fire(xc, channel / 3, 1.0);
+          }
+          continue;
+        }
+
+        // Tau-leap steps: Poisson numbers of firings of the common and separate channels
+        while (t < coarse_end) {
+          const double h = (coarse_end - t > tau) ? tau : coarse_end - t;
+          propensities(&x[0], Ca, rate);
+          for (int j = 0; j < nr; j++) {
+            if (coupling == mlmc_tau_leap) {
+              fire(x, j, rng.poisson(rate[j] * h));
+              continue;
+            }
+            double common = std::min(rate[j], crate[j]);
+            double both = rng.poisson(common * h);
+            fire(x, j, both + rng.poisson((rate[j] - common) * h));
+            fire(xc, j, both + rng.poisson((crate[j] - common) * h));
+          }
+          t = (coarse_end - t > tau) ? t + h : coarse_end;
+        }
+      }
+      record(t);
+    }
+  }
+  // Output times at the end of the simulation
+  record(HUGE_VAL);
+  return work;
+}
+
+#endif
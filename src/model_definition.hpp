@@ -0,0 +1,361 @@
+// Model definition expansion
+// Included by every model file after its MODEL DEFINITION section (and after simulator.cpp, which provides the renaming macros).
+// A model is described once by the macros
+//   MODEL_SPECIES(X)     X(name, default initial concentration [nmol/l]) for every species
+//   MODEL_VOLS(X)        X(name, default volume [l]) for every volume
+//   MODEL_PARAMS(X)      X(name, default value) for every reaction parameter
+//   MODEL_STOICHIOMETRY  the stoichiometric matrix (one row of reaction coefficients per species)
+//   MODEL_INPUTS(X)      (optional) X(name) for every parameter that can also be given as a column of the input data frame
+//   MODEL_FACTORS(X)     (optional) X(name, expression) for terms that only depend on parameters, inputs and calcium
+//                        (computed once per input interval and available as local variables in propensities)
+// and the template function propensities<Real, Param>(params, factors, Ca, x, f, rate), which is defined in the model file right after including this file.
+// From this single description the following functions are generated:
+//   init()                  default parameter lists (for the R wrappers)
+//   resolve_model_params()  merges user supplied values into the defaults
+//   read_model_inputs()     reads the declared input signals from the input data frame
+//   compute_factors()       evaluates the factors for the current input interval
+//   native_simulator()      the stochastic simulator of sim_<model>() on the native engine (see ssa_engine.hpp)
+//   ode_rhs(), ode_jacobian()  right hand side and exact Jacobian (forward mode AD) for the deterministic simulator
+//   ode_sensitivities()     Jacobian and exact derivatives with respect to the parameters (forward sensitivities)
+//   model_kernel            compile time model description for the generic engines (e.g. the SIMD ensemble simulator)
+// and the model is registered under MODEL_NAME for the model independent R functions (see model_registry.hpp).
+#include <vector>
+#include <cstddef>
+#include "dual.hpp"
+#include "ode_solver.hpp"
+#include "sim_params.hpp"
+#include "model_registry.hpp"
+#include "buffer_pool.hpp"
+
+
+// Model specific names for types and templates (identical names in different model files would be merged by the linker)
+#define model_param_set Map(model_param_set_, MODEL_NAME)
+#define model_params Map(model_params_, MODEL_NAME)
+#define propensities Map(propensities_, MODEL_NAME)
+#define model_kernel Map(model_kernel_, MODEL_NAME)
+#define model_factor_set Map(model_factor_set_, MODEL_NAME)
+#define model_factors Map(model_factors_, MODEL_NAME)
+#define Str_helper(x) #x
+#define Str(x) Str_helper(x)
+
+// Helper macros to expand the entries of the model definition
+#define MODEL_COUNT_ENTRY(name, value) + 1
+#define MODEL_ENTRY_VALUE(name, value) value,
+#define MODEL_ENTRY_NAME(name, value) #name,
+#define MODEL_PARAM_MEMBER(name, value) Param name;
+#define MODEL_PARAM_READ(name, value) p.name = v[#name];
+// Used inside propensities(): makes every model parameter available as a local variable of the same name
+#define UNPACK_PARAM(name, value) const auto name = params.name; (void)name;
+#define MODEL_COUNT_INPUT(name) + 1
+#define MODEL_INPUT_NAME(name) #name,
+#define MODEL_INPUT_INDEX(name) (int)(offsetof(model_params, name) / sizeof(double)),
+#define MODEL_FACTOR_MEMBER(name, expression) Param name;
+#define MODEL_FACTOR_EVAL(name, expression) const decltype(factors.name) name = (expression); factors.name = name;
+// Used inside propensities(): makes every factor available as a local variable of the same name
+#define UNPACK_FACTOR(name, expression) const auto name = factors.name; (void)name;
+#define MODEL_ALIAS_NAME(alias, name) #alias,
+#define MODEL_ALIAS_TARGET(alias, name) #name,
+
+// Models without additional input signals
+#ifndef MODEL_INPUTS
+  #define MODEL_INPUTS(X)
+#endif
+// Models without precomputed factors
+#ifndef MODEL_FACTORS
+  #define MODEL_FACTORS(X)
+#endif
+// Models without former parameter names
+#ifndef MODEL_PARAM_ALIASES
+  #define MODEL_PARAM_ALIASES(X)
+#endif
+
+
+// Model dimensions
+static const double stM_table[] = { MODEL_STOICHIOMETRY };
+enum {
+  model_nspecies = 0 MODEL_SPECIES(MODEL_COUNT_ENTRY),
+  model_nvols = 0 MODEL_VOLS(MODEL_COUNT_ENTRY),
+  model_nparams = 0 MODEL_PARAMS(MODEL_COUNT_ENTRY),
+  model_nreactions = sizeof(stM_table) / sizeof(stM_table[0]) / model_nspecies
+};
+static_assert(sizeof(stM_table) / sizeof(stM_table[0]) == model_nspecies * model_nreactions,
+              "MODEL_STOICHIOMETRY needs one coefficient per species and reaction");
+
+// Default values and names (in definition order)
+static const double default_init_conc_values[] = { MODEL_SPECIES(MODEL_ENTRY_VALUE) };
+static const char *species_names[] = { MODEL_SPECIES(MODEL_ENTRY_NAME) };
+static const double default_vol_values[] = { MODEL_VOLS(MODEL_ENTRY_VALUE) };
+static const char *vol_names[] = { MODEL_VOLS(MODEL_ENTRY_NAME) };
+static const double default_param_values[] = { MODEL_PARAMS(MODEL_ENTRY_VALUE) };
+static const char *param_names[] = { MODEL_PARAMS(MODEL_ENTRY_NAME) };
+// Former parameter names still accepted in the user parameters (terminated by a null pointer)
+static const char *param_alias_names[] = { MODEL_PARAM_ALIASES(MODEL_ALIAS_NAME) 0 };
+static const char *param_alias_targets[] = { MODEL_PARAM_ALIASES(MODEL_ALIAS_TARGET) 0 };
+
+// Reaction parameters as plain struct members (no map lookup in the propensity calculation)
+// Param is double for the simulators and a dual number for the parameter sensitivities (see model_kernel::sensitivities).
+template <typename Param>
+struct model_param_set {
+  MODEL_PARAMS(MODEL_PARAM_MEMBER)
+};
+typedef model_param_set<double> model_params;
+static_assert(sizeof(model_params) == model_nparams * sizeof(double),
+              "model_params has to be layout compatible with the parameter array");
+// Parameters as array in definition order (used by the generic engines and the input signals)
+static double *param_array(model_params &p) {
+  return reinterpret_cast<double *>(&p);
+}
+// Parameters of the model specific R functions (set by resolve_model_params)
+static model_params prop_params;
+
+// Factors of the current input interval
+template <typename Param>
+struct model_factor_set {
+  MODEL_FACTORS(MODEL_FACTOR_MEMBER)
+};
+typedef model_factor_set<double> model_factors;
+template <typename Param>
+static void compute_factors(const model_param_set<Param> &params, double Ca, model_factor_set<Param> &factors) {
+  MODEL_PARAMS(UNPACK_PARAM)
+  MODEL_FACTORS(MODEL_FACTOR_EVAL)
+  (void)Ca;
+  (void)factors;
+}
+
+// Input signals (parameters that can be given as columns of the input data frame; the lists end with a sentinel)
+enum { model_ninputs = 0 MODEL_INPUTS(MODEL_COUNT_INPUT) };
+static const char *input_names[] = { MODEL_INPUTS(MODEL_INPUT_NAME) 0 };
+static const int input_param_index[] = { MODEL_INPUTS(MODEL_INPUT_INDEX) -1 };
+
+// Propensities of all reactions in particle numbers per second (not cumulative)
+// Real is double for the simulators, Lanes for the SIMD ensemble simulator and a dual number for the Jacobian;
+// Param is double, or the same dual number as Real for the parameter sensitivities.
+template <typename Real, typename Param>
+void propensities(const model_param_set<Param> &params, const model_factor_set<Param> &factors, double Ca, const Real *x, double f, Real *rate);
+
+
+
+//********************************/* PARAMETER HANDLING */********************************
+
+// Named numeric vector from the default values of the model definition
+static NumericVector named_vector(const double *values, const char **names, int n) {
+  NumericVector v(n);
+  CharacterVector v_names(n);
+  for (int i = 0; i < n; i++) {
+    v[i] = values[i];
+    v_names[i] = names[i];
+  }
+  v.names() = v_names;
+  return v;
+}
+
+// Default model parameters
+List init() {
+  // Combine and return all vectors in a default_params list
+  return List::create(
+    _["vols"] = named_vector(default_vol_values, vol_names, model_nvols),
+    _["init_conc"] = named_vector(default_init_conc_values, species_names, model_nspecies),
+    _["params"] = named_vector(default_param_values, param_names, model_nparams)
+  );
+}
+
+// Replace entries in a default vector with user-supplied values (matched by name; aliases: former names of entries)
+// Unknown names are an error with strict (the deterministic simulators and the model independent functions), otherwise they are
+// reported and ignored (sim_<model>(), as before)
+static void update_defaults(NumericVector defaults, List user_model_params, const char *entry, const char *label, bool strict,
+                            const char **aliases = 0, const char **targets = 0) {
+  if (!user_model_params.containsElementNamed(entry)) {
+    Rcout << "Default " << label << " have been used." << std::endl;
+    return;
+  }
+  NumericVector user_values = user_model_params[entry];
+  CharacterVector user_names = user_values.names();
+  for (int i = 0; i < user_names.length(); i++) {
+    std::string current_name = as<std::string>(user_names[i]);
+    for (int k = 0; aliases && aliases[k]; k++) {
+      if (current_name == aliases[k]) current_name = targets[k];
+    }
+    if (defaults.containsElementNamed((current_name).c_str())) {
+      // update default values
+      defaults[current_name] = user_values[i];
+    } else if (strict) {
+      stop("No such index! Unknown " + std::string(label) + " '" + current_name + "'. Check input parameter vectors.");
+    } else {
+      Rcout << "No such index! Default values have been used. Check input parameter vectors." << std::endl;
+    }
+  }
+}
+
+// Reaction parameter struct from a named parameter vector
+static model_params params_from_vector(NumericVector v) {
+  model_params p;
+  MODEL_PARAMS(MODEL_PARAM_READ)
+  return p;
+}
+
+// Input signals of the model found in the input data frame
+input_signals read_model_inputs(DataFrame user_input_df) {
+  return read_input_signals(user_input_df, input_names, input_param_index, model_ninputs);
+}
+
+// Key of a run in the on-disk result cache (see result_cache.hpp): the configuration including the stored reaction parameters
+bool result_cache_key(const char *engine, DataFrame user_input_df, List user_sim_params,
+                      NumericVector default_vols, NumericVector default_init_conc, cache_key &key) {
+  return simulation_cache_key(engine, Str(MODEL_NAME), user_input_df, user_sim_params, default_vols, default_init_conc,
+                              param_array(prop_params), model_nparams, key);
+}
+
+// Stochastic simulation of sim_<model>() on the native engine (see ssa_engine.hpp)
+// Uses the stored reaction parameters; the input is the data frame with the input signals of the model, or the procedural input of
+// the sim param "stimulus" (see read_sim_input()). The seed is the sim param "seed" or drawn from R's generator (see sim_seed()).
+DataFrame native_simulator(DataFrame user_input_df, List user_sim_params, NumericVector default_vols, NumericVector default_init_conc) {
+  const model_info &info = find_model(Str(MODEL_NAME));
+  sim_problem pb;
+  pb.params.assign(param_array(prop_params), param_array(prop_params) + model_nparams);
+  pb.f = 6.0221415e14*default_vols[0];
+  for (int i = 0; i < model_nspecies; i++) {
+    pb.x0.push_back(floor(default_init_conc[i]*pb.f));
+  }
+  read_sim_input(info, user_input_df, user_sim_params, pb);
+  ssa_state s = ssa_initial_state(pb, sim_seed(user_sim_params), 0);
+  // output buffer reused by consecutive runs (every output time is written before the run ends)
+  double *out = thread_buffers().get(buffer_output, pb.output_times.size()*model_nspecies);
+  while (!s.finished(pb)) {
+    info.ssa_simulator(pb, s, HUGE_VAL, out, ssa_check_events, 0, 0);
+    sim_check_interrupt();
+  }
+  return trajectory_frame(info, pb, out);
+}
+
+// Merge the user supplied model parameters into the defaults and store the reaction parameters
+List resolve_model_params(List user_model_params, bool strict) {
+  List default_model_params = init();
+  NumericVector default_vols = default_model_params["vols"];
+  NumericVector default_init_conc = default_model_params["init_conc"];
+  NumericVector default_params = default_model_params["params"];
+  update_defaults(default_vols, user_model_params, "vols", "volume(s)", strict);
+  update_defaults(default_init_conc, user_model_params, "init_conc", "initial condition(s)", strict);
+  update_defaults(default_params, user_model_params, "params", "reaction parameter(s)", strict, param_alias_names, param_alias_targets);
+  prop_params = params_from_vector(default_params);
+  return default_model_params;
+}
+
+// Parameters of the model independent functions (see model_registry.hpp): unknown names are an error
+static List resolve_registered_params(List user_model_params) {
+  return resolve_model_params(user_model_params, true);
+}
+
+
+
+//********************************/* DETERMINISTIC KERNEL */********************************
+// The deterministic model works on concentrations c = x/f (nmol/l); its reaction rates are the propensities divided by f.
+
+// Right hand side dc/dt = S * rate(c*f) / f
+static void ode_rhs(const model_params &p, const model_factors &fac, double Ca, double f, const double *c, double *dc) {
+  double xc[model_nspecies];
+  double rate[model_nreactions];
+  for (int i = 0; i < model_nspecies; i++) xc[i] = c[i] * f;
+  propensities<double>(p, fac, Ca, xc, f, rate);
+  for (int i = 0; i < model_nspecies; i++) {
+    double sum = 0.0;
+    for (int j = 0; j < model_nreactions; j++) sum += stM_table[i*model_nreactions+j] * rate[j];
+    dc[i] = sum / f;
+  }
+}
+
+// Jacobian J[i*n+k] = d(dc_i/dt)/dc_k = sum_j S_ij d rate_j / d x_k (the factors f cancel)
+static void ode_jacobian(const model_params &p, const model_factors &fac, double Ca, double f, const double *c, double *J) {
+  typedef Dual<model_nspecies> D;
+  D xc[model_nspecies];
+  D rate[model_nreactions];
+  for (int k = 0; k < model_nspecies; k++) xc[k] = D::variable(c[k] * f, k);
+  propensities<D>(p, fac, Ca, xc, f, rate);
+  for (int i = 0; i < model_nspecies; i++) {
+    for (int k = 0; k < model_nspecies; k++) {
+      double sum = 0.0;
+      for (int j = 0; j < model_nreactions; j++) sum += stM_table[i*model_nreactions+j] * rate[j].d[k];
+      J[i*model_nspecies+k] = sum;
+    }
+  }
+}
+
+// Right hand side, Jacobian and parameter Jacobian Jp[i*nparams+m] = d(dc_i/dt)/d param_m in one forward mode AD pass
+// (species and parameters are the independent variables; the factors are recomputed from the dual parameters).
+static void ode_sensitivities(const model_params &p, double Ca, double f, const double *c, double *dc, double *J, double *Jp) {
+  typedef Dual<model_nspecies + model_nparams> D;
+  static_assert(sizeof(model_param_set<D>) == model_nparams * sizeof(D), "model_param_set has to be layout compatible with an array");
+  model_param_set<D> pd;
+  D *pd_array = reinterpret_cast<D *>(&pd);
+  const double *p_array = reinterpret_cast<const double *>(&p);
+  for (int m = 0; m < model_nparams; m++) pd_array[m] = D::variable(p_array[m], model_nspecies + m);
+  model_factor_set<D> fac;
+  compute_factors(pd, Ca, fac);
+  D xc[model_nspecies];
+  D rate[model_nreactions];
+  for (int k = 0; k < model_nspecies; k++) xc[k] = D::variable(c[k] * f, k);
+  propensities<D>(pd, fac, Ca, xc, f, rate);
+  for (int i = 0; i < model_nspecies; i++) {
+    D sum(0.0);
+    for (int j = 0; j < model_nreactions; j++) {
+      if (stM_table[i*model_nreactions+j] != 0) sum += stM_table[i*model_nreactions+j] * rate[j];
+    }
+    dc[i] = sum.v / f;
+    for (int k = 0; k < model_nspecies; k++) J[i*model_nspecies+k] = sum.d[k];
+    for (int m = 0; m < model_nparams; m++) Jp[i*model_nparams+m] = sum.d[model_nspecies+m] / f;
+  }
+}
+
+
+//********************************/* MODEL REGISTRATION */********************************
+
+// Compile time model description for the generic simulation engines (parameters as array in definition order)
+struct model_kernel {
+  enum { nspecies = model_nspecies, nreactions = model_nreactions, nparams = model_nparams };
+  typedef model_factors factors_type;
+  static void prepare(const double *params, double Ca, model_factors &factors) {
+    compute_factors(*reinterpret_cast<const model_params *>(params), Ca, factors);
+  }
+  template <typename Real>
+  static void rates(const double *params, const model_factors &factors, double Ca, const Real *x, double f, Real *rate) {
+    propensities<Real>(*reinterpret_cast<const model_params *>(params), factors, Ca, x, f, rate);
+  }
+  static const double *stoichiometry() { return stM_table; }
+  // Reaction rate equations (concentrations, see ode_rhs/ode_jacobian)
+  static void derivatives(const double *params, const model_factors &factors, double Ca, double f, const double *c, double *dc) {
+    ode_rhs(*reinterpret_cast<const model_params *>(params), factors, Ca, f, c, dc);
+  }
+  static void jacobian(const double *params, const model_factors &factors, double Ca, double f, const double *c, double *J) {
+    ode_jacobian(*reinterpret_cast<const model_params *>(params), factors, Ca, f, c, J);
+  }
+  static void sensitivities(const double *params, double Ca, double f, const double *c, double *dc, double *J, double *Jp) {
+    ode_sensitivities(*reinterpret_cast<const model_params *>(params), Ca, f, c, dc, J, Jp);
+  }
+};
+
+static model_info model_description() {
+  model_info info;
+  info.name = Str(MODEL_NAME);
+  info.nspecies = model_nspecies;
+  info.nreactions = model_nreactions;
+  info.species_names.assign(species_names, species_names + model_nspecies);
+  info.stoichiometry = model_kernel::stoichiometry();
+  info.input_names.assign(input_names, input_names + model_ninputs);
+  info.input_param_index.assign(input_param_index, input_param_index + model_ninputs);
+  for (int k = 0; param_alias_names[k]; k++) {
+    info.param_aliases.push_back(std::make_pair(std::string(param_alias_names[k]), std::string(param_alias_targets[k])));
+  }
+  info.default_params = &init;
+  info.resolve_params = &resolve_registered_params;
+  info.read_inputs = &read_model_inputs;
+  info.ensemble_simulator = &ensemble_simulator<model_kernel>;
+  info.ssa_simulator = &ssa_simulator<model_kernel>;
+  info.ode_simulator = &ode_simulator<model_kernel>;
+  info.ode_sensitivity_simulator = &ode_sensitivity_simulator<model_kernel>;
+  info.coupled_simulator = &ssa_coupled_simulator<model_kernel>;
+  info.mlmc_simulator = &mlmc_simulator<model_kernel>;
+  info.equilibrate = &equilibrate<model_kernel>;
+  return info;
+}
+static const bool model_registered = register_model(model_description());
+
+#include "det_simulator.hpp"
@@ -0,0 +1,216 @@
+#include <map>
+#include <algorithm>
+#include "model_registry.hpp"
+#include "sim_params.hpp"
+#include "result_columns.hpp"
+using namespace Rcpp;
+
+
+// Registered models by name (function local, so it exists before the model files register themselves during library loading)
+static std::map<std::string, model_info> &registry() {
+  static std::map<std::string, model_info> models;
+  return models;
+}
+
+bool register_model(const model_info &info) {
+  registry()[info.name] = info;
+  return true;
+}
+
+const model_info &find_model(const std::string &name) {
+  std::map<std::string, model_info>::const_iterator it = registry().find(name);
+  if (it == registry().end()) {
+    std::string known;
+    for (it = registry().begin(); it != registry().end(); ++it) {
+      known += (known.empty() ? "" : ", ") + it->first;
+    }
+    stop("Unknown model '" + name + "'. Available models: " + known);
+  }
+  return it->second;
+}
+
+// Current name of a reaction parameter given by a former name (see MODEL_PARAM_ALIASES)
+static const std::string &current_param_name(const model_info &info, const std::string &name) {
+  for (size_t k = 0; k < info.param_aliases.size(); k++) {
+    if (info.param_aliases[k].first == name) return info.param_aliases[k].second;
+  }
+  return name;
+}
+
+int find_param(const model_info &info, const std::string &name) {
+  NumericVector default_params = info.default_params()["params"];
+  CharacterVector param_names = default_params.names();
+  for (int i = 0; i < param_names.length(); i++) {
+    if (as<std::string>(param_names[i]) == current_param_name(info, name)) return i;
+  }
+  stop("Unknown reaction parameter '" + name + "'.");
+  return -1;
+}
+
+int find_variable(const model_info &info, const std::string &name) {
+  NumericVector default_params = info.default_params()["params"];
+  CharacterVector param_names = default_params.names();
+  for (int i = 0; i < param_names.length(); i++) {
+    if (as<std::string>(param_names[i]) == current_param_name(info, name)) return i;
+  }
+  for (int i = 0; i < info.nspecies; i++) {
+    if (info.species_names[i] == name) return param_names.length() + i;
+  }
+  stop("Unknown reaction parameter or species '" + name + "'.");
+  return -1;
+}
+
+void read_model_problem(const model_info &info, List model_params_list, sim_problem &pb) {
+  NumericVector default_vols = model_params_list["vols"];
+  NumericVector default_init_conc = model_params_list["init_conc"];
+  NumericVector default_params = model_params_list["params"];
+  pb.params.assign(default_params.begin(), default_params.end());
+  // Conversion from concentration (nmol/l) to particle numbers
+  pb.f = 6.0221415e14*default_vols[0];
+  pb.x0.clear();
+  for (int i = 0; i < info.nspecies; i++) {
+    pb.x0.push_back(floor(default_init_conc[i]*pb.f));
+  }
+  pb.c0.assign(default_init_conc.begin(), default_init_conc.end());
+}
+
+void read_sim_input(const model_info &info, DataFrame input_df, List input_sim_params, sim_problem &pb) {
+  pb.generator = sim_stimulus_param(input_sim_params);
+  if (pb.generator.active()) {
+    // procedural input evaluated by the engines (the input data frame is not used)
+    pb.input_time.clear();
+    pb.input_ca.clear();
+    pb.output_times = sim_output_times(input_sim_params, pb.generator.start);
+    pb.generator.prepare(pb.end_time());
+    pb.inputs = input_signals();
+  } else {
+    NumericVector input_ca = input_df["Ca"];
+    NumericVector input_time = input_df["time"];
+    pb.input_time.assign(input_time.begin(), input_time.end());
+    pb.input_ca.assign(input_ca.begin(), input_ca.end());
+    pb.output_times = sim_output_times(input_sim_params, input_time[0]);
+    pb.inputs = info.read_inputs(input_df);
+  }
+  // Start from equilibrated states at the baseline calcium
+  pb.x0_pool.clear();
+  if (input_sim_params.containsElementNamed("baselineCa")) {
+    pb.x0_pool = equilibrated_states(info, pb, read_warm_start_options(input_sim_params));
+  }
+}
+
+sim_problem read_sim_problem(const model_info &info, DataFrame input_df, List input_sim_params, List input_model_params) {
+  // Replace entries in the default model parameters with user-supplied values if necessary
+  sim_problem pb;
+  read_model_problem(info, info.resolve_params(input_model_params), pb);
+  read_sim_input(info, input_df, input_sim_params, pb);
+  return pb;
+}
+
+DataFrame trajectory_frame(const model_info &info, const sim_problem &pb, std::vector<double> &out) {
+  // cols. = time + ca + species; the species are views of the output buffer (see result_columns.hpp)
+  int noutput = pb.output_times.size();
+  NumericVector time(pb.output_times.begin(), pb.output_times.end());
+  NumericVector ca(noutput);
+  CharacterVector col_names(info.nspecies+2);
+  col_names[0] = "time";
+  col_names[1] = "Ca";
+  for (int o = 0, k = 0; o < noutput; o++) {
+    // calcium input interval of the output time
+    while ((k+1 < pb.ninput()) && (pb.input_time_at(k+1) <= pb.output_times[o])) k++;
+    ca[o] = pb.input_ca_at(k);
+  }
+  std::vector<double> *species = new std::vector<double>();
+  species->swap(out);
+  std::shared_ptr<const std::vector<double> > values(species);
+  List columns(info.nspecies+2);
+  columns[0] = time;
+  columns[1] = ca;
+  for (int i = 0; i < info.nspecies; i++) {
+    col_names[i+2] = info.species_names[i];
+    columns[i+2] = result_column(result_view(values, noutput, i, info.nspecies));
+  }
+  return result_frame(columns, col_names, noutput);
+}
+
+DataFrame trajectory_frame(const model_info &info, const sim_problem &pb, const double *out) {
+  std::vector<double> values(out, out + pb.output_times.size()*info.nspecies);
+  return trajectory_frame(info, pb, values);
+}
+
+stop_conditions read_stop_conditions(const model_info &info, const sim_problem &pb, List conditions) {
+  if (conditions.containsElementNamed("threshold")) {
+    conditions = List::create(conditions);
+  }
+  stop_conditions result;
+  for (int c = 0; c < conditions.length(); c++) {
+    List condition = conditions[c];
+    if (!condition.containsElementNamed("species") || !condition.containsElementNamed("threshold")) {
+      stop("Every stopping condition needs \"species\" and \"threshold\".");
+    }
+    std::vector<double> weights(info.nspecies, 0.0);
+    SEXP species = condition["species"];
+    const bool by_name = is<CharacterVector>(species);
+    NumericVector values = by_name ? NumericVector(Rf_length(species), 1.0) : NumericVector(species);
+    CharacterVector names = by_name ? CharacterVector(species) : CharacterVector(values.names());
+    if (names.length() != values.length()) {
+      stop("The species of a stopping condition have to be species names or a named vector of weights.");
+    }
+    for (int k = 0; k < names.length(); k++) {
+      const std::string name = as<std::string>(names[k]);
+      int i = std::find(info.species_names.begin(), info.species_names.end(), name) - info.species_names.begin();
+      if (i == info.nspecies) {
+        stop("Unknown species '" + name + "' in a stopping condition.");
+      }
+      weights[i] += values[k];
+    }
+    std::string direction = condition.containsElementNamed("direction") ? as<std::string>(condition["direction"]) : "above";
+    if ((direction != "above") && (direction != "below")) {
+      stop("The direction of a stopping condition has to be \"above\" or \"below\".");
+    }
+    result.add(weights, as<double>(condition["threshold"]) * pb.f, direction == "above");
+  }
+  if (result.size() == 0) {
+    stop("No stopping conditions.");
+  }
+  return result;
+}
+
+DataFrame ensemble_frame(const model_info &info, const ensemble_config &cfg, std::vector<double> &out) {
+  // one row per replicate and output time; cols. = replicate + time + ca + species
+  // all columns are views (see result_columns.hpp): replicate numbers and the output times and calcium repeated for every replicate
+  // are computed on access, the species are views of the output buffer
+  int noutput = cfg.output_times.size();
+  R_xlen_t nrow = (R_xlen_t)cfg.nreplicates*noutput;
+  std::shared_ptr<std::vector<double> > replicates(new std::vector<double>(cfg.nreplicates));
+  std::shared_ptr<std::vector<double> > times(new std::vector<double>(cfg.output_times));
+  std::shared_ptr<std::vector<double> > ca(new std::vector<double>(noutput));
+  for (int r = 0; r < cfg.nreplicates; r++) {
+    (*replicates)[r] = r+1;
+  }
+  for (int o = 0, k = 0; o < noutput; o++) {
+    // calcium input interval of the output time
+    while ((k+1 < cfg.ninput()) && (cfg.input_time_at(k+1) <= cfg.output_times[o])) k++;
+    (*ca)[o] = cfg.input_ca_at(k);
+  }
+  std::vector<double> *species = new std::vector<double>();
+  species->swap(out);
+  std::shared_ptr<const std::vector<double> > values(species);
+  CharacterVector col_names(info.nspecies+3);
+  List columns(info.nspecies+3);
+  col_names[0] = "replicate";
+  col_names[1] = "time";
+  col_names[2] = "Ca";
+  columns[0] = result_column(result_view(replicates, nrow, 0, 1, std::max(noutput, 1)));
+  columns[1] = result_column(result_view(times, nrow, 0, 1, 1, noutput));
+  columns[2] = result_column(result_view(ca, nrow, 0, 1, 1, noutput));
+  for (int i = 0; i < info.nspecies; i++) {
+    col_names[i+3] = info.species_names[i];
+    columns[i+3] = result_column(result_view(values, nrow, i, info.nspecies));
+  }
+  return result_frame(columns, col_names, nrow);
+}
+
+DataFrame ensemble_frame(const model_info &info, const ensemble_config &cfg, const double *out) {
+  std::vector<double> values(out, out + (size_t)cfg.nreplicates*cfg.output_times.size()*info.nspecies);
+  return ensemble_frame(info, cfg, values);
+}
@@ -0,0 +1,80 @@
+#ifndef MODEL_REGISTRY_HPP
+#define MODEL_REGISTRY_HPP
+
+#include <Rcpp.h>
+#include <string>
+#include <vector>
+#include <utility>
+#include "ensemble_simulator.hpp"
+#include "ssa_engine.hpp"
+#include "warm_start.hpp"
+#include "ode_engine.hpp"
+#include "coupled_engine.hpp"
+#include "mlmc_engine.hpp"
+
+
+// Model registry
+// Every model file registers the functions generated from its model definition under its MODEL_NAME (see model_definition.hpp).
+// Model independent R functions (e.g. sim_ensemble) look the model up by name instead of needing one wrapper per model.
+struct model_info {
+  std::string name;
+  int nspecies;
+  int nreactions;
+  std::vector<std::string> species_names;
+  const double *stoichiometry;   // species x reactions, row-major
+  std::vector<std::string> input_names;   // declared input signals (MODEL_INPUTS) and their position in the parameter array
+  std::vector<int> input_param_index;
+  std::vector<std::pair<std::string, std::string> > param_aliases;   // former parameter names and the current ones
+  // Default parameters (list with "vols", "init_conc" and "params" in definition order)
+  Rcpp::List (*default_params)();
+  // Merges user supplied values into the default parameters (unknown names are an error)
+  Rcpp::List (*resolve_params)(Rcpp::List user_model_params);
+  // Reads the declared input signals (e.g. Vm) from the input data frame
+  input_signals (*read_inputs)(Rcpp::DataFrame user_input_df);
+  // Simulation engines instantiated for the model
+  void (*ensemble_simulator)(const ensemble_config &cfg, std::vector<double> &out);
+  void (*ssa_simulator)(const sim_problem &pb, ssa_state &s, double until, double *out, uint64_t max_events,
+                        const stop_conditions *stop, event_log *events);
+  void (*ode_simulator)(const sim_problem &pb, double rtol, double atol, double *out, void (*check_interrupt)());
+  void (*ode_sensitivity_simulator)(const sim_problem &pb, const std::vector<int> &variables, double rtol, double atol,
+                                    double *out, double *sens, void (*check_interrupt)());
+  void (*coupled_simulator)(const sim_problem &pb, const double *perturbed_params, ssa_state &s, std::vector<double> &xp,
+                            double *out, double *out_perturbed);
+  double (*mlmc_simulator)(const sim_problem &pb, mlmc_coupling coupling, double tau, int refinement, Rng &rng,
+                           double *out_fine, double *out_coarse);
+  void (*equilibrate)(const sim_problem &pb, const warm_start_options &opt, uint64_t seed, std::vector<double> &states);
+};
+
+bool register_model(const model_info &info);
+const model_info &find_model(const std::string &name);
+// Position of a reaction parameter in the parameter array of the model (definition order)
+int find_param(const model_info &info, const std::string &name);
+// Variable of the deterministic sensitivities: a reaction parameter (its position), or the initial concentration of a species
+// (number of parameters + species index; reaction parameters take precedence)
+int find_variable(const model_info &info, const std::string &name);
+
+// Simulation problem of a model from the arguments of the R functions (input data frame, sim and model parameters)
+// read_model_problem: parameters, initial particle numbers and volume factor from the resolved model parameters (see resolve_params)
+// read_sim_input: input time series, input signals, output times and warm start from the input data frame and sim parameters
+void read_model_problem(const model_info &info, Rcpp::List model_params_list, sim_problem &pb);
+void read_sim_input(const model_info &info, Rcpp::DataFrame input_df, Rcpp::List input_sim_params, sim_problem &pb);
+sim_problem read_sim_problem(const model_info &info, Rcpp::DataFrame input_df, Rcpp::List input_sim_params, Rcpp::List input_model_params);
+// Data frame with time, calcium and species concentrations at the output times (out[output*nspecies + species]); the species columns
+// are views of the output buffer, which the frame takes over (out is left empty)
+Rcpp::DataFrame trajectory_frame(const model_info &info, const sim_problem &pb, std::vector<double> &out);
+// The same for a buffer the caller keeps (thread buffers, outputs of running jobs): the frame holds a copy
+Rcpp::DataFrame trajectory_frame(const model_info &info, const sim_problem &pb, const double *out);
+// Warm start options from the sim parameters ("baselineCa", "equilibration", "burnIn", "equilibrationSamples")
+warm_start_options read_warm_start_options(Rcpp::List sim_params);
+// Equilibrated initial states of the problem (computed once per model, parameters, volume and baseline, see warm_start.cpp)
+std::vector<double> equilibrated_states(const model_info &info, const sim_problem &pb, const warm_start_options &opt);
+// Stopping conditions of the stochastic engine from a list of conditions (or a single condition), each a list with "species" (a species
+// name, a character vector of species with weight 1 or a named numeric vector of weights), "threshold" [nmol/l] and "direction"
+// ("above", default, or "below"); the thresholds are converted to particle numbers with the volume factor of the problem
+stop_conditions read_stop_conditions(const model_info &info, const sim_problem &pb, Rcpp::List conditions);
+// Data frame with replicate, time, calcium and species concentrations (out[(replicate*noutput + output)*nspecies + species]); takes
+// over the output buffer like trajectory_frame()
+Rcpp::DataFrame ensemble_frame(const model_info &info, const ensemble_config &cfg, std::vector<double> &out);
+Rcpp::DataFrame ensemble_frame(const model_info &info, const ensemble_config &cfg, const double *out);
+
+#endif
@@ -0,0 +1,125 @@
+#ifndef ODE_ENGINE_HPP
+#define ODE_ENGINE_HPP
+
+#include <vector>
+#include <algorithm>
+#include "ode_solver.hpp"
+#include "sim_problem.hpp"
+
+
+// Integration loop of the deterministic engines over the input intervals and output times
+// rhs and jac work on the current parameters, factors and calcium (params, factors and Ca, updated here at every input
+// time point); record(o) is called when y has reached output time o. check_interrupt (may be null) is called once per input interval.
+template <class Kernel, typename Rhs, typename Jac, typename Record>
+void ode_integrate(const sim_problem &pb, RosenbrockSolver &solver, Rhs &rhs, Jac &jac, double *y, std::vector<double> &params,
+                   typename Kernel::factors_type &factors, double &Ca, Record record, void (*check_interrupt)()) {
+  const int ninput = pb.ninput();
+  const int noutput = pb.output_times.size();
+  int ntimepoint = 0;
+  Ca = pb.input_ca_at(0);
+  pb.inputs.apply(&params[0], 0);
+  Kernel::prepare(&params[0], Ca, factors);
+
+  /* SIMULATION LOOP */
+  double currentTime = pb.input_time_at(0);
+  for (int o = 0; o < noutput; o++) {
+    double outputTime = pb.output_times[o];
+    // Integrate over all input intervals that end before the next output time (calcium is constant on each)
+    while ((ntimepoint+1 < ninput) && (pb.input_time_at(ntimepoint+1) <= outputTime)) {
+      if (check_interrupt) check_interrupt();
+      solver.integrate(rhs, jac, y, currentTime, pb.input_time_at(ntimepoint+1));
+      currentTime = pb.input_time_at(ntimepoint+1);
+      ntimepoint++;
+      Ca = pb.input_ca_at(ntimepoint);
+      pb.inputs.apply(&params[0], ntimepoint);
+      Kernel::prepare(&params[0], Ca, factors);
+    }
+    if (outputTime > currentTime) {
+      solver.integrate(rhs, jac, y, currentTime, outputTime);
+      currentTime = outputTime;
+    }
+    // Update output
+    record(o);
+  }
+}
+
+// Deterministic simulator on a simulation problem (reaction rate equations, native stiff ODE solver)
+// Kernel is the compile time model description generated by model_definition.hpp (see ensemble_simulator.hpp), here with
+// derivatives(params, factors, Ca, f, c, dc) and jacobian(params, factors, Ca, f, c, J) of the reaction rate equations.
+// Starts from the initial concentrations pb.c0 and integrates one input interval at a time (calcium and the input signals are
+// piecewise constant); writes the concentrations at the output times to out[output*nspecies + species].
+// check_interrupt (may be null) is called once per input interval.
+template <class Kernel>
+void ode_simulator(const sim_problem &pb, double rtol, double atol, double *out, void (*check_interrupt)()) {
+  const int ns = Kernel::nspecies;
+  std::vector<double> params(pb.params);
+  std::vector<double> y(pb.c0);
+  typename Kernel::factors_type factors;
+  double Ca;
+  auto rhs = [&](const double *c, double *dc) { Kernel::derivatives(&params[0], factors, Ca, pb.f, c, dc); };
+  auto jac = [&](const double *c, double *J) { Kernel::jacobian(&params[0], factors, Ca, pb.f, c, J); };
+  auto record = [&](int o) {
+    for (int i = 0; i < ns; i++) {
+      out[(size_t)o*ns + i] = y[i];
+    }
+  };
+  RosenbrockSolver solver(ns, rtol, atol);
+  ode_integrate<Kernel>(pb, solver, rhs, jac, &y[0], params, factors, Ca, record, check_interrupt);
+}
+
+// Deterministic simulator with forward sensitivities
+// Integrates the reaction rate equations together with the sensitivities s_v = dc/dv of the variables v (ds_v/dt = J s_v + d rhs/dv)
+// with the exact Jacobian J and parameter derivatives d rhs/dp of the kernel (sensitivities(), forward mode AD), so one solve gives
+// the derivatives with respect to all variables instead of one finite difference solve per variable.
+// variables: v < nparams is reaction parameter v, v >= nparams the initial concentration of species v - nparams
+// (parameters given as input signals are overwritten on every input interval and have no sensitivity).
+// Writes the concentrations to out[output*nspecies + species] (as ode_simulator) and the sensitivities to
+// sens[(output*nvariables + variable)*nspecies + species].
+template <class Kernel>
+void ode_sensitivity_simulator(const sim_problem &pb, const std::vector<int> &variables, double rtol, double atol,
+                               double *out, double *sens, void (*check_interrupt)()) {
+  const int ns = Kernel::nspecies;
+  const int np = Kernel::nparams;
+  const int nvar = variables.size();
+  std::vector<double> params(pb.params);
+  std::vector<double> y((size_t)(1+nvar)*ns, 0.0);
+  std::copy(pb.c0.begin(), pb.c0.end(), y.begin());
+  std::vector<int> param_column(nvar, -1);
+  for (int v = 0; v < nvar; v++) {
+    if (variables[v] >= np) {
+      y[(size_t)(1+v)*ns + variables[v] - np] = 1.0;
+    } else if (std::find(pb.inputs.param_index.begin(), pb.inputs.param_index.end(), variables[v]) == pb.inputs.param_index.end()) {
+      param_column[v] = variables[v];
+    }
+  }
+  typename Kernel::factors_type factors;
+  double Ca;
+  std::vector<double> Jc(ns*ns), Jp(ns*np);
+  auto rhs = [&](const double *yy, double *dy) {
+    Kernel::sensitivities(&params[0], Ca, pb.f, yy, dy, &Jc[0], &Jp[0]);
+    for (int v = 0; v < nvar; v++) {
+      const double *s = yy + (size_t)(1+v)*ns;
+      double *ds = dy + (size_t)(1+v)*ns;
+      for (int i = 0; i < ns; i++) {
+        double sum = (param_column[v] >= 0) ? Jp[i*np + param_column[v]] : 0.0;
+        for (int k = 0; k < ns; k++) sum += Jc[i*ns+k] * s[k];
+        ds[i] = sum;
+      }
+    }
+  };
+  auto jac = [&](const double *c, double *J) { Kernel::jacobian(&params[0], factors, Ca, pb.f, c, J); };
+  auto record = [&](int o) {
+    for (int i = 0; i < ns; i++) {
+      out[(size_t)o*ns + i] = y[i];
+    }
+    for (int v = 0; v < nvar; v++) {
+      for (int i = 0; i < ns; i++) {
+        sens[((size_t)o*nvar + v)*ns + i] = y[(size_t)(1+v)*ns + i];
+      }
+    }
+  };
+  RosenbrockSolver solver(ns, rtol, atol, 1+nvar);
+  ode_integrate<Kernel>(pb, solver, rhs, jac, &y[0], params, factors, Ca, record, check_interrupt);
+}
+
+#endif
@@ -0,0 +1,179 @@
+#ifndef ODE_SOLVER_HPP
+#define ODE_SOLVER_HPP
+
+#include <cmath>
+#include <cfloat>
+#include <cstdio>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+
+// Stiff ODE solver (linearly implicit Rosenbrock method, the modified ROS2 scheme of Shampine & Reichelt 1997 used by MATLAB's ode23s)
+// The calcium input is piecewise constant, so the deterministic simulators integrate one input interval at a time
+// and each call to integrate() solves an autonomous system dy/dt = rhs(y) from t0 to t1.
+// rhs(y, dy) evaluates the right hand side, jac(y, J) the Jacobian (row-major, J[i*n+k] = d rhs_i / d y_k).
+// With nblocks > 1 the system has nblocks*n components and jac only gives the n x n Jacobian of the first block, which is used
+// for every block (forward sensitivities: the sensitivity equations of each parameter have the Jacobian of the model). The formula
+// is a W-method (Wolfbrandt), so it keeps its order with this approximate Jacobian, and one LU factorisation serves all blocks.
+// Like lsoda, integrate() gives up with an error (std::runtime_error, safe on worker threads) when the step size falls below the
+// resolution of t (e.g. non-finite derivatives) or an interval needs more than max_steps steps.
+class RosenbrockSolver {
+public:
+  RosenbrockSolver(int n, double rtol, double atol, int nblocks = 1, long max_steps = 100000)
+    : n(n), nblocks(nblocks), rtol(rtol), atol(atol), max_steps(max_steps), h(0.0), nsteps(0), J(n*n), W(n*n), piv(n),
+      F0(n*nblocks), F1(n*nblocks), F2(n*nblocks), k1(n*nblocks), k2(n*nblocks), k3(n*nblocks), ytmp(n*nblocks), ynew(n*nblocks) {}
+
+  template <typename Rhs, typename Jac>
+  void integrate(Rhs &rhs, Jac &jac, double *y, double t0, double t1) {
+    const double d = 1.0 / (2.0 + std::sqrt(2.0));
+    const double e32 = 6.0 + std::sqrt(2.0);
+    const int size = n * nblocks;
+    double t = t0;
+    double span = t1 - t0;
+    if (span <= 0) return;
+    // start with a conservative step if none is known yet (steps are clipped to the interval end below)
+    if (h <= 0) h = 1e-3 * span;
+    long attempts = 0;
+    while (t < t1) {
+      bool last = false;
+      double hstep = h;
+      if (t + hstep >= t1) {
+        hstep = t1 - t;
+        last = true;
+      }
+      rhs(y, &F0[0]);
+      jac(y, &J[0]);
+      for (;;) {
+        if (++attempts > max_steps) {
+          char message[160];
+          snprintf(message, sizeof(message), "more than %ld steps between t = %g and t = %g (too stiff for the tolerances?)",
+                   max_steps, t0, t1);
+          fail(message);
+        }
+        // W = I - h*d*J (LU factorised in place)
+        for (int i = 0; i < n*n; i++) W[i] = -hstep * d * J[i];
+        for (int i = 0; i < n; i++) W[i*n+i] += 1.0;
+        if (!lu_decompose()) {
+          hstep *= 0.25;
+          last = false;
+          check_step(hstep, t);
+          continue;
+        }
+        // k1 = W^-1 F0
+        for (int i = 0; i < size; i++) k1[i] = F0[i];
+        lu_solve(&k1[0]);
+        // k2 = W^-1 (F1 - k1) + k1
+        for (int i = 0; i < size; i++) ytmp[i] = y[i] + 0.5 * hstep * k1[i];
+        rhs(&ytmp[0], &F1[0]);
+        for (int i = 0; i < size; i++) k2[i] = F1[i] - k1[i];
+        lu_solve(&k2[0]);
+        for (int i = 0; i < size; i++) {
+          k2[i] += k1[i];
+          ynew[i] = y[i] + hstep * k2[i];
+        }
+        // k3 = W^-1 (F2 - e32 (k2 - F1) - 2 (k1 - F0)) (only needed for the error estimate)
+        rhs(&ynew[0], &F2[0]);
+        for (int i = 0; i < size; i++) k3[i] = F2[i] - e32 * (k2[i] - F1[i]) - 2.0 * (k1[i] - F0[i]);
+        lu_solve(&k3[0]);
+        // error estimate (weighted max norm)
+        double err = 0.0;
+        for (int i = 0; i < size; i++) {
+          double sc = atol + rtol * std::max(std::fabs(y[i]), std::fabs(ynew[i]));
+          double e = std::fabs(hstep / 6.0 * (k1[i] - 2.0 * k2[i] + k3[i])) / sc;
+          if (e > err || e != e) err = e;
+        }
+        if (err <= 1.0) {
+          double fac = (err > 0) ? 0.8 * std::pow(err, -1.0/3.0) : 5.0;
+          fac = std::min(5.0, std::max(0.2, fac));
+          for (int i = 0; i < size; i++) y[i] = ynew[i];
+          t = last ? t1 : t + hstep;
+          nsteps++;
+          // keep the proposed step for the next interval unless the step was only shortened to hit t1
+          if (!last || hstep * fac > h) h = hstep * fac;
+          break;
+        }
+        // rejected step: shrink and retry
+        double fac = (err == err) ? std::max(0.1, 0.8 * std::pow(err, -1.0/3.0)) : 0.1;
+        hstep *= fac;
+        last = false;
+        h = hstep;
+        check_step(hstep, t);
+      }
+    }
+  }
+
+  // Number of accepted steps so far
+  long steps() const { return nsteps; }
+
+private:
+  int n;
+  int nblocks;
+  double rtol;
+  double atol;
+  long max_steps;
+  double h;
+  long nsteps;
+  std::vector<double> J, W;
+  std::vector<int> piv;
+  std::vector<double> F0, F1, F2, k1, k2, k3, ytmp, ynew;
+
+  // Rejected steps must stay above the resolution of t (NaN derivatives shrink the step forever)
+  void check_step(double hstep, double t) const {
+    if (!(hstep > 16.0 * DBL_EPSILON * std::max(1.0, std::fabs(t)))) {
+      char message[160];
+      snprintf(message, sizeof(message), "step size %g too small at t = %g (non-finite derivatives?)", hstep, t);
+      fail(message);
+    }
+  }
+  static void fail(const char *message) {
+    throw std::runtime_error(std::string("ODE solver: ") + message);
+  }
+
+  // LU decomposition with partial pivoting of W (in place)
+  bool lu_decompose() {
+    for (int c = 0; c < n; c++) {
+      int p = c;
+      double max = std::fabs(W[c*n+c]);
+      for (int r = c+1; r < n; r++) {
+        if (std::fabs(W[r*n+c]) > max) {
+          max = std::fabs(W[r*n+c]);
+          p = r;
+        }
+      }
+      if (max == 0.0 || max != max) return false;
+      piv[c] = p;
+      if (p != c) {
+        for (int k = 0; k < n; k++) std::swap(W[c*n+k], W[p*n+k]);
+      }
+      for (int r = c+1; r < n; r++) {
+        double l = W[r*n+c] / W[c*n+c];
+        W[r*n+c] = l;
+        for (int k = c+1; k < n; k++) W[r*n+k] -= l * W[c*n+k];
+      }
+    }
+    return true;
+  }
+
+  // Solve W z = b for every block of b (b is overwritten by z)
+  void lu_solve(double *b) {
+    for (int block = 0; block < nblocks; block++) {
+      lu_solve_block(b + block*n);
+    }
+  }
+  void lu_solve_block(double *b) {
+    for (int c = 0; c < n; c++) {
+      if (piv[c] != c) std::swap(b[c], b[piv[c]]);
+    }
+    for (int r = 1; r < n; r++) {
+      for (int k = 0; k < r; k++) b[r] -= W[r*n+k] * b[k];
+    }
+    for (int r = n-1; r >= 0; r--) {
+      for (int k = r+1; k < n; k++) b[r] -= W[r*n+k] * b[k];
+      b[r] /= W[r*n+r];
+    }
+  }
+};
+
+#endif
@@ -0,0 +1,88 @@
+#ifndef PARALLEL_HPP
+#define PARALLEL_HPP
+
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <mutex>
+#include <condition_variable>
+
+
+// Number of worker threads (requested > 0, otherwise the number of hardware threads)
+inline int worker_threads(int requested) {
+  if (requested > 0) return requested;
+  unsigned int hardware = std::thread::hardware_concurrency();
+  return (hardware > 0) ? (int)hardware : 1;
+}
+
+// Cancel flag of the parallel_for the calling worker thread belongs to (null outside of parallel_for)
+inline const std::atomic<bool> *&parallel_cancel_flag() {
+  static thread_local const std::atomic<bool> *flag = 0;
+  return flag;
+}
+
+// True when the current parallel_for has been cancelled (interrupt or an exception of another item): long items poll it
+// and return early, their results are discarded anyway.
+inline bool parallel_cancelled() {
+  const std::atomic<bool> *flag = parallel_cancel_flag();
+  return flag && flag->load(std::memory_order_relaxed);
+}
+
+// Calls f(i, thread) for i = 0, ..., n-1 on nthreads worker threads (dynamic scheduling, thread = 0, ..., nthreads-1).
+// f must not call the R API: it runs on worker threads. Meanwhile the calling thread polls check_interrupt (may be null, e.g.
+// sim_check_interrupt) every 10 milliseconds. An interrupt or an exception thrown by f cancels the remaining items; after all
+// workers have stopped, the first exception is rethrown on the calling thread.
+template <class F>
+void parallel_for(int n, int nthreads, F f, void (*check_interrupt)() = 0) {
+  if (n <= 0) return;
+  std::atomic<int> next(0), running(0);
+  std::atomic<bool> cancelled(false);
+  std::exception_ptr error;
+  std::mutex mutex;
+  std::condition_variable done;
+  auto fail = [&](std::exception_ptr e) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!error) error = e;
+    cancelled = true;
+  };
+  auto work = [&](int thread) {
+    parallel_cancel_flag() = &cancelled;
+    for (int i = next++; (i < n) && !cancelled; i = next++) {
+      try {
+        f(i, thread);
+      } catch (...) {
+        fail(std::current_exception());
+      }
+    }
+    parallel_cancel_flag() = 0;
+    std::lock_guard<std::mutex> lock(mutex);
+    if (--running == 0) done.notify_one();
+  };
+  const int nworkers = (nthreads < n) ? ((nthreads > 1) ? nthreads : 1) : n;
+  std::vector<std::thread> workers;
+  running = nworkers;
+  for (int t = 0; t < nworkers; t++) {
+    workers.push_back(std::thread(work, t));
+  }
+  for (;;) {
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      if (done.wait_for(lock, std::chrono::milliseconds(10), [&]() { return running == 0; })) break;
+    }
+    if (check_interrupt && !cancelled) {
+      try {
+        check_interrupt();
+      } catch (...) {
+        fail(std::current_exception());
+      }
+    }
+  }
+  for (size_t t = 0; t < workers.size(); t++) {
+    workers[t].join();
+  }
+  if (error) std::rethrow_exception(error);
+}
+
+#endif
@@ -9,14 +9,14 @@ using namespace Rcpp;
 #define MODEL_NAME pkc
 // include the simulation function with macros (#define statements) that make it model specific (based on MODEL_NAME)
 #include "simulator.cpp"
-// Global variables
-static std::map <std::string, double> prop_params_map;
-// 2. USER INPUT for new models: Change the name of the wrapper function to sim_<MODEL_NAME> and the names of the internally called functions to init_<MODEL_NAME> and simulator_<MODEL_NAME>.
+// 2. USER INPUT for new models: Change the names of the wrapper functions to sim_<MODEL_NAME> and detSim_<MODEL_NAME> and the names of the internally called functions to resolve_model_params_<MODEL_NAME>, simulator_<MODEL_NAME> and det_simulator_<MODEL_NAME>.
 //' PKC Model R Wrapper Function (exported to R)
 //'
 //' This function compares user-supplied parameters to defaults parameter values, overwrites the defaults if neccessary, and calls the internal C++ simulation function for the pkc model.
 //' @param user_input_df A Dataframe: the input Calcium time series (with at least two columns: "time" in s and "Ca" in nMol/l).
+//'                      Optional columns "AA" and "DAG" (nmol/l) replace the fixed second messenger concentrations by time series.
 //' @param user_sim_params A List: contains values for the simulation end ("endTime") and its timesteps ("timestep").
+//'                        With "baselineCa" the simulation starts from an equilibrated state at this calcium concentration (see sim_equilibrate()).
 //' @param user_model_params A List: the model specific parameters. Can contain up to three different vectors named "vols" (model volumes), "init_conc" (initial conditions) and "params" (propensity equation parameters). 
 //' @section Default Parameters of the Protein Kinase C Model:
 //' Default Volumes: 
@@ -69,75 +69,11 @@ DataFrame sim_pkc(DataFrame user_input_df,
                   List user_sim_params,
                   List user_model_params) {
 
-  // READ INPUT
-  // Provide default model parameters list
-  List default_model_params = init_pkc();
-  // Extract default vectors from list
-  NumericVector default_vols = default_model_params["vols"];
-  NumericVector default_init_conc = default_model_params["init_conc"];
-  NumericVector default_params = default_model_params["params"];
-  // Extract vectors from user supplied list 
-  // If they exist: definition with the default vector gets overwritten
-  NumericVector user_vols = default_vols;
-  if (user_model_params.containsElementNamed("vols")) {
-      user_vols = user_model_params["vols"];
-  } else {
-    Rcout << "Default volume(s) have been used." << std::endl;
-  } 
-  NumericVector user_init_conc = default_init_conc;
-  if (user_model_params.containsElementNamed("init_conc")) {
-    user_init_conc = user_model_params["init_conc"];
-  } else {
-    Rcout << "Default initial condition(s) have been used." << std::endl;
-  }
-  NumericVector user_params = default_params;
-  if (user_model_params.containsElementNamed("params")) {
-    user_params = user_model_params["params"];
-  } else {
-    Rcout << "Default reaction parameter(s) have been used." << std::endl;
-  }
-  // UPDATE DEFAULTS 
-  // Replace entries in default_model_params with user-supplied values if necessary
-  // 1.) Volumes update:
-  CharacterVector user_vols_names = user_vols.names();
-  for (int i = 0; i < user_vols_names.length(); i++) {
-    std::string current_vol_name = as<std::string>(user_vols_names[i]);
-    if (default_vols.containsElementNamed((current_vol_name).c_str())) {
-      // update default values
-      default_vols[current_vol_name] = user_vols[current_vol_name];    
-    } else {
-      Rcout << "No such index! Default values have been used. Check input parameter vectors." << std::endl;
-    }
-  }
-  // 2.) Initial conditions update:
-  CharacterVector user_init_conc_names = user_init_conc.names();
-  for (int i = 0; i < user_init_conc_names.length(); i++) {
-    std::string current_init_conc_name = as<std::string>(user_init_conc_names[i]);
-    if (default_init_conc.containsElementNamed((current_init_conc_name).c_str())) {
-      // update default values
-      default_init_conc[current_init_conc_name] = user_init_conc[current_init_conc_name];    
-    } else {
-      Rcout << "No such index! Default values have been used. Check input parameter vectors." << std::endl;
-    }
-  }
-  // 3.) Propensity equation parameters update:
-  CharacterVector user_params_names = user_params.names();
-  for (int i = 0; i < user_params_names.length(); i++) {
-    std::string current_param_name = as<std::string>(user_params_names[i]);
-    if (default_params.containsElementNamed((current_param_name).c_str())) {
-      // update default values
-      default_params[current_param_name] = user_params[current_param_name];    
-    } else {
-      Rcout << "No such index! Default values have been used. Check input parameter vectors." << std::endl;
-    }
-  }
-  // Put propensity reaction parameters in a map (for function calculate_amu)
-  // (take parameters from vector "default_params" which contains the updated values)
-  CharacterVector default_params_names = default_params.names();
-  for (int n = 0; n < default_params.length(); n++) {
-    std::string current_param_name = as<std::string>(default_params_names[n]);
-    prop_params_map[current_param_name] = default_params[current_param_name];  
-  }
+  // READ INPUT AND UPDATE DEFAULTS
+  // Replace entries in the default model parameters with user-supplied values if necessary
+  List model_params_list = resolve_model_params_pkc(user_model_params, false);
+  NumericVector default_vols = model_params_list["vols"];
+  NumericVector default_init_conc = model_params_list["init_conc"];
   // RUN SIMULATION
   // Return result of the included, model-specific copy of the function "simulator" 
   return simulator_pkc(user_input_df,
@@ -147,153 +83,138 @@ DataFrame sim_pkc(DataFrame user_input_df,
    
 }
 
+//' PKC Model Deterministic Simulation (exported to R)
+//'
+//' This function compares user-supplied parameters to defaults parameter values, overwrites the defaults if neccessary, and integrates the reaction rate equations of the pkc model with the internal C++ ODE solver.
+//' The equations are generated from the same model definition as the propensities of the stochastic simulation (see sim_pkc() for the default parameters).
+//' @param input_df A Dataframe: the input Calcium time series (with at least two columns: "time" in s and "Ca" in nmol/l).
+//'                 Optional columns "AA" and "DAG" (nmol/l) replace the fixed second messenger concentrations by time series.
+//' @param input_sim_params A List: contains values for the simulation end ("endTime") and its timesteps ("timestep") or a vector of output times ("outputTimes"), and optionally the solver tolerances ("rtol", "atol").
+//' @param input_model_params A List: the model specific parameters. Can contain up to three different vectors named "vols" (model volumes), "init_conc" (initial conditions) and "params" (reaction parameters). 
+//' @return A dataframe with the output times, the calcium input and the concentrations of all species.
+//' @examples
+//' detSim_pkc()
+//' @export
+// [[Rcpp::export]]
+DataFrame detSim_pkc(DataFrame input_df,
+                     List input_sim_params,
+                     List input_model_params) {
+
+  // READ INPUT AND UPDATE DEFAULTS
+  List model_params_list = resolve_model_params_pkc(input_model_params, true);
+  NumericVector default_vols = model_params_list["vols"];
+  NumericVector default_init_conc = model_params_list["init_conc"];
+  // RUN SIMULATION
+  return det_simulator_pkc(input_df,
+                           input_sim_params,
+                           default_vols,
+                           default_init_conc);
+
+}
+
 
 
 //********************************/* MODEL DEFINITION */********************************
-// 3. USER INPUT for new models: define model parameters, number of species, 
-// number of reactions, propensity equations and update_system function 
+// 3. USER INPUT for new models: define species, volumes and reaction parameters (with default values),
+// the stoichiometric matrix and the propensity equations. 
+// The stochastic and the deterministic simulation kernels are both generated from this single definition (see model_definition.hpp).
 
-// Default model parameters
-List init() {
-  // Model dimensions
-  nspecies = 11;
-  nreactions = 20;
-  
-  // Default volume(s)
-  NumericVector vols = NumericVector::create(
-    _["vol"] = 1e-15
-  );
-  // Default initial conditions
-  NumericVector init_conc = NumericVector::create(
-    _["PKC_inact"] = 1000,
-    _["CaPKC"] = 0,
-    _["DAGCaPKC"] = 0,
-    _["AADAGPKC_inact"] = 0,
-    _["AADAGPKC_act"] = 0,
-    _["PKCbasal"] = 20,
-    _["AAPKC"] = 0,
-    _["CaPKCmemb"] = 0,
-    _["AACaPKC"] = 0,
-    _["DAGPKCmemb"] = 0,
-    _["DAGPKC"] = 0
-  );
-  // Default propensity equation parameters
-  NumericVector params = NumericVector::create(
-    _["k1"] = 1,
-    _["k2"] = 50,
-    _["k3"] = 1.2e-7,
-    _["k4"] = 0.1,
-    _["k5"] = 1.2705,
-    _["k6"] = 3.5026,
-    _["k7"] = 1.2e-7,
-    _["k8"] = 0.1,
-    _["k9"] = 1,
-    _["k10"] = 0.1,
-    _["k11"] = 2,
-    _["k12"] = 0.2,
-    _["k13"] = 0.0006,
-    _["k14"] = 0.5,
-    _["k15"] = 7.998e-6,
-    _["k16"] = 8.6348,
-    _["k17"] = 6e-7,
-    _["k18"] = 0.1,
-    _["k19"] = 1.8e-5,
-    _["k20"] = 2
-  );
-  // The ::create function can only take 20 arguments at once (Rcpp problem)
-  // All additional parameters need to be added via the slow push_back (x, name) method called on params vector
-  params.push_back(11000, "AA"); // given as conc. remains fixed throughout the simulation
-  params.push_back(5000, "DAG"); // given as conc. remains fixed throughout the simulation
-    
-  // Combine and return all vectors in a default_params list
-  return List::create(
-    _["vols"] = vols,
-    _["init_conc"] = init_conc,
-    _["params"] = params
-  );
-  
-}
+// Species and default initial conditions [nmol/l]
+#define MODEL_SPECIES(X) \
+  X(PKC_inact, 1000) \
+  X(CaPKC, 0) \
+  X(DAGCaPKC, 0) \
+  X(AADAGPKC_inact, 0) \
+  X(AADAGPKC_act, 0) \
+  X(PKCbasal, 20) \
+  X(AAPKC, 0) \
+  X(CaPKCmemb, 0) \
+  X(AACaPKC, 0) \
+  X(DAGPKCmemb, 0) \
+  X(DAGPKC, 0)
+// Default volume(s) [l]
+#define MODEL_VOLS(X) \
+  X(vol, 1e-15)
+// Default propensity equation parameters
+#define MODEL_PARAMS(X) \
+  X(k1, 1) \
+  X(k2, 50) \
+  X(k3, 1.2e-7) \
+  X(k4, 0.1) \
+  X(k5, 1.2705) \
+  X(k6, 3.5026) \
+  X(k7, 1.2e-7) \
+  X(k8, 0.1) \
+  X(k9, 1) \
+  X(k10, 0.1) \
+  X(k11, 2) \
+  X(k12, 0.2) \
+  X(k13, 0.0006) \
+  X(k14, 0.5) \
+  X(k15, 7.998e-6) \
+  X(k16, 8.6348) \
+  X(k17, 6e-7) \
+  X(k18, 0.1) \
+  X(k19, 1.8e-5) \
+  X(k20, 2) \
+  X(AA, 11000)  /* given as conc., fixed unless given as input signal */ \
+  X(DAG, 5000)  /* given as conc., fixed unless given as input signal */
+// Parameters that can be given as input time series (columns of the input data frame, piecewise constant like Ca)
+#define MODEL_INPUTS(X) \
+  X(AA) \
+  X(DAG)
+// Second messenger dependent factors (depend only on parameters and inputs, precomputed once per input interval;
+// AA, DAG and Ca are given as conc., hence, no scaling)
+#define MODEL_FACTORS(X) \
+  X(k3_AA, k3 * AA) \
+  X(k7_AA, k7 * AA) \
+  X(k13_Ca, Ca * k13) \
+  X(k15_DAG, k15 * DAG) \
+  X(k17_DAG, k17 * DAG) \
+  X(k19_AA, k19 * AA)
+// Stoichiometric matrix (rows: species, columns: reactions)
+#define MODEL_STOICHIOMETRY \
+  /* PKC_inact      */ -1,  1, -1,  1,  0,  0,  0,  0,  0,  0,  0,  0, -1,  1,  0,  0, -1,  1,  0,  0, \
+  /* CaPKC          */  0,  0,  0,  0, -1,  1, -1,  1,  0,  0,  0,  0,  1, -1, -1,  1,  0,  0,  0,  0, \
+  /* DAGCaPKC       */  0,  0,  0,  0,  0,  0,  0,  0, -1,  1,  0,  0,  0,  0,  1, -1,  0,  0,  0,  0, \
+  /* AADAGPKC_inact */  0,  0,  0,  0,  0,  0,  0,  0,  0,  0, -1,  1,  0,  0,  0,  0,  0,  0,  1, -1, \
+  /* AADAGPKC_act   */  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  1, -1,  0,  0,  0,  0,  0,  0,  0,  0, \
+  /* PKCbasal       */  1, -1,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0, \
+  /* AAPKC          */  0,  0,  1, -1,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0, \
+  /* CaPKCmemb      */  0,  0,  0,  0,  1, -1,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0, \
+  /* AACaPKC        */  0,  0,  0,  0,  0,  0,  1, -1,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0, \
+  /* DAGPKCmemb     */  0,  0,  0,  0,  0,  0,  0,  0,  1, -1,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0, \
+  /* DAGPKC         */  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  1, -1, -1,  1
+
+#include "model_definition.hpp"
 
 // Propensity calculation:
-// Calculates the propensities of all PKC model reactions and stores them in the vector amu.
-void calculate_amu() {
+// Calculates the propensities of all PKC model reactions (particle numbers x, calcium concentration Ca).
+template <typename Real, typename Param>
+void propensities(const model_param_set<Param> &params, const model_factor_set<Param> &factors, double Ca, const Real *x, double f, Real *rate) {
   
-  // Look up model parameters in array 'double = model_params' initially
-  double k1 = prop_params_map["k1"];
-  double k2 = prop_params_map["k2"];
-  double k3 = prop_params_map["k3"];
-  double k4 = prop_params_map["k4"];
-  double k5 = prop_params_map["k5"];
-  double k6 = prop_params_map["k6"];
-  double k7 = prop_params_map["k7"];
-  double k8 = prop_params_map["k8"];
-  double k9 = prop_params_map["k9"];
-  double k10 = prop_params_map["k10"];
-  double k11 = prop_params_map["k11"];
-  double k12 = prop_params_map["k12"];
-  double k13 = prop_params_map["k13"];
-  double k14 = prop_params_map["k14"];
-  double k15 = prop_params_map["k15"];
-  double k16 = prop_params_map["k16"];
-  double k17 = prop_params_map["k17"];
-  double k18 = prop_params_map["k18"];
-  double k19 = prop_params_map["k19"];
-  double k20 = prop_params_map["k20"];
-  double AA = prop_params_map["AA"];
-  double DAG = prop_params_map["DAG"];
+  // Model parameters as local variables (k1, ..., k20, AA, DAG)
+  MODEL_PARAMS(UNPACK_PARAM)
+  MODEL_FACTORS(UNPACK_FACTOR)
   
-  amu[0] = k1 * x[0];
-  amu[1] = amu[0] + k2 * x[5];
-  amu[2] = amu[1] + k3 * AA * (double)x[0]; /* AA given as conc., hence, no scaling */
-  amu[3] = amu[2] + k4 * x[6];
-  amu[4] = amu[3] + k5 * x[1];
-  amu[5] = amu[4] + k6 * x[7];
-  amu[6] = amu[5] + k7 * AA * (double)x[1];  /* AA given as conc., hence, no scaling */
-  amu[7] = amu[6] + k8 * x[8];
-  amu[8] = amu[7] + k9 * x[2];
-  amu[9] = amu[8] + k10 * x[9];
-  amu[10] = amu[9] + k11 * x[3];
-  amu[11] = amu[10] + k12 * x[4];
-  amu[12] = amu[11] + calcium[ntimepoint] * k13 * (double)x[0]; /* Ca given as conc., hence, no scaling */
-  amu[13] = amu[12] + k14 * x[1];
-  amu[14] = amu[13] + k15 * DAG * (double)x[1]; /* DAG given as conc., hence, no scaling */
-  amu[15] = amu[14] + k16 * x[2];
-  amu[16] = amu[15] + k17 * DAG * (double)x[0]; /* DAG given as conc., hence, no scaling */
-  amu[17] = amu[16] + k18 * x[10];
-  amu[18] = amu[17] + k19 * AA * (double)x[10];  /* AA given as conc., hence, no scaling */
-  amu[19] = amu[18] + k20 * x[3];
+  rate[0] = k1 * x[0];
+  rate[1] = k2 * x[5];
+  rate[2] = k3_AA * x[0];
+  rate[3] = k4 * x[6];
+  rate[4] = k5 * x[1];
+  rate[5] = k6 * x[7];
+  rate[6] = k7_AA * x[1];
+  rate[7] = k8 * x[8];
+  rate[8] = k9 * x[2];
+  rate[9] = k10 * x[9];
+  rate[10] = k11 * x[3];
+  rate[11] = k12 * x[4];
+  rate[12] = k13_Ca * x[0];
+  rate[13] = k14 * x[1];
+  rate[14] = k15_DAG * x[1];
+  rate[15] = k16 * x[2];
+  rate[16] = k17_DAG * x[0];
+  rate[17] = k18 * x[10];
+  rate[18] = k19_AA * x[10];
+  rate[19] = k20 * x[3];
 }
-
-
-// Stoichiometric matrix
-NumericMatrix get_stM() {
-  
-  // initialize stoich matrix (with zeroes)
-  NumericMatrix stM(nspecies, nreactions);
-  // create stoich matrix row vectors
-  NumericVector stM_row1 = {-1, 1, -1, 1, 0, 0, 0, 0, 0, 0, 0, 0, -1, 1, 0, 0, -1, 1, 0, 0};
-  NumericVector stM_row2 = {0, 0, 0, 0, -1, 1, -1, 1, 0, 0, 0, 0, 1, -1, -1, 1, 0, 0, 0, 0};
-  NumericVector stM_row3 = {0, 0, 0, 0, 0, 0, 0, 0, -1, 1, 0, 0, 0, 0, 1, -1, 0, 0, 0, 0};
-  NumericVector stM_row4 = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, -1, 1, 0, 0, 0, 0, 0, 0, 1, -1};
-  NumericVector stM_row5 = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, -1, 0, 0, 0, 0, 0, 0, 0, 0};
-  NumericVector stM_row6 = {1, -1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
-  NumericVector stM_row7 = {0, 0, 1, -1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
-  NumericVector stM_row8 = {0, 0, 0, 0, 1, -1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
-  NumericVector stM_row9 = {0, 0, 0, 0, 0, 0, 1, -1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
-  NumericVector stM_row10 = {0, 0, 0, 0, 0, 0, 0, 0, 1, -1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
-  NumericVector stM_row11 = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, -1, -1, 1};
-  // fill rows of stoich matrix
-  stM(0, _) = stM_row1;
-  stM(1, _) = stM_row2;
-  stM(2, _) = stM_row3;
-  stM(3, _) = stM_row4;
-  stM(4, _) = stM_row5;
-  stM(5, _) = stM_row6;
-  stM(6, _) = stM_row7;
-  stM(7, _) = stM_row8;
-  stM(8, _) = stM_row9;
-  stM(9, _) = stM_row10;
-  stM(10, _) = stM_row11;
-  
-  return stM;  
-}
\ No newline at end of file
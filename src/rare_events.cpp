@@ -0,0 +1,239 @@
+#include <string>
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <Rcpp.h>
+#include "model_registry.hpp"
+#include "buffer_pool.hpp"
+#include "parallel.hpp"
+#include "sim_params.hpp"
+using namespace Rcpp;
+
+
+// Random number streams of the splitting runs: repetition (0: pilot), stage and particle
+// (two reserved stages for the initial states and the resampling of a repetition)
+static const int split_initial_stage = 1023;
+static const int split_resample_stage = 1022;
+static uint64_t split_stream(int rep, int stage, int i) {
+  return ((uint64_t)rep << 42) + ((uint64_t)stage << 32) + (uint64_t)i;
+}
+
+// Fixed effort multilevel splitting of the stochastic simulator
+// Every stage continues copies of the states that reached the previous level (complete run states: particle numbers, time and input
+// cursor, see ssa_engine.hpp) with new random number streams until the reaction coordinate reaches the next level or the simulation ends.
+struct splitting_problem {
+  const model_info *info;
+  sim_problem pb;
+  stop_conditions coordinate;   // condition 0: reaction coordinate >= level (particle numbers)
+  uint64_t seed;
+  int nparticles;
+  int nthreads;
+
+  // Initial states of repetition rep
+  void initial(int rep, std::vector<ssa_state> &start) const {
+    start.clear();
+    for (int i = 0; i < nparticles; i++) {
+      start.push_back(ssa_initial_state(pb, seed, split_stream(rep, split_initial_stage, i)));
+    }
+  }
+
+  // Runs the start states (stream split_stream(rep, stage, i)) until the coordinate reaches 'level' or the simulation ends:
+  // end states, whether they reached the level and, if peak is not null, the peak of the coordinate on the way. Rerunning with
+  // the same rep and stage gives the same paths, so a lower level stops the same runs at their first passage of the lower level.
+  // The peak comes from the jump trajectory of the run (event log, see event_log.hpp), replayed from the start state: the engine
+  // only checks the stopping condition.
+  void run(const std::vector<ssa_state> &start, double level, int rep, int stage,
+           std::vector<ssa_state> &end, std::vector<char> &hit, std::vector<double> *peak) const {
+    const int n = start.size();
+    const int ns = info->nspecies, nr = info->nreactions;
+    stop_conditions stop(coordinate);
+    stop.level[0] = level;
+    std::vector<event_log> logs(nthreads, event_log(0.0, 1.0, nr));
+    end.resize(n);
+    hit.assign(n, 0);
+    if (peak) peak->assign(n, -HUGE_VAL);
+    parallel_for(n, nthreads, [&](int i, int thread) {
+      double *out = thread_buffers().get(buffer_output, ns);
+      ssa_state &s = end[i];
+      s = start[i];
+      s.rng.seed(seed, split_stream(rep, stage, i));
+      event_log &log = logs[thread];   // reused: keeps the capacity of the byte string
+      log.start = s.time;
+      log.bytes.clear();
+      log.nevents = 0;
+      log.last = 0;
+      if (stop.met(&s.x[0]) < 0) {
+        info->ssa_simulator(pb, s, HUGE_VAL, out, UINT64_MAX, &stop, peak ? &log : 0);
+      }
+      hit[i] = (stop.met(&s.x[0]) >= 0);
+      if (peak) {
+        std::vector<double> x(start[i].x);
+        double highest = stop.value(0, &x[0]);
+        const unsigned char *p = reinterpret_cast<const unsigned char *>(log.bytes.data());
+        replay_events(p, p + log.bytes.size(), log.start, log.resolution, nr, [&](double, int reaction) {
+          for (int j = 0; j < ns; j++) x[j] += info->stoichiometry[j*nr + reaction];
+          highest = std::max(highest, stop.value(0, &x[0]));
+        });
+        (*peak)[i] = highest;
+      }
+    }, &sim_check_interrupt);
+  }
+
+  // Multinomial resampling: nparticles start states drawn uniformly from the end states that reached the level
+  void resample(const std::vector<ssa_state> &end, const std::vector<char> &hit, Rng &rng, std::vector<ssa_state> &start) const {
+    std::vector<int> hits;
+    for (size_t i = 0; i < end.size(); i++) {
+      if (hit[i]) hits.push_back(i);
+    }
+    start.resize(nparticles);
+    for (int i = 0; i < nparticles; i++) {
+      start[i] = end[hits[std::min(hits.size() - 1, (size_t)(rng.uniform() * hits.size()))]];
+    }
+  }
+};
+
+
+//' Rare Event Probabilities of the Stochastic Models (exported to R)
+//'
+//' Estimates the probability that a reaction coordinate (a species or a weighted sum of species) reaches a target before the end of the
+//' simulation, for events far too rare for plain ensembles (e.g. probabilities of 1e-6 per run), with fixed effort multilevel splitting:
+//' nparticles runs start from the initial state; the runs that reach the first intermediate level are copied (resampled) to nparticles
+//' runs continued from their exact states at the first passage of the level with new random numbers, and so on up to the target.
+//' The product of the fractions of runs that reach each next level is an unbiased estimate of the probability, and its standard error
+//' comes from independent repetitions. Without user supplied levels, a pilot splitting run places the levels adaptively so that a
+//' fraction pilot_quantile of the runs reaches each next level; the estimates then use these fixed levels (and other random numbers),
+//' so the adaptive placement does not bias them. Runs are simulated in parallel on native threads; the results do not depend on the number of threads.
+//' @param model A string: the name of the model ("ano", "calcineurin", "calmodulin", "camkii", "glycphos" or "pkc").
+//' @param input_df A Dataframe: the input Calcium time series (with at least two columns: "time" in s and "Ca" in nmol/l).
+//' @param input_sim_params A List: contains the simulation end ("endTime", or the last of the "outputTimes"), and optionally a "seed".
+//'                         With "baselineCa" the runs start from equilibrated states at this calcium concentration (see sim_equilibrate()).
+//' @param input_model_params A List: the model specific parameters. Can contain up to three different vectors named "vols" (model volumes), "init_conc" (initial conditions) and "params" (reaction parameters).
+//' @param coordinate The reaction coordinate: a species name, several species names (their sum) or a named vector of weights (a linear combination).
+//' @param target A number: the target value of the coordinate [nmol/l] (the event is the coordinate reaching at least this value).
+//' @param levels A numeric vector: increasing intermediate levels below the target [nmol/l] (default: placed by a pilot run; at most 1021).
+//' @param nparticles An integer: the number of runs per level.
+//' @param nrepeats An integer: the number of independent estimates (at least 2 for a standard error).
+//' @param pilot_quantile A number: the fraction of the pilot runs that reaches each next level.
+//' @param max_levels An integer: the maximum number of levels of the pilot run (at most 1022).
+//' @param nthreads An integer: the number of threads (default: all hardware threads).
+//' @return A list with the estimated probability, its standard error and relative error, the independent estimates, the levels (including the target),
+//'         the mean conditional probability of reaching each level from the previous one ("level_probabilities") and the number of simulation runs.
+//' @examples
+//' ca <- data.frame(time = seq(0, 100, by = 0.1), Ca = 50)
+//' rare_event_probability("camkii", ca, list(endTime = 100), list(), coordinate = "W_A", target = 10, nparticles = 500)
+//' @export
+// [[Rcpp::export]]
+List rare_event_probability(std::string model,
+                            DataFrame input_df,
+                            List input_sim_params,
+                            List input_model_params,
+                            SEXP coordinate,
+                            double target,
+                            NumericVector levels = NumericVector::create(),
+                            int nparticles = 1000,
+                            int nrepeats = 10,
+                            double pilot_quantile = 0.1,
+                            int max_levels = 100,
+                            int nthreads = 0) {
+
+  // READ INPUT AND UPDATE DEFAULTS
+  splitting_problem sp;
+  sp.info = &find_model(model);
+  sp.pb = read_sim_problem(*sp.info, input_df, input_sim_params, input_model_params);
+  sp.coordinate = read_stop_conditions(*sp.info, sp.pb, List::create(_["species"] = coordinate, _["threshold"] = target));
+  sp.seed = sim_seed(input_sim_params);
+  sp.nparticles = nparticles;
+  sp.nthreads = worker_threads(nthreads);
+  // Only the end of the simulation is recorded
+  sp.pb.output_times.assign(1, sp.pb.end_time());
+  const double f = sp.pb.f;
+  if ((nparticles < 2) || (nrepeats < 1) || !(pilot_quantile > 0 && pilot_quantile < 1) || (max_levels < 1) || (max_levels > split_resample_stage)) {
+    stop("nparticles has to be at least 2, nrepeats at least 1, pilot_quantile in (0, 1) and max_levels between 1 and " +
+         std::to_string(split_resample_stage) + ".");
+  }
+  // every level (and the target) is a stage of its own random number streams
+  if (levels.length() >= split_resample_stage) {
+    stop("At most " + std::to_string(split_resample_stage - 1) + " levels are supported.");
+  }
+  std::vector<double> level;   // levels in particle numbers (the last one is the target)
+  for (int k = 0; k < levels.length(); k++) {
+    if (!(levels[k] < target) || ((k > 0) && !(levels[k] > levels[k-1]))) {
+      stop("levels have to be increasing and below the target.");
+    }
+    level.push_back(levels[k] * f);
+  }
+  std::vector<ssa_state> start, end;
+  std::vector<char> hit;
+  std::vector<double> peak;
+  double nsimulations = 0;
+
+  // PILOT RUN (repetition 0): the next level is reached by a fraction pilot_quantile of the runs from the current one
+  if (level.empty()) {
+    Rng rng(sp.seed, split_stream(0, split_resample_stage, 0));
+    sp.initial(0, start);
+    for (int stage = 0; ; stage++) {
+      if (stage >= max_levels) {
+        stop("The target was not reached within max_levels levels (increase max_levels or pilot_quantile).");
+      }
+      sp.run(start, target * f, 0, stage, end, hit, &peak);
+      nsimulations += nparticles;
+      sim_check_interrupt();
+      if (std::count(hit.begin(), hit.end(), 1) >= pilot_quantile * nparticles) {
+        break;
+      }
+      std::vector<double> sorted(peak);
+      std::sort(sorted.begin(), sorted.end());
+      double next = sorted[nparticles - (int)std::ceil(pilot_quantile * nparticles)];
+      double previous = level.empty() ? -HUGE_VAL : level.back();
+      if (!(next > previous)) {
+        // ties of the (discrete) coordinate: the next value above the current level
+        std::vector<double>::iterator it = std::upper_bound(sorted.begin(), sorted.end(), previous);
+        if (it == sorted.end()) {
+          stop("The pilot run makes no progress: no run gets beyond level " + std::to_string(previous / f) + " (increase nparticles).");
+        }
+        next = *it;
+      }
+      level.push_back(next);
+      // Same paths up to the first passage of the new level
+      sp.run(start, next, 0, stage, end, hit, 0);
+      nsimulations += nparticles;
+      sp.resample(end, hit, rng, start);
+    }
+  }
+  level.push_back(target * f);
+  const int nlevels = level.size();
+
+  // ESTIMATES (repetitions 1, ..., nrepeats with the fixed levels)
+  NumericVector estimates(nrepeats);
+  std::vector<double> level_sum(nlevels, 0.0), level_count(nlevels, 0.0);
+  for (int rep = 1; rep <= nrepeats; rep++) {
+    Rng rng(sp.seed, split_stream(rep, split_resample_stage, 0));
+    sp.initial(rep, start);
+    double p = 1.0;
+    for (int k = 0; k < nlevels; k++) {
+      sp.run(start, level[k], rep, k, end, hit, 0);
+      nsimulations += nparticles;
+      sim_check_interrupt();
+      double fraction = (double)std::count(hit.begin(), hit.end(), 1) / nparticles;
+      p *= fraction;
+      level_sum[k] += fraction;
+      level_count[k] += 1;
+      if (fraction == 0) break;
+      if (k+1 < nlevels) sp.resample(end, hit, rng, start);
+    }
+    estimates[rep-1] = p;
+  }
+  double mean = 0.0, var = 0.0;
+  for (int r = 0; r < nrepeats; r++) mean += estimates[r] / nrepeats;
+  for (int r = 0; r < nrepeats; r++) var += (estimates[r] - mean) * (estimates[r] - mean) / (nrepeats - 1);
+  double std_error = (nrepeats > 1) ? std::sqrt(var / nrepeats) : NA_REAL;
+  NumericVector level_values(nlevels), level_probabilities(nlevels);
+  for (int k = 0; k < nlevels; k++) {
+    level_values[k] = level[k] / f;
+    level_probabilities[k] = (level_count[k] > 0) ? level_sum[k] / level_count[k] : NA_REAL;
+  }
+
+  return List::create(_["probability"] = mean, _["std_error"] = std_error,
+                      _["relative_error"] = (mean > 0) ? std_error / mean : NA_REAL, _["estimates"] = estimates,
+                      _["levels"] = level_values, _["level_probabilities"] = level_probabilities, _["nsimulations"] = nsimulations);
+}
@@ -0,0 +1,397 @@
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include <cstdio>
+#include <fstream>
+#include <chrono>
+#include <cstddef>
+#include <dirent.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+#include <Rcpp.h>
+#include "result_cache.hpp"
+#include "mapped_file.hpp"
+#include "sim_params.hpp"
+#include "result_columns.hpp"
+using namespace Rcpp;
+
+
+// On-disk result cache
+// Every entry is one file <hash>.cmlc in the cache directory: a header, the key material (compared on every hit), the state of R's
+// generator after the run (stochastic runs), the column names and the columns (doubles, 8 byte aligned). Hits are copied from the
+// memory-mapped file into the result columns and stamp the time of their use in the header; when a new entry makes the directory
+// exceed the size limit, the entries with the oldest stamps are deleted. Entries are written to a temporary file of the writer (process id,
+// counter and time) and renamed, so concurrent R sessions sharing a directory never read or rename half-written entries.
+struct result_cache_config {
+  std::string directory;   // empty: cache disabled
+  double max_size;         // [bytes]
+  double hits, misses;
+};
+
+static result_cache_config &cache_config() {
+  static result_cache_config config = {"", 1e9, 0, 0};
+  return config;
+}
+
+static const char cache_magic[8] = {'C', 'M', 'L', 'C', 'A', 'C', 'H', '3'};
+static const char *cache_suffix = ".cmlc";
+
+// Version of the simulation engines in the key: increment it with every change of the engines or models that changes the results
+// of the same configuration (the package version is part of the key as well, this covers development versions)
+static const int cache_engine_version = 1;
+
+struct cache_header {
+  char magic[8];
+  uint64_t key_size, rng_size, nrow, ncol, names_size;
+  double used;   // time of the last use [s since the epoch]
+};
+
+static double cache_now() {
+  return std::chrono::duration<double>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// Version of the installed package (read from R once per session)
+static const std::string &package_version() {
+  static std::string version;
+  if (version.empty()) {
+    Function package_version_of("packageVersion");
+    Function as_character("as.character");
+    version = as<std::string>(as_character(package_version_of("CalciumModelsLibrary")));
+  }
+  return version;
+}
+
+// 128 bit hash: two 64 bit lanes over the 8 byte words of the material (splitmix64 finalizer as mixing function)
+static uint64_t hash_mix(uint64_t z) {
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  return z ^ (z >> 31);
+}
+
+std::string cache_key::hash() const {
+  uint64_t h[2] = {0x9E3779B97F4A7C15ULL, 0xD1B54A32D192ED03ULL};
+  for (size_t i = 0; i < bytes.size(); i += 8) {
+    uint64_t word = 0;
+    std::memcpy(&word, &bytes[i], std::min((size_t)8, bytes.size() - i));
+    h[0] = hash_mix(h[0] ^ word) + 0x632BE59BD9B4E019ULL;
+    h[1] = hash_mix(h[1] + word * 0xFF51AFD7ED558CCDULL) ^ (h[0] >> 17);
+  }
+  h[0] = hash_mix(h[0] ^ bytes.size());
+  h[1] = hash_mix(h[1] ^ h[0]);
+  char hex[33];
+  std::snprintf(hex, sizeof(hex), "%016llx%016llx", (unsigned long long)h[0], (unsigned long long)h[1]);
+  return hex;
+}
+
+void cache_key::add(SEXP object) {
+  if (Rf_isNull(object)) {
+    add(std::string("NULL"));
+  } else if (is<CharacterVector>(object)) {
+    CharacterVector v(object);
+    add(std::string("character"));
+    add_size(v.length());
+    for (int i = 0; i < v.length(); i++) add(as<std::string>(v[i]));
+  } else if (is<NumericVector>(object) || is<IntegerVector>(object) || is<LogicalVector>(object)) {
+    NumericVector v(object);
+    add(std::string("numeric"));
+    add(v.begin(), v.length());
+  } else if (is<List>(object)) {
+    List v(object);
+    add(std::string("list"));
+    add_size(v.length());
+    CharacterVector names = Rf_isNull(v.names()) ? CharacterVector(v.length()) : CharacterVector(v.names());
+    for (int i = 0; i < v.length(); i++) {
+      SEXP element = v[i];
+      add(as<std::string>(names[i]));
+      add(element);
+    }
+  } else {
+    add(std::string("other"));
+  }
+}
+
+static std::string entry_path(const std::string &hash) {
+  return cache_config().directory + "/" + hash + cache_suffix;
+}
+
+bool cache_enabled(List user_sim_params) {
+  return !cache_config().directory.empty() && (sim_param(user_sim_params, "cache", 1) != 0);
+}
+
+bool cache_uses_rng(const char *engine, List sim_params) {
+  return (std::string(engine) == "ssa") && !sim_params.containsElementNamed("seed");
+}
+
+bool simulation_cache_key(const char *engine, const char *model, DataFrame input_df, List sim_params,
+                          NumericVector vols, NumericVector init_conc, const double *params, int nparams,
+                          cache_key &key) {
+  key.bytes.clear();
+  key.add(std::string(cache_magic, 8));
+  key.add(package_version());
+  key.add(std::to_string((long long)cache_engine_version));
+  key.add(std::string(engine));
+  key.add(std::string(model));
+  key.add(vols.begin(), vols.length());
+  key.add(init_conc.begin(), init_conc.length());
+  key.add(params, nparams);
+  // Input columns and simulation parameters in name order (the order of the arguments does not matter)
+  List lists[2] = {input_df, sim_params};
+  for (int l = 0; l < 2; l++) {
+    std::vector<std::pair<std::string, int> > entries;
+    if (!Rf_isNull(lists[l].names())) {
+      CharacterVector names = lists[l].names();
+      for (int i = 0; i < names.length(); i++) {
+        if (as<std::string>(names[i]) != "cache") entries.push_back(std::make_pair(as<std::string>(names[i]), i));
+      }
+    }
+    std::sort(entries.begin(), entries.end());
+    for (size_t i = 0; i < entries.size(); i++) {
+      SEXP element = lists[l][entries[i].second];
+      key.add(entries[i].first);
+      key.add(element);
+    }
+  }
+  if (cache_uses_rng(engine, sim_params)) {
+    Environment global = Environment::global_env();
+    if (!global.exists(".Random.seed")) return false;
+    key.add(global.get(".Random.seed"));
+  }
+  return true;
+}
+
+bool cache_lookup(const cache_key &key, DataFrame &result) {
+  result_cache_config &config = cache_config();
+  const std::string path = entry_path(key.hash());
+  mapped_file entry(path);
+  cache_header h;
+  if (!entry.data || (entry.size < sizeof(h))) {
+    config.misses++;
+    return false;
+  }
+  std::memcpy(&h, entry.data, sizeof(h));
+  // Sections after the header: key, generator state, names, padding, columns
+  size_t offset = sizeof(h);
+  size_t rng_offset = offset + h.key_size;
+  size_t names_offset = rng_offset + h.rng_size*sizeof(int);
+  size_t data_offset = (names_offset + h.names_size + 7) / 8 * 8;
+  if ((std::memcmp(h.magic, cache_magic, 8) != 0) || (h.key_size != key.bytes.size()) ||
+      (h.rng_size > entry.size) || (h.names_size > entry.size) || (h.ncol > entry.size) ||
+      (data_offset + h.nrow*h.ncol*sizeof(double) != entry.size) ||
+      (std::memcmp(entry.data + offset, &key.bytes[0], key.bytes.size()) != 0)) {
+    config.misses++;
+    return false;
+  }
+  // The mapped columns are copied straight into the R vectors (the mapping ends with this call)
+  CharacterVector col_names(h.ncol);
+  List columns(h.ncol);
+  const char *name = reinterpret_cast<const char *>(entry.data + names_offset);
+  for (uint64_t c = 0; c < h.ncol; c++) {
+    col_names[c] = std::string(name);
+    NumericVector column(h.nrow);
+    if (h.nrow > 0) std::memcpy(&column[0], entry.data + data_offset + c*h.nrow*sizeof(double), h.nrow*sizeof(double));
+    columns[c] = column;
+    name += std::strlen(name) + 1;
+  }
+  result = result_frame(columns, col_names, h.nrow);
+  if (h.rng_size > 0) {
+    IntegerVector seed(h.rng_size);
+    std::memcpy(&seed[0], entry.data + rng_offset, h.rng_size*sizeof(int));
+    Environment::global_env().assign(".Random.seed", seed);
+  }
+  // Stamp of the use (in place, the entry is not rewritten)
+  std::fstream stamp(path.c_str(), std::ios::binary | std::ios::in | std::ios::out);
+  if (stamp) {
+    h.used = cache_now();
+    stamp.seekp(offsetof(cache_header, used));
+    stamp.write(reinterpret_cast<const char *>(&h.used), sizeof(h.used));
+  }
+  config.hits++;
+  return true;
+}
+
+// Entries of the cache directory (path, size, last use)
+struct cache_entry {
+  std::string path;
+  double size;
+  double used;
+  bool operator<(const cache_entry &b) const { return used < b.used; }
+};
+
+static std::vector<cache_entry> cache_entries() {
+  std::vector<cache_entry> entries;
+  const std::string &directory = cache_config().directory;
+  DIR *dir = opendir(directory.c_str());
+  if (!dir) return entries;
+  const size_t nsuffix = std::strlen(cache_suffix);
+  for (struct dirent *e = readdir(dir); e; e = readdir(dir)) {
+    std::string name = e->d_name;
+    if ((name.size() <= nsuffix) || (name.compare(name.size() - nsuffix, nsuffix, cache_suffix) != 0)) continue;
+    cache_entry entry;
+    entry.path = directory + "/" + name;
+    struct stat st;
+    if (stat(entry.path.c_str(), &st) != 0) continue;
+    entry.size = st.st_size;
+    // time of the last use from the header (entries that cannot be read go first)
+    cache_header h;
+    std::ifstream in(entry.path.c_str(), std::ios::binary);
+    entry.used = (in.read(reinterpret_cast<char *>(&h), sizeof(h)) && (std::memcmp(h.magic, cache_magic, 8) == 0)) ? h.used : 0.0;
+    entries.push_back(entry);
+  }
+  closedir(dir);
+  return entries;
+}
+
+void cache_store(const cache_key &key, DataFrame result, bool uses_rng) {
+  const result_cache_config &config = cache_config();
+  std::vector<int> rng;
+  if (uses_rng) {
+    IntegerVector seed = Environment::global_env().get(".Random.seed");
+    rng.assign(seed.begin(), seed.end());
+  }
+  CharacterVector names = result.names();
+  std::string names_bytes;
+  for (int c = 0; c < names.length(); c++) {
+    names_bytes += as<std::string>(names[c]);
+    names_bytes += '\0';
+  }
+  cache_header h;
+  std::memcpy(h.magic, cache_magic, 8);
+  h.key_size = key.bytes.size();
+  h.rng_size = rng.size();
+  h.ncol = result.length();
+  h.nrow = (h.ncol > 0) ? Rf_xlength(result[0]) : 0;
+  h.names_size = names_bytes.size();
+  h.used = cache_now();
+  size_t names_end = sizeof(h) + h.key_size + h.rng_size*sizeof(int) + h.names_size;
+  std::string padding((names_end + 7) / 8 * 8 - names_end, '\0');
+
+  const std::string path = entry_path(key.hash());
+  static unsigned long ntmp = 0;
+  const std::string tmp = path + "." + std::to_string((long long)getpid()) + "-" + std::to_string(++ntmp) + "-" +
+                          std::to_string((long long)std::chrono::steady_clock::now().time_since_epoch().count()) + ".tmp";
+  {
+    std::ofstream out(tmp.c_str(), std::ios::binary | std::ios::trunc);
+    if (!out) return;
+    out.write(reinterpret_cast<const char *>(&h), sizeof(h));
+    if (!key.bytes.empty()) out.write(reinterpret_cast<const char *>(&key.bytes[0]), key.bytes.size());
+    if (!rng.empty()) out.write(reinterpret_cast<const char *>(&rng[0]), rng.size()*sizeof(int));
+    out.write(names_bytes.data(), names_bytes.size());
+    out.write(padding.data(), padding.size());
+    // columns in blocks (views of the native output buffer are read without materialising them, see result_columns.hpp)
+    std::vector<double> block(4096);
+    for (uint64_t c = 0; c < h.ncol; c++) {
+      SEXP column = result[c];
+      for (uint64_t from = 0; from < h.nrow; from += block.size()) {
+        R_xlen_t n = std::min((uint64_t)block.size(), h.nrow - from);
+        column_region(column, from, n, &block[0]);
+        out.write(reinterpret_cast<const char *>(&block[0]), n*sizeof(double));
+      }
+    }
+    if (!out) {
+      out.close();
+      std::remove(tmp.c_str());
+      return;
+    }
+  }
+#ifdef _WIN32
+  std::remove(path.c_str());   // rename() does not replace existing files on Windows (elsewhere it replaces them atomically)
+#endif
+  if (std::rename(tmp.c_str(), path.c_str()) != 0) {
+    std::remove(tmp.c_str());
+    return;
+  }
+
+  // Least recently used entries beyond the size limit (the new entry goes last)
+  std::vector<cache_entry> entries = cache_entries();
+  std::sort(entries.begin(), entries.end());
+  double total = 0.0;
+  for (size_t i = 0; i < entries.size(); i++) total += entries[i].size;
+  for (size_t i = 0; (i < entries.size()) && (total > config.max_size); i++) {
+    if (entries[i].path == path) continue;
+    if (std::remove(entries[i].path.c_str()) == 0) total -= entries[i].size;
+  }
+}
+
+
+static List cache_info() {
+  const result_cache_config &config = cache_config();
+  std::vector<cache_entry> entries = cache_entries();
+  double size = 0.0;
+  for (size_t i = 0; i < entries.size(); i++) size += entries[i].size;
+  return List::create(_["directory"] = config.directory, _["max_size"] = config.max_size, _["entries"] = (double)entries.size(),
+                      _["size"] = size, _["hits"] = config.hits, _["misses"] = config.misses);
+}
+
+//' Result Cache (exported to R)
+//'
+//' Enables (or disables) the on-disk result cache of the simulations sim_<MODEL_NAME>() and detSim_<MODEL_NAME>(). With the cache, a run
+//' with exactly the same configuration as an earlier one (model, resolved parameters, all columns of the input data frame, simulation parameters
+//' and, for stochastic runs without the simulation parameter "seed", the state of R's random number generator, e.g. after the same set.seed())
+//' returns the stored result from the memory-mapped cache file instead of simulating again. Stochastic runs with a "seed" hit the cache whatever
+//' the state of R's generator, which they do not use. Hits of runs seeded by R's generator restore the generator state after the original run,
+//' so the following random numbers are the same as without the cache; these runs are not cached before R's generator was first used.
+//' Results stored by other versions of the package are not used. The cache keeps the most recently used results up to max_size bytes. A run can skip the cache with the simulation parameter cache = FALSE.
+//' @param directory A string: the cache directory (created if needed; shared by R sessions and kept between them), "" to disable the cache.
+//' @param max_size A number: the maximum total size of the cached results [bytes].
+//' @return A list with the directory, the size limit, the number and total size of the cached results, and the hits and misses of this session.
+//' @examples
+//' sim_cache(file.path(tempdir(), "sim_cache"))
+//' ca <- data.frame(time = seq(0, 10, by = 0.01), Ca = 200)
+//' set.seed(1); a <- sim_calmodulin(ca, list(endTime = 10), list())
+//' set.seed(1); b <- sim_calmodulin(ca, list(endTime = 10), list())   # from the cache
+//' sim_cache("")
+//' @export
+// [[Rcpp::export]]
+List sim_cache(std::string directory = "", double max_size = 1e9) {
+  result_cache_config &config = cache_config();
+  if (!directory.empty()) {
+    Function dir_create("dir.create");
+    dir_create(directory, _["recursive"] = true, _["showWarnings"] = false);
+    DIR *dir = opendir(directory.c_str());
+    if (!dir) {
+      stop("The cache directory '" + directory + "' cannot be created.");
+    }
+    closedir(dir);
+  }
+  if (!(max_size >= 0)) {
+    stop("max_size has to be a non-negative number of bytes.");
+  }
+  config.directory = directory;
+  config.max_size = max_size;
+  return cache_info();
+}
+
+//' Result Cache Information (exported to R)
+//'
+//' Shows the state of the result cache (see sim_cache()).
+//' @return A list with the directory ("" if the cache is disabled), the size limit, the number and total size of the cached results, and the hits and misses of this session.
+//' @examples
+//' sim_cache_info()
+//' @export
+// [[Rcpp::export]]
+List sim_cache_info() {
+  return cache_info();
+}
+
+//' Clear the Result Cache (exported to R)
+//'
+//' Deletes all results of the cache directory (see sim_cache()); the cache stays enabled.
+//' @return The number of deleted results.
+//' @examples
+//' sim_cache_clear()
+//' @export
+// [[Rcpp::export]]
+int sim_cache_clear() {
+  std::vector<cache_entry> entries = cache_entries();
+  int n = 0;
+  for (size_t i = 0; i < entries.size(); i++) {
+    if (std::remove(entries[i].path.c_str()) == 0) n++;
+  }
+  return n;
+}
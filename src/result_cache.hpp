@@ -0,0 +1,62 @@
+#ifndef RESULT_CACHE_HPP
+#define RESULT_CACHE_HPP
+
+#include <Rcpp.h>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+
+// Key of the on-disk result cache (see result_cache.cpp)
+// The key material is the fully resolved configuration of a run (engine, model, parameters, input data, simulation parameters and,
+// for stochastic runs, the state of R's random number generator), serialised with the length of every entry so that different
+// configurations never give the same bytes. Entries are stored under a 128 bit hash of the material and the material itself is
+// compared on every hit, so a hash collision cannot return a wrong result.
+class cache_key {
+public:
+  void add(const std::string &s) {
+    add_size(s.size());
+    bytes.insert(bytes.end(), s.begin(), s.end());
+  }
+  void add(const double *v, size_t n) {
+    add_size(n);
+    const unsigned char *p = reinterpret_cast<const unsigned char *>(v);
+    bytes.insert(bytes.end(), p, p + n*sizeof(double));
+  }
+  void add(const std::vector<double> &v) {
+    add(v.empty() ? 0 : &v[0], v.size());
+  }
+  // Numeric vectors (integers and logicals as doubles) and character vectors of an R object (other types only by their type)
+  void add(SEXP object);
+
+  // Hash of the material (32 hex digits, the file name of the entry)
+  std::string hash() const;
+
+  std::vector<unsigned char> bytes;
+
+private:
+  void add_size(uint64_t n) {
+    const unsigned char *p = reinterpret_cast<const unsigned char *>(&n);
+    bytes.insert(bytes.end(), p, p + sizeof(n));
+  }
+};
+
+// Whether results are cached for a run: the cache is enabled (sim_cache()) and the sim parameter "cache" is not FALSE
+bool cache_enabled(Rcpp::List user_sim_params);
+// Whether a run takes its random numbers from R's generator: stochastic runs ("ssa") without the sim parameter "seed"
+bool cache_uses_rng(const char *engine, Rcpp::List sim_params);
+// Key of a run of the per-model simulators (engine "ssa" or "ode"): the package and engine versions, all columns of the input data
+// frame, all simulation parameters (except "cache"), volumes, initial concentrations and reaction parameters; runs seeded by R's
+// generator (see cache_uses_rng()) add its state (.Random.seed) and return false if it has not been seeded yet (the result would not
+// be reproducible). Runs with a "seed" are keyed on the seed alone, whatever the state of R's generator.
+bool simulation_cache_key(const char *engine, const char *model, Rcpp::DataFrame input_df, Rcpp::List sim_params,
+                          Rcpp::NumericVector vols, Rcpp::NumericVector init_conc, const double *params, int nparams,
+                          cache_key &key);
+// Cached result of the key (copied from the memory-mapped entry, whose header stamps the time of use); stochastic entries restore
+// the state of R's generator after the run
+bool cache_lookup(const cache_key &key, Rcpp::DataFrame &result);
+// Stores a result (numeric columns) and, for runs seeded by R's generator (uses_rng), its current state; evicts the least recently
+// used entries beyond the size limit of the cache
+void cache_store(const cache_key &key, Rcpp::DataFrame result, bool uses_rng);
+
+#endif
@@ -0,0 +1,257 @@
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <Rcpp.h>
+#include "result_columns.hpp"
+#ifdef RESULT_ALTREP
+  #include <R_ext/Altrep.h>
+#endif
+using namespace Rcpp;
+
+
+#ifdef RESULT_ALTREP
+// ALTREP class of the result columns
+// data1: external pointer to the result_view (shares the output buffer with the other columns of the result, or the column source)
+// data2: the materialised column once R asked for its data pointer (the view is released then), NULL before
+static R_altrep_class_t result_column_class;
+
+static const result_view *column_view(SEXP x) {
+  return static_cast<const result_view *>(R_ExternalPtrAddr(R_altrep_data1(x)));
+}
+
+static R_xlen_t column_length(SEXP x) {
+  SEXP data = R_altrep_data2(x);
+  return Rf_isNull(data) ? column_view(x)->length : XLENGTH(data);
+}
+
+static double column_element(SEXP x, R_xlen_t i) {
+  SEXP data = R_altrep_data2(x);
+  return Rf_isNull(data) ? (*column_view(x))[i] : REAL(data)[i];
+}
+
+static R_xlen_t column_get_region(SEXP x, R_xlen_t from, R_xlen_t n, double *out) {
+  const R_xlen_t length = column_length(x);
+  if (from + n > length) n = length - from;
+  SEXP data = R_altrep_data2(x);
+  if (!Rf_isNull(data)) {
+    std::copy(REAL(data) + from, REAL(data) + from + n, out);
+    return n;
+  }
+  column_view(x)->region(from, n, out);
+  return n;
+}
+
+// Copy of the view as ordinary vector; the view (and with the last view of a result, the output buffer) is released
+static void *column_dataptr(SEXP x, Rboolean writeable) {
+  SEXP data = R_altrep_data2(x);
+  if (Rf_isNull(data)) {
+    R_xlen_t n = column_length(x);
+    data = PROTECT(Rf_allocVector(REALSXP, n));
+    column_get_region(x, 0, n, REAL(data));
+    R_set_altrep_data2(x, data);
+    UNPROTECT(1);
+    XPtr<result_view> view(R_altrep_data1(x));
+    view->values.reset();
+    view->source.reset();
+  }
+  return DATAPTR(data);
+}
+
+static const void *column_dataptr_or_null(SEXP x) {
+  SEXP data = R_altrep_data2(x);
+  return Rf_isNull(data) ? 0 : DATAPTR(data);
+}
+
+// Saved (saveRDS, save) as an ordinary vector
+static SEXP column_serialized_state(SEXP x) {
+  column_dataptr(x, FALSE);
+  return R_altrep_data2(x);
+}
+
+static SEXP column_unserialize(SEXP, SEXP state) {
+  return state;
+}
+
+static Rboolean column_inspect(SEXP x, int, int, int, void (*)(SEXP, int, int, int)) {
+  const char *state = !Rf_isNull(R_altrep_data2(x)) ? "materialised" :
+                      (column_view(x)->source ? "decoded on access" : "view of the native output buffer");
+  Rprintf(" simulation result column (%s)\n", state);
+  return TRUE;
+}
+
+#endif
+
+// Registers the ALTREP class when the package is loaded
+// [[Rcpp::init]]
+void result_columns_init(DllInfo *dll) {
+#ifdef RESULT_ALTREP
+  result_column_class = R_make_altreal_class("result_column", "CalciumModelsLibrary", dll);
+  R_set_altrep_Length_method(result_column_class, column_length);
+  R_set_altrep_Inspect_method(result_column_class, column_inspect);
+  R_set_altrep_Serialized_state_method(result_column_class, column_serialized_state);
+  R_set_altrep_Unserialize_method(result_column_class, column_unserialize);
+  R_set_altvec_Dataptr_method(result_column_class, column_dataptr);
+  R_set_altvec_Dataptr_or_null_method(result_column_class, column_dataptr_or_null);
+  R_set_altreal_Elt_method(result_column_class, column_element);
+  R_set_altreal_Get_region_method(result_column_class, column_get_region);
+#endif
+}
+
+
+SEXP result_column(const result_view &view) {
+#ifdef RESULT_ALTREP
+  XPtr<result_view> ptr(new result_view(view), true);
+  return R_new_altrep(result_column_class, ptr, R_NilValue);
+#else
+  NumericVector column(view.length);
+  if (view.length > 0) view.region(0, view.length, &column[0]);
+  return column;
+#endif
+}
+
+DataFrame result_frame(List columns, CharacterVector names, R_xlen_t nrow) {
+  columns.attr("names") = names;
+  columns.attr("class") = "data.frame";
+  columns.attr("row.names") = IntegerVector::create(NA_INTEGER, -(int)nrow);
+  return DataFrame(columns);
+}
+
+DataFrame result_frame(std::vector<double> &row_major, CharacterVector names, R_xlen_t nrow) {
+  std::shared_ptr<std::vector<double> > values(new std::vector<double>());
+  values->swap(row_major);
+  const int ncol = names.length();
+  List columns(ncol);
+  for (int c = 0; c < ncol; c++) {
+    columns[c] = result_column(result_view(values, nrow, c, ncol));
+  }
+  return result_frame(columns, names, nrow);
+}
+
+double column_elt(SEXP column, R_xlen_t i) {
+  if (TYPEOF(column) == INTSXP) {
+    int value = INTEGER(column)[i];
+    return (value == NA_INTEGER) ? NA_REAL : value;
+  }
+#ifdef RESULT_ALTREP
+  return REAL_ELT(column, i);
+#else
+  return REAL(column)[i];
+#endif
+}
+
+void column_region(SEXP column, R_xlen_t from, R_xlen_t n, double *out) {
+#ifdef RESULT_ALTREP
+  if (TYPEOF(column) == REALSXP) {
+    REAL_GET_REGION(column, from, n, out);
+    return;
+  }
+#endif
+  for (R_xlen_t i = 0; i < n; i++) {
+    out[i] = column_elt(column, from + i);
+  }
+}
+
+
+//' Resample Simulation Results (exported to R)
+//'
+//' Samples the trajectories of a simulation result at new output times, without simulating again. Results with a "replicate" column
+//' (ensembles) are resampled per replicate. The state of the stochastic simulation only changes at its reactions, so between two output
+//' times the value at the earlier one is used (method "constant", exact when the new times are output times or the trajectory is
+//' resampled to a coarser grid); "linear" interpolates between the output times (for the deterministic simulation; the calcium input
+//' "Ca" is piecewise constant and never interpolated). New times outside the simulated time span give NA. Only the rows needed for
+//' the new times are read, so the columns of large results (see sim_ensemble()) are not copied.
+//' @param result A dataframe: the result of a simulation (with the column "time" and optionally "replicate").
+//' @param times A numeric vector: the new output times [s].
+//' @param method A string: "constant" or "linear".
+//' @return A dataframe with the columns of the result at the new times (one block of rows per replicate).
+//' @examples
+//' ca <- data.frame(time = seq(0, 10, by = 0.01), Ca = 200)
+//' res <- sim_ensemble("calmodulin", ca, list(endTime = 10, timestep = 0.01), list(), nreplicates = 100)
+//' sim_resample(res, seq(0, 10, by = 0.5))
+//' @export
+// [[Rcpp::export]]
+DataFrame sim_resample(DataFrame result, NumericVector times, std::string method = "constant") {
+  if ((method != "constant") && (method != "linear")) {
+    stop("method has to be \"constant\" or \"linear\".");
+  }
+  if (!result.containsElementNamed("time")) {
+    stop("The result has no column \"time\".");
+  }
+  const bool linear = (method == "linear");
+  CharacterVector names = result.names();
+  const R_xlen_t nrow = (result.length() > 0) ? Rf_xlength(result[0]) : 0;
+  const R_xlen_t ntimes = times.length();
+  SEXP time = result["time"];
+  SEXP replicate = result.containsElementNamed("replicate") ? (SEXP)result["replicate"] : R_NilValue;
+  std::vector<int> numeric_columns;
+  for (int c = 0; c < result.length(); c++) {
+    int type = TYPEOF(result[c]);
+    if ((type == REALSXP) || (type == INTSXP)) numeric_columns.push_back(c);
+  }
+
+  // Rows of the replicates (consecutive rows with the same replicate number)
+  std::vector<R_xlen_t> starts;
+  for (R_xlen_t row = 0; row < nrow; row++) {
+    if ((row == 0) || (!Rf_isNull(replicate) && (column_elt(replicate, row) != column_elt(replicate, row - 1)))) starts.push_back(row);
+  }
+  starts.push_back(nrow);
+  const size_t ngroups = starts.size() - 1;
+
+  // Source row and interpolation weight of every new row (row < 0: outside the simulated time span)
+  std::vector<R_xlen_t> source((size_t)ngroups * ntimes);
+  std::vector<double> weight((size_t)ngroups * ntimes, 0.0);
+  for (size_t g = 0; g < ngroups; g++) {
+    const R_xlen_t first = starts[g], last = starts[g+1] - 1;
+    for (R_xlen_t k = 0; k < ntimes; k++) {
+      const double t = times[k];
+      R_xlen_t &row = source[g*ntimes + k];
+      if (!(t >= column_elt(time, first)) || !(t <= column_elt(time, last))) {
+        row = -1;
+        continue;
+      }
+      // last row with time <= t (binary search, the output times are increasing)
+      R_xlen_t lo = first, hi = last;
+      while (lo < hi) {
+        R_xlen_t mid = lo + (hi - lo + 1) / 2;
+        if (column_elt(time, mid) <= t) lo = mid; else hi = mid - 1;
+      }
+      row = lo;
+      if (linear && (lo < last)) {
+        double t0 = column_elt(time, lo), t1 = column_elt(time, lo + 1);
+        weight[g*ntimes + k] = (t1 > t0) ? (t - t0) / (t1 - t0) : 0.0;
+      }
+    }
+  }
+
+  // New columns (the replicate numbers and times are set directly; other columns interpolated)
+  const R_xlen_t nnew = (R_xlen_t)ngroups * ntimes;
+  List columns(numeric_columns.size());
+  CharacterVector column_names(numeric_columns.size());
+  for (size_t i = 0; i < numeric_columns.size(); i++) {
+    const int c = numeric_columns[i];
+    SEXP column = result[c];
+    const std::string name = as<std::string>(names[c]);
+    NumericVector values(nnew);
+    for (size_t g = 0; g < ngroups; g++) {
+      for (R_xlen_t k = 0; k < ntimes; k++) {
+        const size_t n = g*ntimes + k;
+        const R_xlen_t row = source[n];
+        if (name == "replicate") {
+          values[n] = column_elt(column, starts[g]);
+        } else if (name == "time") {
+          values[n] = times[k];
+        } else if (row < 0) {
+          values[n] = NA_REAL;
+        } else if ((weight[n] > 0) && (name != "Ca")) {
+          values[n] = (1.0 - weight[n]) * column_elt(column, row) + weight[n] * column_elt(column, row + 1);
+        } else {
+          values[n] = column_elt(column, row);
+        }
+      }
+    }
+    columns[i] = values;
+    column_names[i] = name;
+  }
+  return result_frame(columns, column_names, nnew);
+}
@@ -0,0 +1,71 @@
+#ifndef RESULT_COLUMNS_HPP
+#define RESULT_COLUMNS_HPP
+
+#include <vector>
+#include <memory>
+#include <Rcpp.h>
+#include <Rversion.h>
+
+
+// Result columns backed by the native output buffer of a simulation
+// With R >= 3.5 (ALTREP) the columns of a result dataframe are views into the buffer written by the engine: nothing is copied
+// until R needs the data pointer of a column (e.g. to modify it), and then only that column. Element access (x[i], subsetting,
+// summaries) and serialisation work on the view. Older R versions get ordinary copies of the columns.
+#if defined(R_VERSION) && (R_VERSION >= R_Version(3, 5, 0))
+  #define RESULT_ALTREP
+#endif
+
+// Values of a column that are decoded on access instead of being held in a buffer (e.g. a column of a result file, see
+// columnar_file.cpp). Only called on the R thread.
+class column_source {
+public:
+  virtual ~column_source() {}
+  virtual double element(R_xlen_t row) const = 0;
+  virtual void region(R_xlen_t from, R_xlen_t n, double *out) const = 0;
+};
+
+// View of a column: element row is values[offset + ((row / divide) % period) * stride] (period 0: no wrap around)
+// Species of a trajectory: offset = species, stride = number of species; the output times of an ensemble repeat with
+// period = number of output times; replicate numbers change every divide = number of output times rows.
+// Views of a source pass all accesses to the source.
+struct result_view {
+  std::shared_ptr<const std::vector<double> > values;
+  std::shared_ptr<const column_source> source;
+  size_t offset, stride, divide, period;
+  R_xlen_t length;
+
+  result_view(std::shared_ptr<const std::vector<double> > values, R_xlen_t length, size_t offset = 0, size_t stride = 1,
+              size_t divide = 1, size_t period = 0)
+    : values(values), offset(offset), stride(stride), divide(divide), period(period), length(length) {}
+  result_view(std::shared_ptr<const column_source> source, R_xlen_t length)
+    : source(source), offset(0), stride(1), divide(1), period(0), length(length) {}
+
+  double operator[](R_xlen_t row) const {
+    if (source) return source->element(row);
+    size_t k = (size_t)row / divide;
+    if (period) k %= period;
+    return (*values)[offset + k*stride];
+  }
+  void region(R_xlen_t from, R_xlen_t n, double *out) const {
+    if (source) {
+      source->region(from, n, out);
+      return;
+    }
+    for (R_xlen_t i = 0; i < n; i++) {
+      out[i] = (*this)[from + i];
+    }
+  }
+};
+
+// R vector of a view (ALTREP, or a copy without ALTREP)
+SEXP result_column(const result_view &view);
+// Dataframe of columns with the same number of rows (the columns are not touched, so views stay lazy)
+Rcpp::DataFrame result_frame(Rcpp::List columns, Rcpp::CharacterVector names, R_xlen_t nrow);
+// Dataframe of all columns of a row-major buffer (nrow x names.length()), which is moved into the shared buffer of the views
+Rcpp::DataFrame result_frame(std::vector<double> &row_major, Rcpp::CharacterVector names, R_xlen_t nrow);
+
+// Elements of any numeric column without materialising views (REAL_ELT/REAL_GET_REGION with ALTREP)
+double column_elt(SEXP column, R_xlen_t i);
+void column_region(SEXP column, R_xlen_t from, R_xlen_t n, double *out);
+
+#endif
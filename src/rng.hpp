@@ -0,0 +1,106 @@
+#ifndef RNG_HPP
+#define RNG_HPP
+
+#include <stdint.h>
+#include <cmath>
+
+
+// Native random number generator (xoshiro256**, Blackman & Vigna)
+// Used by the engines that cannot call R's generator (SIMD lanes, worker threads, checkpoints).
+// Every replicate gets its own stream derived from (seed, stream index), so results do not depend
+// on how replicates are grouped into SIMD lanes or distributed over threads.
+class Rng {
+public:
+  Rng() { seed(0, 0); }
+  Rng(uint64_t seed_value, uint64_t stream) { seed(seed_value, stream); }
+
+  void seed(uint64_t seed_value, uint64_t stream) {
+    uint64_t z = seed_value ^ (stream * 0xD1B54A32D192ED03ULL);
+    for (int i = 0; i < 4; i++) s[i] = splitmix64(z);
+  }
+
+  uint64_t next() {
+    uint64_t result = rotl(s[1] * 5, 7) * 9;
+    uint64_t t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl(s[3], 45);
+    return result;
+  }
+
+  // Uniform random number in the open interval (0,1) (safe to take the logarithm)
+  double uniform() {
+    return ((next() >> 11) + 0.5) * (1.0 / 9007199254740992.0);
+  }
+
+  // Exponentially distributed random number with rate 1
+  double exponential() {
+    return -log(uniform());
+  }
+
+  // Standard normally distributed random number (Box-Muller, one of the pair)
+  double normal() {
+    double u1 = uniform();
+    double u2 = uniform();
+    return sqrt(-2.0 * log(u1)) * cos(6.283185307179586 * u2);
+  }
+
+  // Poisson distributed random number with the given mean (multiplication of uniforms for small means,
+  // transformed rejection with squeeze (PTRS, Hoermann 1993) for large means)
+  double poisson(double mean) {
+    if (!(mean > 0)) return 0.0;
+    if (mean < 10) {
+      double limit = exp(-mean), p = uniform();
+      double k = 0;
+      while (p > limit) {
+        p *= uniform();
+        k++;
+      }
+      return k;
+    }
+    double slam = sqrt(mean), loglam = log(mean);
+    double b = 0.931 + 2.53 * slam;
+    double a = -0.059 + 0.02483 * b;
+    double invalpha = 1.1239 + 1.1328 / (b - 3.4);
+    double vr = 0.9277 - 3.6224 / (b - 2);
+    for (;;) {
+      double u = uniform() - 0.5;
+      double v = uniform();
+      double us = 0.5 - fabs(u);
+      double k = floor((2 * a / us + b) * u + mean + 0.43);
+      if ((us >= 0.07) && (v <= vr)) return k;
+      if ((k < 0) || ((us < 0.013) && (v > us))) continue;
+      if (log(v) + log(invalpha) - log(a / (us * us) + b) <= -mean + k * loglam - log_factorial(k)) return k;
+    }
+  }
+
+  // Raw state (for checkpoints)
+  uint64_t s[4];
+
+private:
+  // log(k!) for integer k >= 0: table for k < 10, Stirling series otherwise (absolute error < 1e-10).
+  // Replaces lgamma(), which writes the global signgam and is therefore not safe on worker threads.
+  static double log_factorial(double k) {
+    static const double table[10] = {
+      0.0, 0.0, 0.69314718055994531, 1.7917594692280550, 3.1780538303479458,
+      4.7874917427820458, 6.5792512120101010, 8.5251613610654143, 10.604602902745251, 12.801827480081469
+    };
+    if (k < 10) return table[(int)k];
+    double n = k + 1, r = 1 / (n * n);
+    return (n - 0.5) * log(n) - n + 0.91893853320467274 + (1.0 / 12 - r * (1.0 / 360 - r / 1260)) / n;
+  }
+  static uint64_t rotl(uint64_t x, int k) {
+    return (x << k) | (x >> (64 - k));
+  }
+  static uint64_t splitmix64(uint64_t &z) {
+    uint64_t r = (z += 0x9E3779B97F4A7C15ULL);
+    r = (r ^ (r >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    r = (r ^ (r >> 27)) * 0x94D049BB133111EBULL;
+    return r ^ (r >> 31);
+  }
+};
+
+#endif
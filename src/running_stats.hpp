@@ -0,0 +1,50 @@
+#ifndef RUNNING_STATS_HPP
+#define RUNNING_STATS_HPP
+
+#include <vector>
+#include <cstddef>
+#include <algorithm>
+
+
+// Running mean and variance of a vector of readouts (e.g. species at all output times) over replicates
+// Welford's update for single replicates, Chan's formula to merge partial statistics; merging the partial statistics of fixed
+// groups of replicates in a fixed order gives the same result for any number of threads.
+struct running_stats {
+  double n;
+  std::vector<double> mean, m2;   // mean and sum of squared deviations of each readout
+
+  running_stats(size_t nvalues = 0) : n(0), mean(nvalues, 0.0), m2(nvalues, 0.0) {}
+
+  void reset() {
+    n = 0;
+    std::fill(mean.begin(), mean.end(), 0.0);
+    std::fill(m2.begin(), m2.end(), 0.0);
+  }
+
+  void add(const double *values) {
+    n += 1;
+    for (size_t j = 0; j < mean.size(); j++) {
+      double d = values[j] - mean[j];
+      mean[j] += d / n;
+      m2[j] += d * (values[j] - mean[j]);
+    }
+  }
+
+  void merge(const running_stats &b) {
+    if (b.n == 0) return;
+    double total = n + b.n;
+    for (size_t j = 0; j < mean.size(); j++) {
+      double d = b.mean[j] - mean[j];
+      mean[j] += d * b.n / total;
+      m2[j] += b.m2[j] + d * d * n * b.n / total;
+    }
+    n = total;
+  }
+
+  // Sample variance of readout j
+  double variance(size_t j) const {
+    return (n > 1) ? m2[j] / (n - 1) : 0.0;
+  }
+};
+
+#endif
@@ -0,0 +1,352 @@
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <Rcpp.h>
+#include "evaluation.hpp"
+#include "parallel.hpp"
+#include "sim_params.hpp"
+using namespace Rcpp;
+
+
+// Sobol indices from the readouts of the Saltelli design (rows idx of A, B and the matrices AB_i with column i from B)
+// First order: Saltelli et al. 2010, S_i = mean(f_B (f_ABi - f_A)) / V; total order: Jansen 1999, ST_i = mean((f_A - f_ABi)^2) / (2V).
+static void sobol_indices(const std::vector<double> &y, int n, int k, const std::vector<int> &idx,
+                          std::vector<double> &first, std::vector<double> &total) {
+  const double *fA = &y[0];
+  const double *fB = &y[n];
+  double mean = 0.0, var = 0.0;
+  for (size_t r = 0; r < idx.size(); r++) mean += fA[idx[r]] + fB[idx[r]];
+  mean /= 2.0 * idx.size();
+  for (size_t r = 0; r < idx.size(); r++) {
+    var += (fA[idx[r]] - mean) * (fA[idx[r]] - mean) + (fB[idx[r]] - mean) * (fB[idx[r]] - mean);
+  }
+  var /= 2.0 * idx.size();
+  first.assign(k, NA_REAL);
+  total.assign(k, NA_REAL);
+  if (!(var > 0)) return;
+  for (int i = 0; i < k; i++) {
+    const double *fAB = &y[(size_t)(2 + i) * n];
+    double s = 0.0, st = 0.0;
+    for (size_t r = 0; r < idx.size(); r++) {
+      int j = idx[r];
+      s += fB[j] * (fAB[j] - fA[j]);
+      st += (fA[j] - fAB[j]) * (fA[j] - fAB[j]);
+    }
+    first[i] = s / idx.size() / var;
+    total[i] = st / idx.size() / (2.0 * var);
+  }
+}
+
+// Percentile of a sample (sorted in place)
+static double percentile(std::vector<double> &v, double p) {
+  std::sort(v.begin(), v.end());
+  double pos = p * (v.size() - 1);
+  size_t lo = (size_t)pos;
+  size_t hi = std::min(lo + 1, v.size() - 1);
+  return v[lo] + (pos - lo) * (v[hi] - v[lo]);
+}
+
+
+//' Sobol Sensitivity Analysis (exported to R)
+//'
+//' Computes first and total order Sobol indices of a readout of a model (e.g. the time average or the peak of a species) with respect to
+//' the given reaction parameters, which vary uniformly between lower and upper bounds. The parameter sets of the Saltelli design
+//' (two random sample matrices A and B and one matrix per parameter with its column from B; nsamples * (number of parameters + 2) evaluations)
+//' are simulated in parallel on native threads with the deterministic (reaction rate equations) or the stochastic model. The input,
+//' output times and fixed parameters are read once and shared by all evaluations. Confidence intervals are bootstrap percentile intervals.
+//' @param model A string: the name of the model ("ano", "calcineurin", "calmodulin", "camkii", "glycphos" or "pkc").
+//' @param input_df A Dataframe: the input Calcium time series (with at least two columns: "time" in s and "Ca" in nmol/l).
+//' @param input_sim_params A List: contains values for the simulation end ("endTime") and its timesteps ("timestep") or a vector of output times ("outputTimes"),
+//'                         and optionally the solver tolerances ("rtol", "atol") and a "seed" (sampling and stochastic simulation).
+//' @param input_model_params A List: the model specific parameters (the fixed values). Can contain up to three different vectors named "vols" (model volumes), "init_conc" (initial conditions) and "params" (reaction parameters).
+//' @param lower A named numeric vector: the lower bounds of the varied reaction parameters.
+//' @param upper A named numeric vector: the upper bounds of the varied reaction parameters (same names).
+//' @param species A string: the species of the readout.
+//' @param statistic A string: the readout of the species over the output times, "mean" (time average), "max" (peak) or "final".
+//' @param method A string: "ode" (deterministic) or "ssa" (stochastic, mean readout of nreplicates replicates per parameter set).
+//' @param nsamples An integer: the number of rows of the sample matrices.
+//' @param nboot An integer: the number of bootstrap resamples for the confidence intervals.
+//' @param nreplicates An integer: the number of stochastic replicates per parameter set (method "ssa").
+//' @param nthreads An integer: the number of threads (default: all hardware threads).
+//' @return A list with a dataframe "indices" (parameter, first order index S1 and total order index ST with 95 percent confidence intervals),
+//'         the "mean" and "variance" of the readout and the number of model evaluations ("nevaluations").
+//' @examples
+//' ca <- data.frame(time = seq(0, 20, by = 0.1), Ca = 500)
+//' sobol_sensitivity("calmodulin", ca, list(endTime = 20, timestep = 0.5), list(),
+//'                   lower = c(k_on = 0.01, k_off = 0.001), upper = c(k_on = 0.05, k_off = 0.01),
+//'                   species = "Prot_act", statistic = "max", nsamples = 500)
+//' @export
+// [[Rcpp::export]]
+List sobol_sensitivity(std::string model,
+                       DataFrame input_df,
+                       List input_sim_params,
+                       List input_model_params,
+                       NumericVector lower,
+                       NumericVector upper,
+                       std::string species,
+                       std::string statistic = "mean",
+                       std::string method = "ode",
+                       int nsamples = 1000,
+                       int nboot = 100,
+                       int nreplicates = 1,
+                       int nthreads = 0) {
+
+  // READ INPUT AND UPDATE DEFAULTS
+  if ((lower.length() == 0) || (lower.length() != upper.length()) || Rf_isNull(lower.names())) {
+    stop("lower and upper have to be named vectors of the same length.");
+  }
+  if (nsamples < 2) {
+    stop("nsamples has to be at least 2.");
+  }
+  CharacterVector names = lower.names();
+  const int k = lower.length();
+  std::vector<double> lo(k), hi(k);
+  for (int i = 0; i < k; i++) {
+    std::string name = as<std::string>(names[i]);
+    if (!upper.containsElementNamed(name.c_str())) {
+      stop("No upper bound for the parameter '" + name + "'.");
+    }
+    lo[i] = lower[i];
+    hi[i] = upper[name];
+    if (!(lo[i] <= hi[i])) {
+      stop("The lower bound of '" + name + "' is larger than its upper bound.");
+    }
+  }
+  model_evaluator ev = read_model_evaluator(model, input_df, input_sim_params, input_model_params, names,
+                                            species, statistic, method, nreplicates);
+
+  // Saltelli design: sample matrices A and B (random stream 0 of the seed)
+  const int n = nsamples;
+  Rng sampler(ev.seed, 0);
+  std::vector<double> A((size_t)n*k), B((size_t)n*k);
+  for (size_t j = 0; j < A.size(); j++) A[j] = lo[j % k] + (hi[j % k] - lo[j % k]) * sampler.uniform();
+  for (size_t j = 0; j < B.size(); j++) B[j] = lo[j % k] + (hi[j % k] - lo[j % k]) * sampler.uniform();
+
+  // RUN SIMULATIONS (evaluation e: rows of A, B, AB_1, ..., AB_k; the stochastic replicates use the streams after 0)
+  const int neval = n * (k + 2);
+  std::vector<double> y(neval);
+  nthreads = worker_threads(nthreads);
+  std::vector<sim_problem> problems(nthreads, ev.problem);
+  std::vector<std::vector<double> > values(nthreads, std::vector<double>(k));
+  parallel_for(neval, nthreads, [&](int e, int thread) {
+    int matrix = e / n, row = e % n;
+    double *v = &values[thread][0];
+    const double *base = (matrix == 1) ? &B[(size_t)row*k] : &A[(size_t)row*k];
+    std::copy(base, base + k, v);
+    if (matrix >= 2) v[matrix-2] = B[(size_t)row*k + matrix-2];
+    y[e] = ev(problems[thread], v, 1 + e);
+  }, &sim_check_interrupt);
+
+  // Indices and bootstrap confidence intervals
+  std::vector<int> idx(n);
+  for (int r = 0; r < n; r++) idx[r] = r;
+  std::vector<double> first, total;
+  sobol_indices(y, n, k, idx, first, total);
+  std::vector<std::vector<double> > boot_first(k), boot_total(k);
+  std::vector<double> bf, bt;
+  for (int b = 0; b < nboot; b++) {
+    for (int r = 0; r < n; r++) idx[r] = std::min(n - 1, (int)(sampler.uniform() * n));
+    sobol_indices(y, n, k, idx, bf, bt);
+    for (int i = 0; i < k; i++) {
+      boot_first[i].push_back(bf[i]);
+      boot_total[i].push_back(bt[i]);
+    }
+  }
+  NumericVector S1(k), S1_lower(k), S1_upper(k), ST(k), ST_lower(k), ST_upper(k);
+  for (int i = 0; i < k; i++) {
+    S1[i] = first[i];
+    ST[i] = total[i];
+    bool ci = (nboot > 1) && !ISNAN(first[i]);
+    S1_lower[i] = ci ? percentile(boot_first[i], 0.025) : NA_REAL;
+    S1_upper[i] = ci ? percentile(boot_first[i], 0.975) : NA_REAL;
+    ST_lower[i] = ci ? percentile(boot_total[i], 0.025) : NA_REAL;
+    ST_upper[i] = ci ? percentile(boot_total[i], 0.975) : NA_REAL;
+  }
+  double mean = 0.0, var = 0.0;
+  for (int j = 0; j < 2*n; j++) mean += y[j];
+  mean /= 2*n;
+  for (int j = 0; j < 2*n; j++) var += (y[j] - mean) * (y[j] - mean);
+  var /= 2*n;
+
+  DataFrame indices = DataFrame::create(_["parameter"] = names, _["S1"] = S1, _["S1_lower"] = S1_lower, _["S1_upper"] = S1_upper,
+                                        _["ST"] = ST, _["ST_lower"] = ST_lower, _["ST_upper"] = ST_upper,
+                                        _["stringsAsFactors"] = false);
+  return List::create(_["indices"] = indices, _["mean"] = mean, _["variance"] = var, _["nevaluations"] = neval);
+}
+
+
+//' Coupled Finite Difference Sensitivities (exported to R)
+//'
+//' Estimates the derivatives of the expected concentrations of all species at the output times with respect to reaction parameters
+//' from stochastic simulations. For every parameter and replicate, the simulation with the nominal parameters and the one with the
+//' parameter increased by a relative step are run as coupled processes in the same pass (common random numbers with split
+//' coupling of the reaction channels, see coupled_engine.hpp), so the forward differences have a much smaller variance than the
+//' differences of independent runs and need far fewer replicates for the same precision. All parameters use the same random number
+//' streams (the nominal paths are identical). Replicates run in parallel on native threads.
+//' @param model A string: the name of the model ("ano", "calcineurin", "calmodulin", "camkii", "glycphos" or "pkc").
+//' @param input_df A Dataframe: the input Calcium time series (with at least two columns: "time" in s and "Ca" in nmol/l).
+//' @param input_sim_params A List: contains values for the simulation end ("endTime") and its timesteps ("timestep") or a vector of output times ("outputTimes"),
+//'                         and optionally a "seed" and the warm start parameters (see sim_ensemble()).
+//' @param input_model_params A List: the model specific parameters (the nominal values). Can contain up to three different vectors named "vols" (model volumes), "init_conc" (initial conditions) and "params" (reaction parameters).
+//' @param params A character vector: the reaction parameters (default: all reaction parameters of the model).
+//' @param nreplicates An integer: the number of coupled replicates per parameter.
+//' @param rel_step A number: the perturbation relative to the nominal value of the parameter (absolute for parameters that are 0).
+//' @param nthreads An integer: the number of threads (default: all hardware threads).
+//' @return A named list with one dataframe per parameter: time, calcium, the derivative estimates of the concentrations of all species
+//'         and their variances (columns "[species]_var", variance of the mean over the replicates).
+//' @examples
+//' ca <- data.frame(time = seq(0, 20, by = 0.1), Ca = 500)
+//' sens <- sim_sensitivity("calmodulin", ca, list(endTime = 20, timestep = 0.5), list(), c("k_on", "k_off"), nreplicates = 200)
+//' plot(sens$k_on$time, sens$k_on$Prot_act, type = "l")
+//' @export
+// [[Rcpp::export]]
+List sim_sensitivity(std::string model,
+                     DataFrame input_df,
+                     List input_sim_params,
+                     List input_model_params,
+                     CharacterVector params = CharacterVector::create(),
+                     int nreplicates = 100,
+                     double rel_step = 0.01,
+                     int nthreads = 0) {
+
+  // READ INPUT AND UPDATE DEFAULTS
+  const model_info &info = find_model(model);
+  sim_problem pb = read_sim_problem(info, input_df, input_sim_params, input_model_params);
+  if (params.length() == 0) {
+    NumericVector default_params = info.default_params()["params"];
+    params = default_params.names();
+  }
+  if (nreplicates < 2) {
+    stop("nreplicates has to be at least 2.");
+  }
+  if (!(rel_step > 0)) {
+    stop("rel_step has to be positive.");
+  }
+  const int k = params.length();
+  std::vector<int> param_index(k);
+  std::vector<double> step(k);
+  for (int p = 0; p < k; p++) {
+    param_index[p] = find_param(info, as<std::string>(params[p]));
+    double nominal = pb.params[param_index[p]];
+    step[p] = (nominal != 0) ? rel_step * std::fabs(nominal) : rel_step;
+  }
+  const uint64_t seed = sim_seed(input_sim_params);
+  const int ns = info.nspecies;
+  const size_t noutput = pb.output_times.size();
+  const size_t nvalues = noutput * ns;
+
+  // RUN SIMULATIONS (task p*nreplicates + r: parameter p, replicate r on random number stream r)
+  nthreads = worker_threads(nthreads);
+  std::vector<std::vector<double> > sum(nthreads, std::vector<double>(k*nvalues, 0.0));
+  std::vector<std::vector<double> > sumsq(nthreads, std::vector<double>(k*nvalues, 0.0));
+  parallel_for(k*nreplicates, nthreads, [&](int task, int thread) {
+    const int p = task / nreplicates;
+    const int r = task % nreplicates;
+    std::vector<double> perturbed(pb.params);
+    perturbed[param_index[p]] += step[p];
+    ssa_state s = ssa_initial_state(pb, seed, r);
+    std::vector<double> xp(s.x);
+    double *out = thread_buffers().get(buffer_output, 2*nvalues);
+    info.coupled_simulator(pb, &perturbed[0], s, xp, out, out + nvalues);
+    double *acc = &sum[thread][p*nvalues];
+    double *accsq = &sumsq[thread][p*nvalues];
+    for (size_t j = 0; j < nvalues; j++) {
+      double d = (out[nvalues + j] - out[j]) / step[p];
+      acc[j] += d;
+      accsq[j] += d*d;
+    }
+  }, &sim_check_interrupt);
+
+  // Mean and variance of the mean of the finite differences
+  List result(k);
+  CharacterVector col_names(2*ns+2);
+  col_names[0] = "time";
+  col_names[1] = "Ca";
+  for (int i = 0; i < ns; i++) {
+    col_names[i+2] = info.species_names[i];
+    col_names[ns+i+2] = info.species_names[i] + "_var";
+  }
+  for (int p = 0; p < k; p++) {
+    NumericMatrix retval(noutput, 2*ns+2);
+    colnames(retval) = col_names;
+    for (int o = 0, n = 0; o < (int)noutput; o++) {
+      // calcium input interval of the output time
+      while ((n+1 < pb.ninput()) && (pb.input_time_at(n+1) <= pb.output_times[o])) n++;
+      retval(o, 0) = pb.output_times[o];
+      retval(o, 1) = pb.input_ca_at(n);
+      for (int i = 0; i < ns; i++) {
+        double s = 0.0, sq = 0.0;
+        for (int t = 0; t < nthreads; t++) {
+          s += sum[t][p*nvalues + o*ns + i];
+          sq += sumsq[t][p*nvalues + o*ns + i];
+        }
+        double mean = s / nreplicates;
+        retval(o, i+2) = mean;
+        retval(o, ns+i+2) = std::max(0.0, (sq - nreplicates*mean*mean) / (nreplicates - 1)) / nreplicates;
+      }
+    }
+    result[p] = DataFrame(retval);
+  }
+  result.names() = params;
+  return result;
+}
+
+
+//' Deterministic Sensitivities (exported to R)
+//'
+//' Computes the exact derivatives of the concentrations of all species at the output times with respect to reaction parameters
+//' and initial concentrations by integrating the forward sensitivity equations of the deterministic model together with the
+//' reaction rate equations (one solve for all variables; the parameter derivatives of the reaction rates are generated from the
+//' model definition by automatic differentiation).
+//' @param model A string: the name of the model ("ano", "calcineurin", "calmodulin", "camkii", "glycphos" or "pkc").
+//' @param input_df A Dataframe: the input Calcium time series (with at least two columns: "time" in s and "Ca" in nmol/l).
+//' @param input_sim_params A List: contains values for the simulation end ("endTime") and its timesteps ("timestep") or a vector of output times ("outputTimes"),
+//'                         and optionally the solver tolerances ("rtol", "atol"; default 1e-6 each).
+//' @param input_model_params A List: the model specific parameters. Can contain up to three different vectors named "vols" (model volumes), "init_conc" (initial conditions) and "params" (reaction parameters).
+//' @param params A character vector: the reaction parameters and species (initial concentrations) to differentiate by (default: all reaction parameters).
+//' @return A named list with one dataframe per parameter: time, calcium and the derivatives of the concentrations of all species.
+//' @examples
+//' ca <- data.frame(time = seq(0, 20, by = 0.1), Ca = 500)
+//' sens <- ode_sensitivity("calmodulin", ca, list(endTime = 20, timestep = 0.5), list(), c("k_on", "Prot_inact"))
+//' plot(sens$k_on$time, sens$k_on$Prot_act, type = "l")
+//' @export
+// [[Rcpp::export]]
+List ode_sensitivity(std::string model,
+                     DataFrame input_df,
+                     List input_sim_params,
+                     List input_model_params,
+                     CharacterVector params = CharacterVector::create()) {
+
+  // READ INPUT AND UPDATE DEFAULTS
+  const model_info &info = find_model(model);
+  sim_problem pb = read_sim_problem(info, input_df, input_sim_params, input_model_params);
+  if (params.length() == 0) {
+    NumericVector default_params = info.default_params()["params"];
+    params = default_params.names();
+  }
+  const int k = params.length();
+  std::vector<int> variables(k);
+  for (int v = 0; v < k; v++) {
+    variables[v] = find_variable(info, as<std::string>(params[v]));
+  }
+  double rtol = sim_param(input_sim_params, "rtol", 1e-6);
+  double atol = sim_param(input_sim_params, "atol", 1e-6);
+  const int ns = info.nspecies;
+  const size_t noutput = pb.output_times.size();
+
+  // RUN SIMULATION
+  std::vector<double> out(noutput*ns + 1), sens(noutput*k*ns + 1);
+  info.ode_sensitivity_simulator(pb, variables, rtol, atol, &out[0], &sens[0], &sim_check_interrupt);
+
+  // One trajectory frame of derivatives per variable
+  List result(k);
+  for (int v = 0; v < k; v++) {
+    for (size_t o = 0; o < noutput; o++) {
+      std::copy(&sens[(o*k + v)*ns], &sens[(o*k + v)*ns] + ns, &out[o*ns]);
+    }
+    result[v] = trajectory_frame(info, pb, &out[0]);
+  }
+  result.names() = params;
+  return result;
+}
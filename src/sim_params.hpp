@@ -0,0 +1,137 @@
+#ifndef SIM_PARAMS_HPP
+#define SIM_PARAMS_HPP
+
+#include <Rcpp.h>
+#include <vector>
+#include <cmath>
+#include <chrono>
+#include <stdint.h>
+#include "input_signals.hpp"
+#include "stimulus.hpp"
+
+
+// Wall-clock time of the last interrupt check and the interval between checks [ms] (R thread only)
+struct sim_interrupt_clock {
+  std::chrono::steady_clock::time_point last;
+  double interval;
+};
+inline sim_interrupt_clock &interrupt_clock() {
+  static sim_interrupt_clock clock = {std::chrono::steady_clock::time_point(), 0.0};
+  return clock;
+}
+
+// Interrupt check for the native engines (throws instead of jumping, so the C++ objects of the engine are cleaned up)
+// The engines call it every ssa_check_events reactions or block of work; R is only asked once the interval of the R option
+// "CalciumModelsLibrary.interrupt_ms" (default 100 ms of wall-clock time) has passed since the last check, otherwise
+// the check costs one clock read.
+static void sim_check_interrupt() {
+  sim_interrupt_clock &clock = interrupt_clock();
+  std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+  if (std::chrono::duration<double, std::milli>(now - clock.last).count() < clock.interval) return;
+  clock.last = now;
+  SEXP interval = Rf_GetOption1(Rf_install("CalciumModelsLibrary.interrupt_ms"));
+  clock.interval = (Rf_isNumeric(interval) && (Rf_length(interval) == 1) && (Rf_asReal(interval) >= 0)) ? Rf_asReal(interval) : 100.0;
+  Rcpp::checkUserInterrupt();
+}
+
+// Optional numeric simulation parameter (default value if the user did not supply it)
+static double sim_param(Rcpp::List user_sim_params, const char *name, double default_value) {
+  if (user_sim_params.containsElementNamed(name)) {
+    return Rcpp::as<double>(user_sim_params[name]);
+  }
+  return default_value;
+}
+
+// Simulation output times (same rules as the stochastic simulator):
+// 1.) a user supplied vector "outputTimes" or
+// 2.) evenly spaced times from the start of the input to "endTime" (default 100) with spacing "timestep" (default 0.01)
+static std::vector<double> sim_output_times(Rcpp::List user_sim_params, double startTime) {
+  std::vector<double> output_times;
+  if (user_sim_params.containsElementNamed("outputTimes")) {
+    Rcpp::NumericVector user_output_times_vector = user_sim_params["outputTimes"];
+    output_times.assign(user_output_times_vector.begin(), user_output_times_vector.end());
+  } else {
+    double output_timestep = sim_param(user_sim_params, "timestep", 0.01);
+    double endTime = sim_param(user_sim_params, "endTime", 100);
+    int nintervals = (int)floor((endTime-startTime)/output_timestep+0.5)+1;
+    for (int k = 0; k < nintervals; k++) {
+      output_times.push_back(startTime + k*output_timestep);
+    }
+  }
+  return output_times;
+}
+
+// Input signals: columns of the input data frame named like one of the declared model inputs
+// (param_index: position of each declared input in the parameter array). Inputs without a column keep their parameter value.
+static input_signals read_input_signals(Rcpp::DataFrame user_input_df, const char **names, const int *param_index, int n) {
+  input_signals inputs;
+  for (int i = 0; i < n; i++) {
+    if (user_input_df.containsElementNamed(names[i])) {
+      Rcpp::NumericVector column = user_input_df[names[i]];
+      inputs.param_index.push_back(param_index[i]);
+      inputs.values.push_back(std::vector<double>(column.begin(), column.end()));
+    }
+  }
+  return inputs;
+}
+
+// Seed given by the user: a whole number in [0, 2^53] (converting negative or non-finite doubles to uint64_t is undefined)
+static uint64_t seed_value(SEXP seed) {
+  const double value = Rcpp::as<double>(seed);
+  if (!(value >= 0) || !(value <= 9007199254740992.0) || (value != std::floor(value))) {
+    Rcpp::stop("The seed has to be a whole number between 0 and 2^53.");
+  }
+  return (uint64_t)value;
+}
+
+// Procedural calcium input from a list of sim_stimulus() (see stimulus.hpp)
+static stimulus read_stimulus(Rcpp::List stimulus_list) {
+  static const char *types[] = { "noise", "sine", "pulses", "spikes", "bursts" };
+  if (!Rf_inherits(stimulus_list, "sim_stimulus")) {
+    Rcpp::stop("The stimulus has to be created by sim_stimulus().");
+  }
+  stimulus g;
+  std::string type = Rcpp::as<std::string>(stimulus_list["type"]);
+  for (int t = 0; t < 5; t++) {
+    if (type == types[t]) g.type = (stimulus_type)(stimulus_noise + t);
+  }
+  g.start = sim_param(stimulus_list, "start", g.start);
+  g.origin = g.start;
+  g.resolution = sim_param(stimulus_list, "resolution", g.resolution);
+  g.baseline = sim_param(stimulus_list, "baseline", g.baseline);
+  g.amplitude = sim_param(stimulus_list, "amplitude", g.amplitude);
+  g.frequency = sim_param(stimulus_list, "frequency", g.frequency);
+  g.phase = sim_param(stimulus_list, "phase", g.phase);
+  g.duty = sim_param(stimulus_list, "duty", g.duty);
+  g.tau = sim_param(stimulus_list, "tau", g.tau);
+  g.width = sim_param(stimulus_list, "width", g.width);
+  g.noise = sim_param(stimulus_list, "noise", g.noise);
+  g.seed = stimulus_list.containsElementNamed("seed") ? seed_value(stimulus_list["seed"]) : 0;
+  if (!g.active() || !(g.resolution > 0) || !(g.frequency > 0) || !(g.tau > 0) || !(g.width >= 0) || !(g.noise >= 0)) {
+    Rcpp::stop("Invalid stimulus (see sim_stimulus()).");
+  }
+  return g;
+}
+
+// Procedural calcium input of the simulation parameters ("stimulus"), inactive without it
+static stimulus sim_stimulus_param(Rcpp::List user_sim_params) {
+  if (user_sim_params.containsElementNamed("stimulus")) {
+    return read_stimulus(Rcpp::as<Rcpp::List>(user_sim_params["stimulus"]));
+  }
+  return stimulus();
+}
+
+// Seed of the native random number generator (rng.hpp): the "seed" simulation parameter if given,
+// otherwise drawn from R's generator (so set.seed() makes the results reproducible)
+static uint64_t sim_seed(Rcpp::List user_sim_params) {
+  if (user_sim_params.containsElementNamed("seed")) {
+    return seed_value(user_sim_params["seed"]);
+  }
+  GetRNGstate();
+  uint64_t hi = (uint64_t)(unif_rand() * 4294967296.0);
+  uint64_t lo = (uint64_t)(unif_rand() * 4294967296.0);
+  PutRNGstate();
+  return (hi << 32) | lo;
+}
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef SIM_PROBLEM_HPP
+#define SIM_PROBLEM_HPP
+
+#include <vector>
+#include <algorithm>
+#include "input_signals.hpp"
+#include "stimulus.hpp"
+#include "rng.hpp"
+
+
+// Simulation problem of the native engines (plain C++ types only, the engines do not touch R objects)
+struct sim_problem {
+  std::vector<double> input_time;   // start times of the piecewise constant calcium input intervals [s]
+  std::vector<double> input_ca;     // calcium concentration on each input interval [nmol/l]
+  std::vector<double> output_times; // sim output times [s] (the simulation ends at the last one)
+  std::vector<double> params;       // reaction parameters (in model definition order)
+  input_signals inputs;             // parameters given as input signals (piecewise constant like calcium)
+  std::vector<double> x0;           // initial particle numbers
+  std::vector<double> x0_pool;      // optional equilibrated initial states to draw from (nstates*nspecies, see warm_start.hpp)
+  std::vector<double> c0;           // initial concentrations (deterministic engine)
+  double f;                         // conversion factor particle numbers/concentration
+  stimulus generator;               // procedural calcium input, replaces input_time and input_ca if active (see stimulus.hpp)
+
+  double end_time() const {
+    return output_times.empty() ? input_time_at(0) : output_times.back();
+  }
+  // Calcium input: number of intervals, start and concentration of interval k, interval of time t (the engines only use these)
+  int ninput() const {
+    return generator.active() ? generator.intervals(end_time()) : (int)input_time.size();
+  }
+  double input_time_at(int k) const {
+    return generator.active() ? generator.time(k) : input_time[k];
+  }
+  double input_ca_at(int k) const {
+    return generator.active() ? generator.value(k) : input_ca[k];
+  }
+  int input_interval(double t) const {
+    if (generator.active()) return std::min(generator.interval(t), ninput() - 1);
+    int k = std::upper_bound(input_time.begin(), input_time.end(), t) - input_time.begin();
+    return (k > 0) ? k - 1 : 0;
+  }
+  // Initial particle numbers of a run: x0, or a state drawn from x0_pool with the random number stream of the run
+  const double *initial_state(Rng &rng) const {
+    if (x0_pool.empty()) return &x0[0];
+    size_t nstates = x0_pool.size() / x0.size();
+    size_t k = std::min(nstates - 1, (size_t)(rng.uniform() * nstates));
+    return &x0_pool[k * x0.size()];
+  }
+  // End of input interval k (limited to the end of the simulation)
+  double interval_end(int k) const {
+    double end = end_time();
+    if (generator.active()) return std::min(generator.time(k+1), end);
+    return ((k+1 < (int)input_time.size()) && (input_time[k+1] < end)) ? input_time[k+1] : end;
+  }
+};
+
+#endif
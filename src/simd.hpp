@@ -0,0 +1,68 @@
+#ifndef SIMD_HPP
+#define SIMD_HPP
+
+#include <cmath>
+
+
+// SIMD lanes for the ensemble simulator
+// Lanes holds one double per replicate. The propensity templates of the models are instantiated with Lanes, so the propensities
+// of SIMD_LANES replicates are computed with one pass of vector instructions (AVX-512: 8 lanes, AVX2/AVX or SSE2: 4 lanes).
+// gcc and clang translate the vector extension type into the widest instructions enabled at compile time
+// (e.g. PKG_CXXFLAGS = -mavx2 or -march=native in ~/.R/Makevars); other compilers use the scalar fallback loops.
+#if defined(__AVX512F__)
+  #define SIMD_LANES 8
+#else
+  #define SIMD_LANES 4
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+  #define SIMD_VECTOR_EXTENSIONS
+  typedef double simd_vec __attribute__((vector_size(SIMD_LANES * sizeof(double))));
+  #define LANES_BINARY_OP(op) r.v = a.v op b.v;
+#else
+  #define LANES_BINARY_OP(op) for (int i = 0; i < SIMD_LANES; i++) r.v[i] = a.v[i] op b.v[i];
+#endif
+
+struct Lanes {
+#ifdef SIMD_VECTOR_EXTENSIONS
+  simd_vec v;
+#else
+  double v[SIMD_LANES];
+#endif
+
+  Lanes() {
+    for (int i = 0; i < SIMD_LANES; i++) v[i] = 0.0;
+  }
+  // Broadcast of a scalar to all lanes
+  Lanes(double value) {
+    for (int i = 0; i < SIMD_LANES; i++) v[i] = value;
+  }
+  double operator[](int lane) const { return v[lane]; }
+  void set(int lane, double value) { v[lane] = value; }
+};
+
+inline Lanes operator+(const Lanes &a, const Lanes &b) { Lanes r; LANES_BINARY_OP(+) return r; }
+inline Lanes operator-(const Lanes &a, const Lanes &b) { Lanes r; LANES_BINARY_OP(-) return r; }
+inline Lanes operator*(const Lanes &a, const Lanes &b) { Lanes r; LANES_BINARY_OP(*) return r; }
+inline Lanes operator/(const Lanes &a, const Lanes &b) { Lanes r; LANES_BINARY_OP(/) return r; }
+inline Lanes operator-(const Lanes &a) { return Lanes(0.0) - a; }
+inline Lanes &operator+=(Lanes &a, const Lanes &b) { a = a + b; return a; }
+
+// Elementary functions (lane by lane; only used by models with state dependent powers or exponentials)
+inline Lanes pow(const Lanes &a, double p) {
+  Lanes r;
+  for (int i = 0; i < SIMD_LANES; i++) r.v[i] = std::pow(a.v[i], p);
+  return r;
+}
+inline Lanes exp(const Lanes &a) {
+  Lanes r;
+  for (int i = 0; i < SIMD_LANES; i++) r.v[i] = std::exp(a.v[i]);
+  return r;
+}
+inline Lanes log(const Lanes &a) {
+  Lanes r;
+  for (int i = 0; i < SIMD_LANES; i++) r.v[i] = std::log(a.v[i]);
+  return r;
+}
+
+#endif
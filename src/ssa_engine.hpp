@@ -0,0 +1,144 @@
+#ifndef SSA_ENGINE_HPP
+#define SSA_ENGINE_HPP
+
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <stdint.h>
+#include "rng.hpp"
+#include "sim_problem.hpp"
+#include "stop_conditions.hpp"
+#include "event_log.hpp"
+#include "buffer_pool.hpp"
+
+
+// Complete state of a single stochastic simulation run
+// Everything the simulation loop needs to continue lives here (no locals or globals), so a run can be
+// stopped, written to a checkpoint and continued bit-identically, or copied to start new replicates.
+struct ssa_state {
+  std::vector<double> x;   // particle numbers
+  double time;             // current simulation time
+  int ntimepoint;          // input cursor (current input interval)
+  int noutput;             // output cursor (next output time to record)
+  double budget;           // integrated total propensity left until the next reaction (< 0: draw a new one)
+  uint64_t nevents;        // number of reactions fired so far
+  Rng rng;
+
+  bool finished(const sim_problem &pb) const { return time >= pb.end_time(); }
+};
+
+// Number of reactions between two interrupt/progress checks of the callers (the engine itself never calls back)
+static const uint64_t ssa_check_events = 65536;
+
+// Initial state at the start of the input
+inline ssa_state ssa_initial_state(const sim_problem &pb, uint64_t seed, uint64_t stream) {
+  ssa_state s;
+  s.rng.seed(seed, stream);
+  const double *x0 = pb.initial_state(s.rng);
+  s.x.assign(x0, x0 + pb.x0.size());
+  s.time = pb.input_time_at(0);
+  s.ntimepoint = 0;
+  s.noutput = 0;
+  s.budget = -1.0;
+  s.nevents = 0;
+  return s;
+}
+
+
+// Stochastic Simulator (Gillespie's Direct Method) on an explicit run state
+// Kernel is the compile time model description generated by model_definition.hpp (see ensemble_simulator.hpp).
+// Advances the state s until the simulation time reaches 'until' (or the end of the simulation) or max_events reactions have fired,
+// and writes the concentrations at all output times passed on the way to out[output*nspecies + species] (out holds all output times).
+// The waiting time is drawn as integrated total propensity and used up across input intervals (exact for piecewise constant input).
+// The loop only stops at reactions or input time points, where the state is complete, so splitting a run into several
+// calls gives exactly the same trajectory as a single call.
+// stop (may be null): the run also stops right after the reaction that meets one of the conditions (first passage), s.time is then
+// the exact hitting time; output times after it are not written. The caller checks the initial state.
+// events (may be null): every reaction is appended to the log (exact jump trajectory, see event_log.hpp).
+template <class Kernel>
+void ssa_simulator(const sim_problem &pb, ssa_state &s, double until, double *out, uint64_t max_events, const stop_conditions *stop,
+                   event_log *events) {
+  const int ns = Kernel::nspecies;
+  const int nr = Kernel::nreactions;
+  const double *stM = Kernel::stoichiometry();
+  const int noutput = pb.output_times.size();
+  const double endTime = pb.end_time();
+  // parameters of the current input interval (per-thread buffer: no allocation per call, see buffer_pool.hpp)
+  double *params = thread_buffers().get(buffer_params, pb.params.size());
+  std::copy(pb.params.begin(), pb.params.end(), params);
+  typename Kernel::factors_type factors;
+  double rate[nr];
+  double cum[nr];
+
+  // Write the current state to all output times before 'before'
+  auto record = [&](double before) {
+    while ((s.noutput < noutput) && (pb.output_times[s.noutput] < before)) {
+      for (int i = 0; i < ns; i++) {
+        out[(size_t)s.noutput*ns + i] = s.x[i] / pb.f;
+      }
+      s.noutput++;
+    }
+  };
+
+  double Ca = pb.input_ca_at(s.ntimepoint);
+  pb.inputs.apply(params, s.ntimepoint);
+  Kernel::prepare(params, Ca, factors);
+  bool rates_current = false;
+  const uint64_t last_event = (max_events < UINT64_MAX - s.nevents) ? s.nevents + max_events : UINT64_MAX;
+
+  /* SIMULATION LOOP */
+  while ((s.time < endTime) && (s.time < until) && (s.nevents < last_event)) {
+    // Calculate propensities (only after a reaction or an input change)
+    if (!rates_current) {
+      Kernel::rates(params, factors, Ca, &s.x[0], pb.f, rate);
+      cum[0] = rate[0];
+      for (int j = 1; j < nr; j++) {
+        cum[j] = cum[j-1] + rate[j];
+      }
+      rates_current = true;
+    }
+    double total = cum[nr-1];
+    if (s.budget < 0) s.budget = s.rng.exponential();
+    double interval_end = pb.interval_end(s.ntimepoint);
+    double newTime = s.time + s.budget / total;
+    // No reaction in this input interval: use up the budget and move on to the next interval
+    if (!(newTime < interval_end)) {
+      s.budget -= total * (interval_end - s.time);
+      record(interval_end);
+      s.time = interval_end;
+      if (s.time < endTime) {
+        s.ntimepoint++;
+        const double next_Ca = pb.input_ca_at(s.ntimepoint);
+        if ((next_Ca != Ca) || pb.inputs.changes_at(s.ntimepoint)) {
+          Ca = next_Ca;
+          pb.inputs.apply(params, s.ntimepoint);
+          Kernel::prepare(params, Ca, factors);
+          rates_current = false;
+        }
+      }
+      continue;
+    }
+    // Update output (state before the reaction) and propagate time
+    record(newTime);
+    s.time = newTime;
+    s.budget = -1.0;
+    // Select reaction to fire
+    double r2 = total * s.rng.uniform();
+    int rIndex = 0;
+    while ((rIndex < nr-1) && (cum[rIndex] < r2)) rIndex++;
+    // Update system state
+    for (int i = 0; i < ns; i++) {
+      s.x[i] += stM[i*nr+rIndex];
+    }
+    s.nevents++;
+    if (events) events->add(s.time, rIndex);
+    rates_current = false;
+    if (stop && (stop->met(&s.x[0]) >= 0)) break;
+  }
+  // Output times at the end of the simulation
+  if (s.time >= endTime) {
+    record(HUGE_VAL);
+  }
+}
+
+#endif
@@ -0,0 +1,86 @@
+#include <string>
+#include <vector>
+#include <Rcpp.h>
+#include "sim_params.hpp"
+using namespace Rcpp;
+
+
+//' Procedural Calcium Input (exported to R)
+//'
+//' Describes a synthetic calcium input by a few numbers instead of a time series. Passed as "stimulus" in the sim params of the
+//' simulators (sim_<model>(), detSim_<model>(), sim_ensemble(), ...; the input data frame is not used then), the input is
+//' evaluated by the engine at the start of every input interval and never stored: interval k starts at start + k*resolution and
+//' the calcium concentration on it is the signal at this time, exactly like a data frame with these rows (see sim_stimulus_frame()).
+//' The signals go from the baseline to baseline + amplitude (c: cycles since the start, (time - start)*frequency + phase/(2*pi)):
+//' * "sine": baseline + amplitude*(1 + sin(2*pi*c))/2
+//' * "pulses": baseline + amplitude during the first duty fraction of every cycle (a square wave for duty = 0.5)
+//' * "spikes": a spike at every cycle start, each adding amplitude*exp(-time since the spike/tau)
+//' * "bursts": baseline + amplitude during bursts of length width, starting at random times (Poisson process with rate frequency)
+//' * "noise": the baseline
+//'
+//' Every type adds independent normal noise with standard deviation noise to each interval; concentrations below 0 are set to 0.
+//' @param type A string: "sine", "pulses", "spikes", "bursts" or "noise".
+//' @param baseline A number: the baseline calcium concentration [nmol/l].
+//' @param amplitude A number: the amplitude above the baseline [nmol/l].
+//' @param frequency A number: the frequency [Hz] (rate of the bursts).
+//' @param duty A number: the fraction of the cycle with high calcium ("pulses").
+//' @param phase A number: the phase at the start [rad].
+//' @param tau A number: the decay time of the spikes [s].
+//' @param width A number: the length of the bursts [s].
+//' @param noise A number: the standard deviation of the noise [nmol/l].
+//' @param resolution A number: the length of the input intervals [s].
+//' @param start A number: the start of the input [s].
+//' @param seed A number: the seed of the noise and the burst times (default: drawn from R's generator, so set.seed() makes it reproducible).
+//' @return A list of class "sim_stimulus".
+//' @md
+//' @examples
+//' stim <- sim_stimulus("pulses", baseline = 100, amplitude = 900, frequency = 0.5, duty = 0.2)
+//' result <- sim_camkii(data.frame(), list(endTime = 60, timestep = 0.1, stimulus = stim), list())
+//' @export
+// [[Rcpp::export]]
+List sim_stimulus(std::string type,
+                  double baseline = 100,
+                  double amplitude = 1000,
+                  double frequency = 1,
+                  double duty = 0.5,
+                  double phase = 0,
+                  double tau = 0.1,
+                  double width = 0.1,
+                  double noise = 0,
+                  double resolution = 1e-3,
+                  double start = 0,
+                  double seed = NA_REAL) {
+  if (ISNAN(seed)) {
+    seed = (double)(sim_seed(List()) >> 11);
+  }
+  List result = List::create(_["type"] = type, _["baseline"] = baseline, _["amplitude"] = amplitude, _["frequency"] = frequency,
+                             _["duty"] = duty, _["phase"] = phase, _["tau"] = tau, _["width"] = width, _["noise"] = noise,
+                             _["resolution"] = resolution, _["start"] = start, _["seed"] = seed);
+  result.attr("class") = "sim_stimulus";
+  read_stimulus(result);
+  return result;
+}
+
+//' Time Series of a Procedural Calcium Input (exported to R)
+//'
+//' Evaluates a procedural calcium input (see sim_stimulus()) like the engines do: the rows are the input intervals up to the end time
+//' with their start times and calcium concentrations. Used as input data frame it gives the same simulation results as the stimulus.
+//' @param stimulus A list of sim_stimulus().
+//' @param end A number: the end of the input [s].
+//' @return A dataframe with the columns "time" and "Ca".
+//' @examples
+//' stim <- sim_stimulus("spikes", baseline = 50, amplitude = 500, frequency = 2, tau = 0.2)
+//' plot(sim_stimulus_frame(stim, 5), type = "s")
+//' @export
+// [[Rcpp::export]]
+DataFrame sim_stimulus_frame(List stimulus, double end) {
+  struct stimulus g = read_stimulus(stimulus);
+  g.prepare(end);
+  const int n = g.intervals(end);
+  NumericVector time(n), ca(n);
+  for (int k = 0; k < n; k++) {
+    time[k] = g.time(k);
+    ca[k] = g.value(k);
+  }
+  return DataFrame::create(_["time"] = time, _["Ca"] = ca);
+}
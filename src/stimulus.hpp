@@ -0,0 +1,117 @@
+#ifndef STIMULUS_HPP
+#define STIMULUS_HPP
+
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <stdint.h>
+#include "rng.hpp"
+
+
+// Procedural calcium input (see stimulus.cpp)
+// Instead of a time series the engines evaluate the input on demand: input interval k starts at start + k*resolution and the
+// calcium concentration on it is the signal at this time (plus the noise of the interval). The input is piecewise constant exactly
+// like a data frame with these rows, without storing it: a run over 1000 s at 1 ms takes 16 MB as data frame and nothing here.
+// The signals go from the baseline to baseline + amplitude (c: cycles since the origin, c = (t - origin)*frequency + phase/(2*pi),
+// the origin is the start unless a run is split into parts):
+enum stimulus_type {
+  stimulus_none,     // input from the time series of the problem
+  stimulus_noise,    // baseline (+ noise)
+  stimulus_sine,     // baseline + amplitude*(1 + sin(2*pi*c))/2
+  stimulus_pulses,   // baseline + amplitude during the first duty fraction of every cycle (square wave at duty = 0.5)
+  stimulus_spikes,   // baseline + amplitude*exp(-time since the spike/tau) summed over the spikes at integer c
+  stimulus_bursts    // baseline + amplitude during bursts of length width starting at random times (Poisson process, rate frequency)
+};
+
+struct stimulus {
+  stimulus_type type;
+  double start, resolution;   // [s]
+  double origin;              // time of c = phase/(2*pi) [s]
+  double baseline, amplitude; // [nmol/l]
+  double frequency;           // [Hz]
+  double phase;               // [rad]
+  double duty;                // fraction of the cycle
+  double tau, width;          // decay time of the spikes, length of the bursts [s]
+  double noise;               // standard deviation of the (independent, normal) noise of every interval [nmol/l]
+  uint64_t seed;              // random numbers of the noise and the burst times
+  std::vector<double> burst_on, burst_off;   // burst times (merged if overlapping), drawn by prepare()
+
+  stimulus() : type(stimulus_none), start(0), resolution(1e-3), origin(0), baseline(0), amplitude(0), frequency(1), phase(0), duty(0.5),
+               tau(0.1), width(0.1), noise(0), seed(0) {}
+
+  bool active() const { return type != stimulus_none; }
+
+  // Number of input intervals up to the end of the simulation
+  int intervals(double end) const {
+    double n = std::ceil((end - start) / resolution - 1e-9);
+    return (n > 1) ? (int)std::min(n, 2147483647.0) : 1;
+  }
+  double time(int k) const { return start + k * resolution; }
+  // Input interval of time t (the last one starting at or before t)
+  int interval(double t) const {
+    int k = std::max(0, (int)std::floor((t - start) / resolution));
+    while (time(k + 1) <= t) k++;
+    while ((k > 0) && (time(k) > t)) k--;
+    return k;
+  }
+
+  // Calcium concentration on input interval k (never negative)
+  double value(int k) const {
+    const double t = time(k);
+    const double c = (t - origin) * frequency + phase / 6.283185307179586;
+    // completed cycles and fraction of the current one (c is rounded: cycle starts on the grid are not missed)
+    const double cycles = std::floor(c + 1e-9 * std::max(1.0, std::fabs(c)));
+    const double fraction = std::max(0.0, c - cycles);
+    double ca = baseline;
+    switch (type) {
+    case stimulus_sine:
+      ca += amplitude * 0.5 * (1.0 + std::sin(6.283185307179586 * c));
+      break;
+    case stimulus_pulses:
+      if (fraction < duty - 1e-9) ca += amplitude;
+      break;
+    case stimulus_spikes: {
+      // spikes at c = first, first+1, ..., cycles: geometric sum of their decays
+      const double first = std::ceil(phase / 6.283185307179586 - 1e-9);
+      const double n = cycles - first + 1;
+      if (n >= 1) {
+        const double r = std::exp(-1.0 / (frequency * tau));
+        const double last = std::exp(-fraction / (frequency * tau));
+        ca += amplitude * last * ((r < 1) ? (1.0 - std::pow(r, n)) / (1.0 - r) : n);
+      }
+      break;
+    }
+    case stimulus_bursts: {
+      size_t b = std::upper_bound(burst_on.begin(), burst_on.end(), t) - burst_on.begin();
+      if ((b > 0) && (t < burst_off[b-1])) ca += amplitude;
+      break;
+    }
+    default:
+      break;
+    }
+    if (noise > 0) {
+      // counter based: the noise of an interval does not depend on the order of evaluation
+      Rng rng(seed, (uint64_t)k + 1);
+      ca += noise * rng.normal();
+    }
+    return std::max(ca, 0.0);
+  }
+
+  // Draws the burst times up to the end of the simulation (random number stream 0 of the seed)
+  void prepare(double end) {
+    burst_on.clear();
+    burst_off.clear();
+    if ((type != stimulus_bursts) || !(frequency > 0)) return;
+    Rng rng(seed, 0);
+    for (double t = start + rng.exponential() / frequency; t < end; t += rng.exponential() / frequency) {
+      if (!burst_off.empty() && (t <= burst_off.back())) {
+        burst_off.back() = t + width;
+      } else {
+        burst_on.push_back(t);
+        burst_off.push_back(t + width);
+      }
+    }
+  }
+};
+
+#endif
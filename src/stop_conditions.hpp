@@ -0,0 +1,53 @@
+#ifndef STOP_CONDITIONS_HPP
+#define STOP_CONDITIONS_HPP
+
+#include <vector>
+#include <cmath>
+
+
+// Stopping conditions of the stochastic engine (first passage of species or linear combinations of species)
+// Condition c is met when sum_i weight_i * x_i >= level[c] (above) or <= level[c] (below) for the particle numbers x, i.e. the
+// threshold on the concentrations times the volume factor. Only the species with nonzero weights are stored, so checking
+// the conditions after every reaction costs a few multiplications.
+struct stop_conditions {
+  std::vector<int> begin;         // terms of condition c: begin[c], ..., begin[c+1]-1
+  std::vector<int> species;       // species of each term
+  std::vector<double> weight;     // weight of each term
+  std::vector<double> level;      // threshold of each condition (particle numbers)
+  std::vector<char> above;        // direction of each condition
+
+  stop_conditions() : begin(1, 0) {}
+
+  int size() const { return level.size(); }
+
+  // Adds a condition on the weighted sum of species (weights[i] for species i, thresholds in particle numbers)
+  void add(const std::vector<double> &weights, double threshold, bool is_above) {
+    for (size_t i = 0; i < weights.size(); i++) {
+      if (weights[i] != 0.0) {
+        species.push_back(i);
+        weight.push_back(weights[i]);
+      }
+    }
+    begin.push_back(species.size());
+    level.push_back(threshold);
+    above.push_back(is_above);
+  }
+
+  // Value of the linear combination of condition c for the particle numbers x
+  double value(int c, const double *x) const {
+    double sum = 0.0;
+    for (int t = begin[c]; t < begin[c+1]; t++) sum += weight[t] * x[species[t]];
+    return sum;
+  }
+
+  // Index of the first condition met by the particle numbers x (-1: none)
+  int met(const double *x) const {
+    for (int c = 0; c < size(); c++) {
+      double v = value(c, x);
+      if (above[c] ? (v >= level[c]) : (v <= level[c])) return c;
+    }
+    return -1;
+  }
+};
+
+#endif
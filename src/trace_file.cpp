@@ -0,0 +1,381 @@
+#include <string>
+#include <vector>
+#include <cmath>
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+#include <Rcpp.h>
+#include "trace_file.hpp"
+#include "model_registry.hpp"
+#include "parallel.hpp"
+#include "sim_params.hpp"
+#include "result_columns.hpp"
+using namespace Rcpp;
+
+
+// Parsing
+// A block of the file is split at line ends into a few chunks per thread. The rows of every chunk are counted in parallel, the row
+// offsets of the chunks are their prefix sums, then the chunks are parsed in parallel directly into the destination arrays (only
+// the selected columns are converted). Every thread only reads the mapped file and writes its own rows.
+
+static inline bool is_separator(unsigned char c) {
+  return (c == ' ') || (c == '\t') || (c == ',') || (c == ';') || (c == '\r');
+}
+
+// End of the line starting at p (position of the '\n' or end)
+static inline const unsigned char *line_end(const unsigned char *p, const unsigned char *end) {
+  const void *nl = std::memchr(p, '\n', end - p);
+  return nl ? static_cast<const unsigned char *>(nl) : end;
+}
+
+// First character of the line that is not a separator (null for blank and comment lines)
+static inline const unsigned char *row_start(const unsigned char *p, const unsigned char *end) {
+  while ((p < end) && is_separator(*p)) p++;
+  return ((p == end) || (*p == '#')) ? 0 : p;
+}
+
+// Tokens of a line (used for the header and the first row only)
+static std::vector<std::string> tokens(const unsigned char *p, const unsigned char *end) {
+  std::vector<std::string> result;
+  while (p < end) {
+    while ((p < end) && is_separator(*p)) p++;
+    const unsigned char *q = p;
+    while ((q < end) && !is_separator(*q)) q++;
+    if (q > p) result.push_back(std::string(reinterpret_cast<const char *>(p), q - p));
+    p = q;
+  }
+  return result;
+}
+
+// Number of a token: NA for "NA" and anything that is not a number
+static inline double token_value(const unsigned char *p, const unsigned char *q) {
+  char buffer[64];
+  size_t n = std::min((size_t)(q - p), sizeof(buffer) - 1);
+  std::memcpy(buffer, p, n);
+  buffer[n] = 0;
+  char *tail;
+  double value = std::strtod(buffer, &tail);
+  return ((tail == buffer) || (*tail != 0)) ? NA_REAL : value;
+}
+
+trace_file::trace_file(const std::string &path) : path(path), ncol(0), file(path), offset(0) {
+  if (!file.data) {
+    stop("Cannot open the trace file '" + path + "'.");
+  }
+  const unsigned char *begin = file.data, *end = file.data + file.size;
+  std::vector<std::string> header;
+  for (const unsigned char *p = begin; p < end; ) {
+    const unsigned char *e = line_end(p, end);
+    const unsigned char *q = p;
+    while ((q < e) && is_separator(*q)) q++;
+    if ((q < e) && (*q == '#')) {
+      header = tokens(q + 1, e);
+    } else if (q < e) {
+      ncol = tokens(q, e).size();
+      offset = p - begin;
+      break;
+    }
+    p = e + 1;
+    offset = std::min((size_t)(p - begin), file.size);
+  }
+  if (ncol == 0) ncol = header.size();
+  if ((int)header.size() == ncol) {
+    names = header;
+  } else {
+    for (int c = 0; c < ncol; c++) names.push_back("V" + std::to_string(c + 1));
+  }
+}
+
+int trace_file::column(const std::string &name) const {
+  int c = std::find(names.begin(), names.end(), name) - names.begin();
+  return (c < ncol) ? c : -1;
+}
+
+void trace_file::split(size_t from, size_t to, int nthreads, std::vector<size_t> &bounds, std::vector<size_t> &rows) const {
+  const size_t min_chunk = 1 << 20;
+  const size_t nchunks = std::max((size_t)1, std::min((size_t)nthreads * 4, (to - from) / min_chunk));
+  const unsigned char *data = file.data;
+  bounds.assign(1, from);
+  for (size_t k = 1; k < nchunks; k++) {
+    size_t b = std::max(bounds.back(), from + (to - from) / nchunks * k);
+    b = (b > from) ? line_end(data + b - 1, data + to) - data + 1 : b;
+    if (b < to) bounds.push_back(b);
+  }
+  bounds.push_back(to);
+  const int n = bounds.size() - 1;
+  rows.assign(n + 1, 0);
+  parallel_for(n, nthreads, [&](int k, int thread) {
+    const unsigned char *end = data + bounds[k+1];
+    size_t count = 0;
+    for (const unsigned char *p = data + bounds[k]; p < end; ) {
+      const unsigned char *e = line_end(p, end);
+      if (row_start(p, e)) count++;
+      p = e + 1;
+    }
+    rows[k+1] = count;
+  }, &sim_check_interrupt);
+  for (int k = 0; k < n; k++) rows[k+1] += rows[k];
+}
+
+void trace_file::parse(const std::vector<size_t> &bounds, const std::vector<size_t> &rows, const std::vector<int> &columns,
+                       const std::vector<double *> &out, int nthreads) const {
+  // slot[c]: destination of file column c (-1: skipped)
+  int last = -1;
+  for (size_t j = 0; j < columns.size(); j++) last = std::max(last, columns[j]);
+  std::vector<int> slot(last + 1, -1);
+  for (size_t j = 0; j < columns.size(); j++) slot[columns[j]] = j;
+  const unsigned char *data = file.data;
+  const int n = bounds.size() - 1;
+  std::vector<char> short_row(n, 0);   // chunk has a row with too few columns
+  parallel_for(n, nthreads, [&](int k, int thread) {
+    const unsigned char *end = data + bounds[k+1];
+    size_t row = rows[k];
+    for (const unsigned char *p = data + bounds[k]; p < end; ) {
+      const unsigned char *e = line_end(p, end);
+      const unsigned char *q = row_start(p, e);
+      p = e + 1;
+      if (!q) continue;
+      int c = 0;
+      while ((q < e) && (c <= last)) {
+        const unsigned char *t = q;
+        while ((t < e) && !is_separator(*t)) t++;
+        if (slot[c] >= 0) out[slot[c]][row] = token_value(q, t);
+        c++;
+        q = t;
+        while ((q < e) && is_separator(*q)) q++;
+      }
+      row++;
+      if (c <= last) short_row[k] = 1;
+    }
+  }, &sim_check_interrupt);
+  for (int k = 0; k < n; k++) {
+    if (short_row[k]) {
+      stop("A row of the trace file '" + path + "' has fewer columns than the selected ones.");
+    }
+  }
+}
+
+size_t trace_file::read_block(size_t block_bytes, const std::vector<int> &columns, std::vector<std::vector<double> > &values,
+                              int nthreads, bool release) {
+  if (offset >= file.size) return 0;
+  size_t from = offset, to = std::min(file.size, from + std::max(block_bytes, (size_t)1));
+  to = (to < file.size) ? line_end(file.data + to - 1, file.data + file.size) - file.data + 1 : to;
+  to = std::min(to, file.size);
+  std::vector<size_t> bounds, rows;
+  split(from, to, nthreads, bounds, rows);
+  const size_t nrow = rows.back();
+  std::vector<double *> out(columns.size());
+  values.resize(columns.size());
+  for (size_t j = 0; j < columns.size(); j++) {
+    size_t old = values[j].size();
+    values[j].resize(old + nrow);
+    out[j] = values[j].empty() ? 0 : &values[j][0] + old;
+  }
+  parse(bounds, rows, columns, out, nthreads);
+  offset = to;
+  if (release) file.release(from, to);
+  return nrow;
+}
+
+size_t trace_file::count_rows(int nthreads) {
+  split(offset, file.size, nthreads, counted_bounds, counted_rows);
+  return counted_rows.back();
+}
+
+void trace_file::read_all(const std::vector<int> &columns, const std::vector<double *> &out, int nthreads) {
+  parse(counted_bounds, counted_rows, columns, out, nthreads);
+  offset = file.size;
+}
+
+
+// File columns of the requested columns: an unnamed entry selects a file column by its name, a named entry selects the file column
+// of the value under the name of the entry (e.g. c(time = "t", Ca = "V5")); targets are the names of the selected columns
+static std::vector<int> trace_columns(const trace_file &trace, CharacterVector columns, std::vector<std::string> &targets) {
+  std::vector<int> selected;
+  const bool named = !Rf_isNull(columns.names());
+  CharacterVector names = named ? CharacterVector(columns.names()) : CharacterVector(columns.length());
+  for (int k = 0; k < columns.length(); k++) {
+    std::string source = as<std::string>(columns[k]);
+    std::string target = named ? as<std::string>(names[k]) : "";
+    if (target.empty()) target = source;
+    int c = trace.column(source);
+    if (c < 0) {
+      stop("The trace file '" + trace.path + "' has no column '" + source + "'.");
+    }
+    selected.push_back(c);
+    targets.push_back(target);
+  }
+  return selected;
+}
+
+
+//' Read Calcium Trace Files (exported to R)
+//'
+//' Reads selected columns of a large text trace file (e.g. the calcium output of a spiking network simulation, see inst/extdata)
+//' much faster than read.table(): the file is memory-mapped, its rows are counted and the selected columns parsed on native threads
+//' directly into the columns of the result, without intermediate strings or data frames.
+//' Columns are separated by blanks, tabs, commas or semicolons; lines starting with "#" are comments, the last one before the first
+//' row names the columns (e.g. "# time steps G_alpha PLC Ca"), otherwise the columns are named V1, V2, ...
+//' Entries that are not numbers are NA.
+//' @param path A string: the path of the trace file.
+//' @param columns A character vector: the columns to read (default: "time" and "Ca"); named entries rename the column,
+//'                e.g. c(time = "V1", Ca = "V5") for a file without header.
+//' @param nthreads An integer: the number of threads (default: all hardware threads).
+//' @return A dataframe with the selected columns (can be used as input_df of the simulators).
+//' @examples
+//' trace <- read_trace(system.file("extdata", "ca1e-08_2.5_662.25_0.05s.out", package = "CalciumModelsLibrary"))
+//' @export
+// [[Rcpp::export]]
+DataFrame read_trace(std::string path, CharacterVector columns = CharacterVector::create("time", "Ca"), int nthreads = 0) {
+  trace_file trace(path);
+  std::vector<std::string> targets;
+  const std::vector<int> selected = trace_columns(trace, columns, targets);
+  nthreads = worker_threads(nthreads);
+  const size_t nrow = trace.count_rows(nthreads);
+  List result(selected.size());
+  CharacterVector names(selected.size());
+  std::vector<double *> out(selected.size());
+  for (size_t j = 0; j < selected.size(); j++) {
+    NumericVector column(nrow);
+    out[j] = column.begin();
+    result[j] = column;
+    names[j] = targets[j];
+  }
+  trace.read_all(selected, out, nthreads);
+  return result_frame(result, names, nrow);
+}
+
+//' Stream Calcium Trace Files into the Stochastic Simulator (exported to R)
+//'
+//' Runs the stochastic simulation of a model (Gillespie's Direct Method) with a calcium input read from a trace file block by block,
+//' so traces larger than the memory can be used: every block of the memory-mapped file is parsed on native threads (see read_trace()),
+//' simulated, and its pages are released before the next block is read. The trajectory is the same as with the whole trace as
+//' input_df of simulator() (the run is continued exactly across the blocks), only the output times are kept in memory.
+//' Input signals of the model (e.g. Vm of the ano model) are read from file columns of the same name.
+//' @param model A string: the name of the model ("ano", "calcineurin", "calmodulin", "camkii", "glycphos" or "pkc").
+//' @param path A string: the path of the trace file.
+//' @param input_sim_params A List: contains the simulation end ("endTime", or the last of the "outputTimes"), the output "timestep" and optionally
+//'                         a "seed". With "baselineCa" the run starts from an equilibrated state at this calcium concentration (see sim_equilibrate()).
+//' @param input_model_params A List: the model specific parameters. Can contain up to three different vectors named "vols" (model volumes), "init_conc" (initial conditions) and "params" (reaction parameters).
+//' @param columns A character vector: the file columns of "time", "Ca" and the input signals, as names of the entries
+//'                (e.g. c(time = "V1", Ca = "V5"); default: the columns of these names).
+//' @param block_mb A number: the size of the blocks [MB].
+//' @param nthreads An integer: the number of threads parsing a block (default: all hardware threads).
+//' @return A dataframe with the output times, the calcium input and the concentrations of the species (like simulator()).
+//' @examples
+//' path <- system.file("extdata", "ca1e-08_2.5_662.25_0.05s.out", package = "CalciumModelsLibrary")
+//' result <- sim_trace("pkc", path, list(endTime = 10, timestep = 0.05), list())
+//' @export
+// [[Rcpp::export]]
+DataFrame sim_trace(std::string model,
+                    std::string path,
+                    List input_sim_params,
+                    List input_model_params,
+                    CharacterVector columns = CharacterVector::create(),
+                    double block_mb = 64,
+                    int nthreads = 0) {
+
+  // READ INPUT AND UPDATE DEFAULTS
+  const model_info &info = find_model(model);
+  const int ns = info.nspecies;
+  trace_file trace(path);
+  std::vector<std::string> targets;
+  std::vector<int> selected = trace_columns(trace, columns, targets);
+  const char *required[] = { "time", "Ca" };
+  for (int k = 0; k < 2; k++) {
+    if (std::find(targets.begin(), targets.end(), required[k]) == targets.end()) {
+      int c = trace.column(required[k]);
+      if (c < 0) {
+        stop("The trace file '" + path + "' has no column '" + required[k] + "' (see columns).");
+      }
+      selected.push_back(c);
+      targets.push_back(required[k]);
+    }
+  }
+  const int time_column = std::find(targets.begin(), targets.end(), "time") - targets.begin();
+  const int ca_column = std::find(targets.begin(), targets.end(), "Ca") - targets.begin();
+  // input signals: column of each declared input of the model (if any)
+  std::vector<int> input_column;
+  sim_problem pb;
+  for (size_t i = 0; i < info.input_names.size(); i++) {
+    int j = std::find(targets.begin(), targets.end(), info.input_names[i]) - targets.begin();
+    if ((j == (int)targets.size()) && (trace.column(info.input_names[i]) >= 0)) {
+      selected.push_back(trace.column(info.input_names[i]));
+      targets.push_back(info.input_names[i]);
+    }
+    if (j < (int)targets.size()) {
+      input_column.push_back(j);
+      pb.inputs.param_index.push_back(info.input_param_index[i]);
+    }
+  }
+  pb.inputs.values.resize(input_column.size());
+  if (!(block_mb > 0)) {
+    stop("block_mb has to be positive.");
+  }
+  const size_t block_bytes = (size_t)(block_mb * 1048576.0);
+  nthreads = worker_threads(nthreads);
+
+  // Block arrays of the problem: the last row of the previous block followed by the rows of the block
+  std::vector<std::vector<double> > values;
+  auto next_block = [&]() {
+    for (size_t j = 0; j < values.size(); j++) {
+      if (!values[j].empty()) values[j].erase(values[j].begin(), values[j].end() - 1);
+    }
+    size_t nrow = trace.read_block(block_bytes, selected, values, nthreads, true);
+    pb.input_time = values[time_column];
+    pb.input_ca = values[ca_column];
+    for (size_t i = 0; i < input_column.size(); i++) pb.inputs.values[i] = values[input_column[i]];
+    for (size_t k = 1; k < pb.input_time.size(); k++) {
+      if (!(pb.input_time[k] > pb.input_time[k-1])) stop("The times of the trace file '" + path + "' have to be increasing.");
+    }
+    return nrow;
+  };
+  if (next_block() == 0) {
+    stop("The trace file '" + path + "' has no rows.");
+  }
+  read_model_problem(info, info.resolve_params(input_model_params), pb);
+  pb.output_times = sim_output_times(input_sim_params, pb.input_time[0]);
+  if (input_sim_params.containsElementNamed("baselineCa")) {
+    pb.x0_pool = equilibrated_states(info, pb, read_warm_start_options(input_sim_params));
+  }
+  const uint64_t seed = sim_seed(input_sim_params);
+  const int noutput = pb.output_times.size();
+
+  // RUN SIMULATION block by block (the run state carries over, the input cursor is rebased to the first row of each block)
+  std::vector<double> out((size_t)noutput * ns);
+  std::vector<double> ca(noutput);
+  ssa_state s = ssa_initial_state(pb, seed, 0);
+  bool last_block = false;
+  while (true) {
+    const int first_output = s.noutput;
+    const double until = last_block ? HUGE_VAL : pb.input_time.back();
+    while (s.time < std::min(until, pb.end_time())) {
+      info.ssa_simulator(pb, s, until, out.empty() ? 0 : &out[0], ssa_check_events, 0, 0);
+      sim_check_interrupt();
+    }
+    // calcium input at the output times of the block
+    for (int o = first_output, k = 0; o < s.noutput; o++) {
+      while ((k+1 < (int)pb.input_time.size()) && (pb.input_time[k+1] <= pb.output_times[o])) k++;
+      ca[o] = pb.input_ca[k];
+    }
+    if (s.finished(pb) || last_block) break;
+    s.ntimepoint = 0;
+    last_block = (next_block() == 0);
+  }
+
+  NumericVector time(pb.output_times.begin(), pb.output_times.end());
+  CharacterVector col_names(ns+2);
+  col_names[0] = "time";
+  col_names[1] = "Ca";
+  std::vector<double> *species = new std::vector<double>();
+  species->swap(out);
+  std::shared_ptr<const std::vector<double> > species_values(species);
+  List result(ns+2);
+  result[0] = time;
+  result[1] = NumericVector(ca.begin(), ca.end());
+  for (int i = 0; i < ns; i++) {
+    col_names[i+2] = info.species_names[i];
+    result[i+2] = result_column(result_view(species_values, noutput, i, ns));
+  }
+  return result_frame(result, col_names, noutput);
+}
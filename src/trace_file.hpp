@@ -0,0 +1,39 @@
+#ifndef TRACE_FILE_HPP
+#define TRACE_FILE_HPP
+
+#include <string>
+#include <vector>
+#include "mapped_file.hpp"
+
+
+// Text trace files (see trace_file.cpp): one row per line, columns separated by blanks, tabs, commas or semicolons, lines starting
+// with '#' are comments; the last comment line before the first row names the columns (e.g. "# time steps G_alpha PLC Ca").
+// The file is memory-mapped and parsed in blocks: the rows of a block are counted and parsed on native threads.
+class trace_file {
+public:
+  explicit trace_file(const std::string &path);
+
+  // Parses the next block of about block_bytes (complete lines) into values[c] for the selected columns (appended);
+  // returns the number of rows, 0 at the end of the file. With release, the pages of the block are dropped from memory afterwards.
+  size_t read_block(size_t block_bytes, const std::vector<int> &columns, std::vector<std::vector<double> > &values, int nthreads,
+                    bool release);
+  // Counts and parses all remaining rows directly into the arrays out[c] (allocated by the caller after count_rows())
+  size_t count_rows(int nthreads);
+  void read_all(const std::vector<int> &columns, const std::vector<double *> &out, int nthreads);
+  int column(const std::string &name) const;   // -1 if there is no such column
+
+  std::string path;
+  std::vector<std::string> names;   // header names, or V1, V2, ... without header
+  int ncol;
+
+private:
+  // Rows of the byte range [from, to) (complete lines) on nthreads threads: chunk boundaries and rows before each chunk
+  void split(size_t from, size_t to, int nthreads, std::vector<size_t> &bounds, std::vector<size_t> &rows) const;
+  void parse(const std::vector<size_t> &bounds, const std::vector<size_t> &rows, const std::vector<int> &columns,
+             const std::vector<double *> &out, int nthreads) const;
+  mapped_file file;
+  size_t offset;                                // start of the next block
+  std::vector<size_t> counted_bounds, counted_rows;   // split of the remaining rows by count_rows()
+};
+
+#endif
@@ -0,0 +1,38 @@
+#ifndef VARINT_HPP
+#define VARINT_HPP
+
+#include <string>
+#include <stdint.h>
+
+
+// Variable length integers: 7 bits per byte, least significant first, the high bit marks a following byte
+// (values below 128 take one byte). Signed values are zigzag mapped (0, -1, 1, -2, ... -> 0, 1, 2, 3, ...).
+inline void put_uvarint(std::string &out, uint64_t z) {
+  while (z >= 0x80) {
+    out += (char)(unsigned char)(z | 0x80);
+    z >>= 7;
+  }
+  out += (char)(unsigned char)z;
+}
+inline void put_varint(std::string &out, int64_t v) {
+  put_uvarint(out, ((uint64_t)v << 1) ^ (uint64_t)(v >> 63));
+}
+
+// Reads one varint at p (p < end) and advances p; returns false for a truncated value
+inline bool get_uvarint(const unsigned char *&p, const unsigned char *end, uint64_t &z) {
+  z = 0;
+  for (int shift = 0; (p < end) && (shift < 64); shift += 7) {
+    unsigned char b = *p++;
+    z |= (uint64_t)(b & 0x7F) << shift;
+    if (!(b & 0x80)) return true;
+  }
+  return false;
+}
+inline bool get_varint(const unsigned char *&p, const unsigned char *end, int64_t &v) {
+  uint64_t z;
+  if (!get_uvarint(p, end, z)) return false;
+  v = (int64_t)(z >> 1) ^ -(int64_t)(z & 1);
+  return true;
+}
+
+#endif
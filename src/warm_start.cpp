@@ -0,0 +1,124 @@
+#include <map>
+#include <string>
+#include <Rcpp.h>
+#include "model_registry.hpp"
+#include "sim_params.hpp"
+#include "checkpoint.hpp"
+using namespace Rcpp;
+
+
+// Cache of equilibrated states
+// Keyed by the model name and the equilibration problem (parameters incl. input signals, initial particle numbers, volume factor,
+// baseline calcium, method, burn-in and number of samples). The least recently used entry is dropped when the cache is full.
+struct warm_start_entry {
+  std::vector<double> states;
+  unsigned long last_use;
+};
+typedef std::pair<std::string, std::vector<double> > warm_start_key;
+static const size_t warm_start_cache_size = 64;
+
+static std::map<warm_start_key, warm_start_entry> &warm_start_cache() {
+  static std::map<warm_start_key, warm_start_entry> cache;
+  return cache;
+}
+
+warm_start_options read_warm_start_options(List sim_params) {
+  warm_start_options opt;
+  opt.baseline = sim_param(sim_params, "baselineCa", 0.0);
+  std::string method = sim_params.containsElementNamed("equilibration") ? as<std::string>(sim_params["equilibration"]) : "ssa";
+  if ((method != "ssa") && (method != "ode")) {
+    stop("equilibration has to be \"ssa\" or \"ode\".");
+  }
+  opt.ode = (method == "ode");
+  opt.burn_in = sim_param(sim_params, "burnIn", 100.0);
+  opt.nsamples = (int)sim_param(sim_params, "equilibrationSamples", 100.0);
+  opt.check_interrupt = &sim_check_interrupt;
+  if (!(opt.baseline >= 0) || !(opt.burn_in > 0) || (opt.nsamples < 1)) {
+    stop("baselineCa has to be non-negative, burnIn positive and equilibrationSamples at least 1.");
+  }
+  return opt;
+}
+
+std::vector<double> equilibrated_states(const model_info &info, const sim_problem &pb, const warm_start_options &opt) {
+  static unsigned long use_counter = 0;
+  sim_problem eq = equilibration_problem(pb, opt);
+  warm_start_key key(info.name, eq.params);
+  key.second.insert(key.second.end(), eq.x0.begin(), eq.x0.end());
+  double settings[] = { eq.f, opt.baseline, opt.ode ? 1.0 : 0.0, opt.burn_in, (double)opt.nsamples };
+  key.second.insert(key.second.end(), settings, settings + 5);
+
+  std::map<warm_start_key, warm_start_entry> &cache = warm_start_cache();
+  std::map<warm_start_key, warm_start_entry>::iterator it = cache.find(key);
+  if (it == cache.end()) {
+    warm_start_entry entry;
+    // the seed is derived from the problem, so the equilibrated states do not depend on the cache contents
+    info.equilibrate(pb, opt, problem_fingerprint(eq), entry.states);
+    if (cache.size() >= warm_start_cache_size) {
+      std::map<warm_start_key, warm_start_entry>::iterator oldest = cache.begin();
+      for (std::map<warm_start_key, warm_start_entry>::iterator e = cache.begin(); e != cache.end(); ++e) {
+        if (e->second.last_use < oldest->second.last_use) oldest = e;
+      }
+      cache.erase(oldest);
+    }
+    it = cache.insert(std::make_pair(key, entry)).first;
+  }
+  it->second.last_use = ++use_counter;
+  return it->second.states;
+}
+
+
+//' Equilibrated States (exported to R)
+//'
+//' Equilibrates a model at a constant baseline calcium concentration, either by a stochastic burn-in (Gillespie's Direct Method) followed by
+//' sampling of the equilibrated state, or deterministically as the steady state of the reaction rate equations.
+//' The result is cached per model, parameters, volume and baseline: the stochastic simulations (sim_<MODEL_NAME>(), sim_ensemble(), sim_checkpointed())
+//' start from a randomly drawn equilibrated state instead of the initial conditions if their sim parameters contain "baselineCa"
+//' (and optionally "equilibration", "burnIn" and "equilibrationSamples" as the arguments of this function), so repeated runs skip the burn-in.
+//' @param model A string: the name of the model ("ano", "calcineurin", "calmodulin", "camkii", "glycphos" or "pkc").
+//' @param baseline_ca A number: the baseline calcium concentration [nmol/l].
+//' @param input_model_params A List: the model specific parameters. Can contain up to three different vectors named "vols" (model volumes), "init_conc" (initial conditions of the burn-in) and "params" (reaction parameters).
+//' @param equilibration A string: "ssa" (stochastic burn-in) or "ode" (steady state of the reaction rate equations).
+//' @param burn_in A number: the simulated burn-in time [s]; the states are sampled every tenth of it after the burn-in.
+//' @param nsamples An integer: the number of sampled states.
+//' @return A dataframe with the index of the state and the concentrations of all species (one row per equilibrated state).
+//' @examples
+//' sim_equilibrate("camkii", 50, list())
+//' ca <- data.frame(time = seq(0, 10, by = 0.01), Ca = 50)
+//' sim_ensemble("camkii", ca, list(endTime = 10, timestep = 0.1, baselineCa = 50), list(), nreplicates = 100)
+//' @export
+// [[Rcpp::export]]
+DataFrame sim_equilibrate(std::string model,
+                          double baseline_ca,
+                          List input_model_params,
+                          std::string equilibration = "ssa",
+                          double burn_in = 100,
+                          int nsamples = 100) {
+
+  // READ INPUT AND UPDATE DEFAULTS
+  const model_info &info = find_model(model);
+  List sim_params = List::create(_["baselineCa"] = baseline_ca, _["equilibration"] = equilibration,
+                                 _["burnIn"] = burn_in, _["equilibrationSamples"] = nsamples, _["outputTimes"] = 0.0);
+  DataFrame input_df = DataFrame::create(_["time"] = 0.0, _["Ca"] = baseline_ca);
+  sim_problem pb = read_sim_problem(info, input_df, sim_params, input_model_params);
+
+  // Return value (one row per state; cols. = state + species)
+  int nstates = pb.x0_pool.size() / info.nspecies;
+  NumericMatrix retval(nstates, info.nspecies+1);
+  CharacterVector col_names(info.nspecies+1);
+  col_names[0] = "state";
+  for (int i = 0; i < info.nspecies; i++) {
+    col_names[i+1] = info.species_names[i];
+  }
+  colnames(retval) = col_names;
+  for (int k = 0; k < nstates; k++) {
+    retval(k, 0) = k+1;
+    for (int i = 0; i < info.nspecies; i++) {
+      retval(k, i+1) = pb.x0_pool[(size_t)k*info.nspecies + i] / pb.f;
+    }
+  }
+
+  // Convert NumericMatrix retval to DataFrame
+  DataFrame df_retval(retval);
+
+  return df_retval;
+}
@@ -0,0 +1,88 @@
+#ifndef WARM_START_HPP
+#define WARM_START_HPP
+
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <stdint.h>
+#include "ssa_engine.hpp"
+#include "ode_solver.hpp"
+
+
+// Pre-equilibration (warm start) at a constant baseline calcium concentration
+// Runs that start from the default initial conditions spend a large part of their time relaxing to the steady state of the
+// baseline calcium. The equilibrated states are computed once per model, parameters, volume and baseline (see warm_start.cpp)
+// and every run or replicate draws its initial state from them (sim_problem::x0_pool).
+struct warm_start_options {
+  double baseline;   // baseline calcium concentration [nmol/l]
+  bool ode;          // deterministic steady state of the reaction rate equations instead of SSA burn-in
+  double burn_in;    // SSA burn-in time [s]
+  int nsamples;      // number of equilibrated states sampled after the burn-in (every tenth of the burn-in time)
+  void (*check_interrupt)();  // called every ssa_check_events reactions of the burn-in (may be null)
+};
+
+// Equilibration problem: constant baseline calcium, the parameters and input signals at the start of the input
+inline sim_problem equilibration_problem(const sim_problem &pb, const warm_start_options &opt) {
+  sim_problem eq;
+  eq.input_time.assign(1, 0.0);
+  eq.input_ca.assign(1, opt.baseline);
+  eq.params = pb.params;
+  if (!pb.inputs.empty()) {
+    pb.inputs.apply(&eq.params[0], 0);
+  }
+  eq.x0 = pb.x0;
+  eq.f = pb.f;
+  for (int k = 0; k < opt.nsamples; k++) {
+    eq.output_times.push_back(opt.burn_in * (1.0 + 0.1 * k));
+  }
+  return eq;
+}
+
+// Equilibrated particle numbers of the model (states[state*nspecies + species])
+// SSA: a single run at the baseline calcium, sampled after the burn-in (the seed makes the states reproducible).
+// ODE: the steady state of the reaction rate equations, integrated over doubling time spans until the concentrations
+// would change by less than 1e-6 of the largest concentration over the time integrated so far (one state, rounded to particles).
+template <class Kernel>
+void equilibrate(const sim_problem &pb, const warm_start_options &opt, uint64_t seed, std::vector<double> &states) {
+  const int ns = Kernel::nspecies;
+  sim_problem eq = equilibration_problem(pb, opt);
+  if (opt.ode) {
+    std::vector<double> c(ns), dc(ns);
+    for (int i = 0; i < ns; i++) c[i] = pb.x0[i] / pb.f;
+    typename Kernel::factors_type factors;
+    Kernel::prepare(&eq.params[0], opt.baseline, factors);
+    auto rhs = [&](const double *y, double *dy) { Kernel::derivatives(&eq.params[0], factors, opt.baseline, pb.f, y, dy); };
+    auto jac = [&](const double *y, double *J) { Kernel::jacobian(&eq.params[0], factors, opt.baseline, pb.f, y, J); };
+    RosenbrockSolver solver(ns, 1e-8, 1e-10);
+    double t = 0.0;
+    for (double span = 1.0; t < 1e8; span *= 2) {
+      solver.integrate(rhs, jac, &c[0], t, t + span);
+      t += span;
+      rhs(&c[0], &dc[0]);
+      double cmax = 0.0, dcmax = 0.0;
+      for (int i = 0; i < ns; i++) {
+        cmax = std::max(cmax, std::fabs(c[i]));
+        dcmax = std::max(dcmax, std::fabs(dc[i]));
+      }
+      if (dcmax * t <= 1e-6 * cmax) break;
+    }
+    states.resize(ns);
+    for (int i = 0; i < ns; i++) {
+      states[i] = std::max(0.0, floor(c[i] * pb.f + 0.5));
+    }
+    return;
+  }
+  std::vector<double> out(eq.output_times.size() * ns);
+  ssa_state s = ssa_initial_state(eq, seed, 0);
+  while (!s.finished(eq)) {
+    if (opt.check_interrupt) opt.check_interrupt();
+    ssa_simulator<Kernel>(eq, s, HUGE_VAL, &out[0], ssa_check_events, 0, 0);
+  }
+  states.resize(out.size());
+  for (size_t i = 0; i < out.size(); i++) {
+    // back to particle numbers (exact integers before the division by f)
+    states[i] = floor(out[i] * pb.f + 0.5);
+  }
+}
+
+#endif